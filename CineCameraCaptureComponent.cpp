@@ -6,18 +6,109 @@
 #include "SceneInterface.h"
 #include "Logging/MessageLog.h"
 #include "SceneManagement.h"
+#include "Containers/Queue.h"
+#include "Async/ParallelFor.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "CineCameraCaptureScheduler.h"
+#include "CineCameraCaptureRigComponent.h"
+#include "CineCameraOfflineCapture.h"
+#include "CineCameraPixelConversion.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "UObject/UnrealType.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
 
 #define LOCTEXT_NAMESPACE "CineCameraCaptureComponent"
 
-static TMultiMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<UCineCameraCaptureComponent> > SceneCapturesToUpdateMap;
+static TAutoConsoleVariable<int32> CVarCineCaptureMaxCapturesPerFrame(
+	TEXT("r.CineCapture.MaxCapturesPerFrame"),
+	0,
+	TEXT("Maximum number of cine camera captures rendered per frame and world. Captures over budget are deferred to later frames. 0 = unlimited."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCineCaptureMaxPixelsPerFrame(
+	TEXT("r.CineCapture.MaxPixelsPerFrame"),
+	0,
+	TEXT("Maximum number of render target pixels captured per frame and world by cine camera captures. 0 = unlimited."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCineCaptureLensCacheAutoDetect(
+	TEXT("r.CineCapture.LensCacheAutoDetect"),
+	0,
+	TEXT("Whether cine camera captures hash their PostProcessSettings once per frame to catch edits made in place from code.\n")
+	TEXT("Off by default: SetPostProcessSettings(), editor changes and MarkLensPostProcessDirty() rebuild the lens post process already."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarCineCapturePriorityAging(
+	TEXT("r.CineCapture.PriorityAgingPerFrame"),
+	1.0f,
+	TEXT("CaptureSortPriority gained by a deferred cine camera capture for every frame it waits."),
+	ECVF_Default);
+
+/** Components waiting to be captured in one world. Producers may enqueue from any thread (parallel transform updates), the game thread drains it. */
+struct FCineCaptureWorldQueue
+{
+	TQueue<TWeakObjectPtr<UCineCameraCaptureComponent>, EQueueMode::Mpsc> PendingCaptures;
+
+	/** Components with bBatchFocusQueries that need their focus distance resolved at the end of the frame. */
+	TQueue<TWeakObjectPtr<UCineCameraCaptureComponent>, EQueueMode::Mpsc> PendingFocusQueries;
+
+	/** Game thread only. Number of phase slots handed out per CaptureRateHz, keyed by the rate in mHz. */
+	TMap<int32, uint32> CaptureRatePhaseSlots;
+};
+
+/** Van der Corput sequence in base 2: 0, 1/2, 1/4, 3/4, 1/8, ... Any prefix of it is spread evenly over [0, 1). */
+static float GetCaptureRatePhase(uint32 Slot)
+{
+	return (float)((double)ReverseBits(Slot) / 4294967296.0);
+}
+
+/** Only touched on the game thread; components cache their world's queue on register. */
+static TMap<TWeakObjectPtr<UWorld>, TSharedPtr<FCineCaptureWorldQueue, ESPMode::ThreadSafe> > SceneCaptureQueues;
+
+static TSharedPtr<FCineCaptureWorldQueue, ESPMode::ThreadSafe> FindOrAddCaptureQueue(UWorld* World)
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FCineCaptureWorldQueue, ESPMode::ThreadSafe>& Queue = SceneCaptureQueues.FindOrAdd(World);
+	if (!Queue.IsValid())
+	{
+		Queue = MakeShared<FCineCaptureWorldQueue, ESPMode::ThreadSafe>();
+	}
+	return Queue;
+}
 
 UCineCameraCaptureComponent::UCineCameraCaptureComponent() : Super(), ShowFlags(ESFIM_Game)
 {
 	bCaptureEveryFrame = true;
+	CaptureRateHz = 0.f;
+	CaptureRateAccumulator = 0.0;
+	CaptureRatePhaseHz = 0.f;
 	bCaptureOnMovement = true;
+	bCaptureOnlyWhenChanged = false;
 	bAutoActivate = true;
 	bTickInEditor = true;
 	bAlwaysPersistRenderingState = false;
+	bUsePooledRenderTarget = false;
+	PooledTargetSize = FIntPoint(1920, 1080);
+	PooledTargetFormat = RTF_RGBA16f;
+	bEnableAsyncReadback = false;
+	ReadbackRingSize = 3;
+	bEnableFrameSink = false;
+	bEnableSharedMemoryExport = false;
+	SharedMemorySlots = 4;
+	bEnableMetadataLog = false;
+	MetadataLogCapacity = 262144;
+	MetadataCameraId = 0;
+	bHasPreparedMetadataPose = false;
+	bRenderingWithPassViewStates = false;
+	BuiltCaptureSource = SCS_SceneColorHDR;
+	CaptureProfile = ECineCaptureProfile::Custom;
+	TiledCaptureTileSize = 2048;
+	TiledCaptureGuardBand = 64;
+	FrameSinkFormat = ECineFrameSinkFormat::EXR;
+	FrameSinkMaxQueuedFrames = 8;
+	FrameSinkBackpressure = ECineFrameSinkBackpressure::DropFrame;
 	bUseCustomProjectionMatrix = false;
 	CaptureSource = SCS_SceneColorHDR;
 	CustomProjectionMatrix.SetIdentity();
@@ -28,6 +119,33 @@ UCineCameraCaptureComponent::UCineCameraCaptureComponent() : Super(), ShowFlags(
 	bCameraCutThisFrame = false;
 	bEnableClipPlane = false;
 	CaptureSortPriority = 0;
+	MaxStalenessFrames = 0;
+	SegmentationMaterial = nullptr;
+	bApplyLensDistortion = false;
+	DistortionMaterial = nullptr;
+	DistortionLUT = nullptr;
+	DistortionMID = nullptr;
+	bAdaptiveQuality = false;
+	AdaptiveGPUBudgetMs = 2.0f;
+	AdaptiveMinResolutionScale = 0.5f;
+	AdaptiveMaxResolutionScale = 1.0f;
+	AdaptiveMaxLODDistanceScale = 4.0f;
+	AdaptiveNativeSize = FIntPoint::ZeroValue;
+	AdaptiveBaseLODDistanceFactor = 1.0f;
+	AdaptiveResolutionScale = 1.0f;
+	AdaptiveLastChangeFrame = 0;
+	LastCaptureFrameNumber = 0;
+	LastCapturedStateHash = 0;
+	PendingCaptureStateHash = 0;
+	bHasCapturedState = false;
+	bForceCaptureOnChange = false;
+	bBatchFocusQueries = false;
+	bHasBatchedFocusDistance = false;
+	BatchedFocusDistance = 0.f;
+	bLensPostProcessDirty = true;
+	LensPostProcessValidatedFrame = 0;
+	LastLensUpdateFrame = 0;
+	LensPostProcessVersion = 0;
 	CaptureStereoPass = EStereoscopicPass::eSSP_FULL;
 
 	PrimaryComponentTick.bCanEverTick = true;
@@ -43,6 +161,13 @@ void UCineCameraCaptureComponent::OnRegister()
 {
 	Super::OnRegister();
 
+	UWorld* World = GetWorld();
+	CaptureQueue = World ? FindOrAddCaptureQueue(World) : nullptr;
+	bQueuedForCapture = false;
+	bFocusQueryQueued = false;
+	bHasBatchedFocusDistance = false;
+	CaptureRatePhaseHz = 0.f;
+
 	// Make sure any loaded saved flag settings are reflected in our FEngineShowFlags
 	UpdateShowFlags();
 #if WITH_EDITOR
@@ -60,9 +185,11 @@ void UCineCameraCaptureComponent::UpdateShowFlags()
 		ShowFlags = Archetype->ShowFlags;
 	}
 
-	for (FEngineShowFlagsSetting ShowFlagSetting : ShowFlagSettings)
+	FCineCaptureProfiles::ApplyShowFlags(CaptureProfile, ShowFlags);
+
+	for (const FEngineShowFlagsSetting& ShowFlagSetting : ShowFlagSettings)
 	{
-		int32 SettingIndex = ShowFlags.FindIndexByName(*(ShowFlagSetting.ShowFlagName));
+		int32 SettingIndex = FCineCaptureProfiles::FindShowFlagIndex(ShowFlagSetting.ShowFlagName);
 		if (SettingIndex != INDEX_NONE)
 		{
 			ShowFlags.SetSingleFlag(SettingIndex, ShowFlagSetting.Enabled);
@@ -72,11 +199,26 @@ void UCineCameraCaptureComponent::UpdateShowFlags()
 
 void UCineCameraCaptureComponent::OnUnregister()
 {
+	FCineViewStatePool::Get().RemoveAll(this);
 	for (int32 ViewIndex = 0; ViewIndex < ViewStates.Num(); ViewIndex++)
 	{
 		ViewStates[ViewIndex].Destroy();
 	}
 
+	CancelTiledCapture();
+	RestoreAdaptiveQuality();
+	DestroyOutputPasses();
+	CaptureQueue.Reset();
+	Readback.Reset();
+	SharedMemoryExporter.Reset();
+	PendingIntrinsics.Reset();
+	MetadataLog.Reset();
+	if (FrameSink.IsValid())
+	{
+		FrameSink->Shutdown();
+		FrameSink.Reset();
+	}
+
 	Super::OnUnregister();
 }
 
@@ -96,11 +238,15 @@ void UCineCameraCaptureComponent::Serialize(FArchive& Ar)
 
 	if (Ar.IsLoading())
 	{
+		HiddenComponentSet.Rebuild(HiddenComponents);
+		ShowOnlyComponentSet.Rebuild(ShowOnlyComponents);
 
 #if WITH_EDITORONLY_DATA
 		PostProcessSettings.OnAfterLoad();
 #endif
 
+		bLensPostProcessDirty = true;
+
 		if (Ar.CustomVer(FRenderingObjectVersion::GUID) < FRenderingObjectVersion::MotionBlurAndTAASupportInSceneCapture2d)
 		{
 			ShowFlags.TemporalAA = false;
@@ -140,11 +286,12 @@ void UCineCameraCaptureComponent::PostEditChangeProperty(struct FPropertyChanged
 	const FName MemberPropertyName = (PropertyChangedEvent.MemberProperty != NULL) ? PropertyChangedEvent.MemberProperty->GetFName() : NAME_None;
 
 	// If our ShowFlagSetting UStruct changed, (or if PostEditChange was called without specifying a property) update the actual show flags
-	if (MemberPropertyName.IsEqual("ShowFlagSettings") || MemberPropertyName.IsNone())
+	if (MemberPropertyName.IsEqual("ShowFlagSettings") || MemberPropertyName.IsEqual("CaptureProfile") || MemberPropertyName.IsNone())
 	{
 		UpdateShowFlags();
 	}
 
+	MarkLensPostProcessDirty();
 	CaptureSceneDeferred();
 }
 #endif
@@ -153,17 +300,70 @@ void UCineCameraCaptureComponent::TickComponent(float DeltaTime, enum ELevelTick
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	if (bCaptureEveryFrame)
+	UpdateLensDistortion();
+
+	// Movement captures limited by CaptureRateHz wait here for their slot, see SendRenderTransform_Concurrent()
+	const bool bRateLimitedMovement = bCaptureOnMovement && CaptureRateHz > 0.f;
+	if ((bCaptureEveryFrame || bRateLimitedMovement) && UpdateCaptureRate(DeltaTime, bCaptureEveryFrame || bPendingMovementCapture))
 	{
+		bPendingMovementCapture = false;
 		CaptureSceneDeferred();
 	}
+
+	UpdateAdaptiveQuality();
+	UpdateReadback();
+	UpdateTiledCapture();
+}
+
+bool UCineCameraCaptureComponent::UpdateCaptureRate(float DeltaTime, bool bWantsCapture)
+{
+	if (CaptureRateHz <= 0.f)
+	{
+		return true;
+	}
+
+	const double Period = 1.0 / CaptureRateHz;
+	if (CaptureRatePhaseHz != CaptureRateHz)
+	{
+		// Start part way into the period so components sharing this rate fire on different frames
+		CaptureRatePhaseHz = CaptureRateHz;
+		uint32 Slot = 0;
+		if (CaptureQueue.IsValid())
+		{
+			Slot = CaptureQueue->CaptureRatePhaseSlots.FindOrAdd(FMath::RoundToInt(CaptureRateHz * 1000.f))++;
+		}
+		CaptureRateAccumulator = GetCaptureRatePhase(Slot) * Period;
+	}
+
+	CaptureRateAccumulator += FCineCaptureOfflineMode::IsActive() ? FCineCaptureOfflineMode::GetFixedDeltaTime() : DeltaTime;
+	if (CaptureRateAccumulator < Period)
+	{
+		return false;
+	}
+	if (!bWantsCapture)
+	{
+		// Stay due, the next request captures right away and Fmod() below keeps the phase
+		return false;
+	}
+
+	// Drop whole periods missed during a hitch instead of capturing in a burst, keeping the phase
+	CaptureRateAccumulator = FMath::Fmod(CaptureRateAccumulator, Period);
+	return true;
 }
 
 void UCineCameraCaptureComponent::SendRenderTransform_Concurrent()
 {
 	if (bCaptureOnMovement)
 	{
-		CaptureSceneDeferred();
+		if (CaptureRateHz > 0.f)
+		{
+			// Picked up by the next TickComponent() once the rate allows another capture
+			bPendingMovementCapture = true;
+		}
+		else
+		{
+			CaptureSceneDeferred();
+		}
 	}
 
 	Super::SendRenderTransform_Concurrent();
@@ -172,15 +372,32 @@ void UCineCameraCaptureComponent::SendRenderTransform_Concurrent()
 
 void UCineCameraCaptureComponent::CaptureSceneDeferred()
 {
+	SCOPE_CYCLE_COUNTER(STAT_CineCapture_CaptureSceneDeferred);
+	FCineCaptureScopedTiming ScopedTiming(ECineCaptureTimedScope::CaptureSceneDeferred);
+	CSV_SCOPED_TIMING_STAT(CineCameraCapture, CaptureSceneDeferred);
+
 	UWorld* World = GetWorld();
 	if (World && World->Scene && IsVisible())
 	{
-		// Defer until after updates finish
-		// Needs some CS because of parallel updates.
-		UpdateCameraLensCapture(World->DeltaTimeSeconds);
-		static FCriticalSection CriticalSection;
-		FScopeLock ScopeLock(&CriticalSection);
-		SceneCapturesToUpdateMap.AddUnique(World, this);
+		// Rig cameras are rendered as part of their rig's view family and update their lens here
+		if (OwningRig.IsValid())
+		{
+			UpdateCameraLensCapture(World->DeltaTimeSeconds);
+			return;
+		}
+
+		// Parallel transform updates can get here concurrently, only the first request of the frame enqueues.
+		// The lens is updated after all updates finished, by UpdateDeferredCaptures() together with the other queued captures
+		if (!bQueuedForCapture.AtomicSet(true))
+		{
+			SCOPE_CYCLE_COUNTER(STAT_CineCapture_Enqueue);
+			if (!CaptureQueue.IsValid())
+			{
+				// Not registered yet (e.g. PostEditChangeProperty), which only happens on the game thread
+				CaptureQueue = FindOrAddCaptureQueue(World);
+			}
+			CaptureQueue->PendingCaptures.Enqueue(this);
+		}
 	}
 }
 
@@ -191,6 +408,14 @@ void UCineCameraCaptureComponent::CaptureScene()
 	{
 		World->SendAllEndOfFrameUpdates();
 		World->Scene->UpdateSceneCaptureContents(this);
+		EnqueueReadback();
+
+		if (bCaptureOnlyWhenChanged)
+		{
+			LastCapturedStateHash = ComputeCaptureStateHash();
+			bHasCapturedState = true;
+			bForceCaptureOnChange = false;
+		}
 	}
 
 	if (bCaptureEveryFrame)
@@ -201,27 +426,38 @@ void UCineCameraCaptureComponent::CaptureScene()
 
 void UCineCameraCaptureComponent::UpdateCameraLensCapture(float DeltaTime)
 {
-	RecalcDerivedData();
-
-	CameraLensPostProcessSettings = PostProcessSettings;
+	SCOPE_CYCLE_COUNTER(STAT_CineCapture_UpdateCameraLens);
+	FCineCaptureScopedTiming ScopedTiming(ECineCaptureTimedScope::UpdateCameraLensCapture);
 
-	if (FocusSettings.FocusMethod == ECameraFocusMethod::None)
+	// Offline, the lens advances exactly one fixed step per frame no matter how often a capture is requested
+	const bool bOffline = FCineCaptureOfflineMode::IsActive();
+	if (bOffline)
 	{
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = false;
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = false;
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = false;
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = false;
+		if (LastLensUpdateFrame == GFrameCounter)
+		{
+			return;
+		}
+		LastLensUpdateFrame = GFrameCounter;
+		DeltaTime = FCineCaptureOfflineMode::GetFixedDeltaTime();
 	}
-	else
-	{
-		// Update focus/DoF
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = true;
-		CameraLensPostProcessSettings.DepthOfFieldMethod = PostProcessSettings.DepthOfFieldMethod;
 
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = true;
-		CameraLensPostProcessSettings.DepthOfFieldFstop = CurrentAperture;
+	UpdateLensPostProcessCache();
 
-		CurrentFocusDistance = GetDesiredFocusDistance(GetComponentLocation());
+	if (FocusSettings.FocusMethod != ECameraFocusMethod::None)
+	{
+		if (bBatchFocusQueries && CaptureQueue.IsValid() && !bOffline)
+		{
+			// Use last frame's batched result and ask for a new one, falling back to a direct query until the first batch ran
+			CurrentFocusDistance = bHasBatchedFocusDistance ? BatchedFocusDistance : GetDesiredFocusDistance(GetComponentLocation());
+			if (!bFocusQueryQueued.AtomicSet(true))
+			{
+				CaptureQueue->PendingFocusQueries.Enqueue(this);
+			}
+		}
+		else
+		{
+			CurrentFocusDistance = GetDesiredFocusDistance(GetComponentLocation());
+		}
 
 		// clamp to min focus distance
 		float const MinFocusDistInWorldUnits = LensSettings.MinimumFocusDistance * (GetWorldToMetersScale() / 1000.f);	// convert mm to uu
@@ -237,166 +473,1676 @@ void UCineCameraCaptureComponent::UpdateCameraLensCapture(float DeltaTime)
 		}
 		LastFocusDistance = CurrentFocusDistance;
 
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = true;
+		// The only part of the lens post process that changes every frame
 		CameraLensPostProcessSettings.DepthOfFieldFocalDistance = CurrentFocusDistance;
-
-		CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = true;
-		CameraLensPostProcessSettings.DepthOfFieldSensorWidth = FilmbackSettings.SensorWidth;
 	}
 
 	bResetInterpolation = false;
 }
 
-void UCineCameraCaptureComponent::UpdateDeferredCaptures(FSceneInterface* Scene)
+/** Pairs every bOverride_ flag of FPostProcessSettings with the property it enables. Built once from reflection. */
+struct FCinePostProcessHashLayout
 {
-	UWorld* World = Scene->GetWorld();
-	if (!World || SceneCapturesToUpdateMap.Num() == 0)
+	struct FOverride
 	{
-		return;
-	}
+		const UBoolProperty* Flag;
+		/** Null for the few flags that do not match a property by name. */
+		const UProperty* Value;
+	};
 
-	TArray< TWeakObjectPtr<UCineCameraCaptureComponent> > CinemaCapturesToUpdate;
-	SceneCapturesToUpdateMap.MultiFind(World, CinemaCapturesToUpdate);
-	CinemaCapturesToUpdate.Sort([](const TWeakObjectPtr<UCineCameraCaptureComponent>& A, const TWeakObjectPtr<UCineCameraCaptureComponent>& B)
+	TArray<FOverride> Overrides;
+	/** Properties without an override flag, always hashed. WeightedBlendables is hashed separately. */
+	TArray<const UProperty*> Unconditional;
+
+	FCinePostProcessHashLayout()
 	{
-		if (!A.IsValid())
+		static const TCHAR* OverridePrefix = TEXT("bOverride_");
+		const int32 OverridePrefixLength = FCString::Strlen(OverridePrefix);
+
+		TMap<FName, const UProperty*> Values;
+		TArray<const UBoolProperty*> Flags;
+		for (TFieldIterator<UProperty> It(FPostProcessSettings::StaticStruct()); It; ++It)
 		{
-			return false;
+			const UBoolProperty* BoolProperty = Cast<UBoolProperty>(*It);
+			if (BoolProperty && It->GetName().StartsWith(OverridePrefix))
+			{
+				Flags.Add(BoolProperty);
+			}
+			else if (It->GetFName() != GET_MEMBER_NAME_CHECKED(FPostProcessSettings, WeightedBlendables))
+			{
+				Values.Add(It->GetFName(), *It);
+			}
 		}
-		else if (!B.IsValid())
+
+		for (const UBoolProperty* Flag : Flags)
 		{
-			return true;
+			const FName ValueName(*Flag->GetName().RightChop(OverridePrefixLength));
+			const UProperty* Value = nullptr;
+			Values.RemoveAndCopyValue(ValueName, Value);
+			Overrides.Add({ Flag, Value });
 		}
-		return A->CaptureSortPriority > B->CaptureSortPriority;
-	});
+		Values.GenerateValueArray(Unconditional);
+	}
+};
 
-	for (TWeakObjectPtr<UCineCameraCaptureComponent> Component : CinemaCapturesToUpdate)
+/** Hashes the value of Property in Container member by member, so padding and the heap pointers of containers never get in. */
+static uint32 HashPropertyValue(const UProperty* Property, const void* Container, uint32 Hash)
+{
+	for (int32 ArrayIndex = 0; ArrayIndex < Property->ArrayDim; ++ArrayIndex)
 	{
-		if (Component.IsValid())
+		const void* Value = Property->ContainerPtrToValuePtr<void>(Container, ArrayIndex);
+		if (const UBoolProperty* BoolProperty = Cast<UBoolProperty>(Property))
+		{
+			// Bitfield bools share their byte with their neighbours
+			Hash = HashCombine(Hash, GetTypeHash(BoolProperty->GetPropertyValue(Value)));
+		}
+		else if (const UStructProperty* StructProperty = Cast<UStructProperty>(Property))
+		{
+			for (TFieldIterator<UProperty> It(StructProperty->Struct); It; ++It)
+			{
+				Hash = HashPropertyValue(*It, Value, Hash);
+			}
+		}
+		else if (const UArrayProperty* ArrayProperty = Cast<UArrayProperty>(Property))
+		{
+			FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+			Hash = HashCombine(Hash, GetTypeHash(ArrayHelper.Num()));
+			for (int32 ElementIndex = 0; ElementIndex < ArrayHelper.Num(); ++ElementIndex)
+			{
+				Hash = HashPropertyValue(ArrayProperty->Inner, ArrayHelper.GetRawPtr(ElementIndex), Hash);
+			}
+		}
+		else if (const UObjectPropertyBase* ObjectProperty = Cast<UObjectPropertyBase>(Property))
+		{
+			Hash = HashCombine(Hash, GetTypeHash(ObjectProperty->GetObjectPropertyValue(Value)));
+		}
+		else if (Property->HasAnyPropertyFlags(CPF_IsPlainOldData))
+		{
+			Hash = FCrc::MemCrc32(Value, Property->ElementSize, Hash);
+		}
+		else if (Property->HasAnyPropertyFlags(CPF_HasGetValueTypeHash))
 		{
-			Component->UpdateSceneCaptureContents(Scene);
+			Hash = HashCombine(Hash, Property->GetValueTypeHash(Value));
 		}
 	}
-
-	// All scene captures for this world have been updated
-	SceneCapturesToUpdateMap.Remove(World);
+	return Hash;
 }
 
-void UCineCameraCaptureComponent::UpdateSceneCaptureContents(FSceneInterface* Scene)
+template<typename ParameterType>
+static uint32 HashMaterialParameters(const TArray<ParameterType>& Parameters, uint32 Hash)
 {
-	Scene->UpdateSceneCaptureContents(this);
+	Hash = HashCombine(Hash, GetTypeHash(Parameters.Num()));
+	for (const ParameterType& Parameter : Parameters)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Parameter.ParameterInfo.Name));
+		Hash = HashCombine(Hash, GetTypeHash((uint8)Parameter.ParameterInfo.Association));
+		Hash = HashCombine(Hash, GetTypeHash(Parameter.ParameterInfo.Index));
+		Hash = FCrc::MemCrc32(&Parameter.ParameterValue, sizeof(Parameter.ParameterValue), Hash);
+	}
+	return Hash;
 }
 
-FSceneViewStateInterface* UCineCameraCaptureComponent::GetViewState(int32 ViewIndex)
+/** Hashes what the renderer reads: every override flag, the values of enabled overrides, and the blendables with their parameters. */
+static uint32 HashPostProcessSettings(const FPostProcessSettings& Settings)
 {
-	if (ViewIndex >= ViewStates.Num())
+	static const FCinePostProcessHashLayout Layout;
+
+	uint32 Hash = 0;
+	for (const FCinePostProcessHashLayout::FOverride& Override : Layout.Overrides)
 	{
-		ViewStates.AddZeroed(ViewIndex - ViewStates.Num() + 1);
+		const bool bOverride = Override.Flag->GetPropertyValue_InContainer(&Settings);
+		Hash = HashCombine(Hash, GetTypeHash(bOverride));
+		// Values of disabled overrides are not blended, editing them changes nothing
+		if (bOverride && Override.Value)
+		{
+			Hash = HashPropertyValue(Override.Value, &Settings, Hash);
+		}
 	}
-
-	FSceneViewStateInterface* ViewStateInterface = ViewStates[ViewIndex].GetReference();
-	if ((bCaptureEveryFrame || bAlwaysPersistRenderingState) && ViewStateInterface == NULL)
+	for (const UProperty* Property : Layout.Unconditional)
 	{
-		ViewStates[ViewIndex].Allocate();
-		ViewStateInterface = ViewStates[ViewIndex].GetReference();
+		Hash = HashPropertyValue(Property, &Settings, Hash);
 	}
-	else if (!bCaptureEveryFrame && ViewStateInterface && !bAlwaysPersistRenderingState)
+
+	// Blendables can be edited in place without touching the array itself
+	for (const FWeightedBlendable& Blendable : Settings.WeightedBlendables.Array)
 	{
-		ViewStates[ViewIndex].Destroy();
-		ViewStateInterface = NULL;
+		Hash = HashCombine(Hash, GetTypeHash(Blendable.Object));
+		Hash = HashCombine(Hash, GetTypeHash(Blendable.Weight));
+		if (const UMaterialInstance* MaterialInstance = Cast<UMaterialInstance>(Blendable.Object))
+		{
+			Hash = HashCombine(Hash, GetTypeHash(MaterialInstance->Parent));
+			Hash = HashMaterialParameters(MaterialInstance->ScalarParameterValues, Hash);
+			Hash = HashMaterialParameters(MaterialInstance->VectorParameterValues, Hash);
+			Hash = HashMaterialParameters(MaterialInstance->TextureParameterValues, Hash);
+		}
 	}
-	return ViewStateInterface;
+	return Hash;
 }
 
-void UCineCameraCaptureComponent::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+void UCineCameraCaptureComponent::UpdateLensPostProcessCache()
 {
-	UCineCameraCaptureComponent* This = CastChecked<UCineCameraCaptureComponent>(InThis);
+	// The lens parameters are a handful of floats compared on every call. Post process edits mark the cache dirty where they happen,
+	// the optional autodetect hashes the settings at most once per frame to catch edits made in place
+	const bool bAutoDetect = CVarCineCaptureLensCacheAutoDetect.GetValueOnAnyThread() != 0;
+	bool bDirty = bLensPostProcessDirty
+		|| FMemory::Memcmp(&CachedLensInputs.FilmbackSettings, &FilmbackSettings, sizeof(FilmbackSettings)) != 0
+		|| FMemory::Memcmp(&CachedLensInputs.LensSettings, &LensSettings, sizeof(LensSettings)) != 0
+		|| CachedLensInputs.FocalLength != CurrentFocalLength
+		|| CachedLensInputs.Aperture != CurrentAperture
+		|| CachedLensInputs.FocusMethod != FocusSettings.FocusMethod
+		|| CachedLensInputs.CaptureProfile != CaptureProfile;
+
+	if (!bDirty && bAutoDetect && LensPostProcessValidatedFrame != GFrameCounter)
+	{
+		LensPostProcessValidatedFrame = GFrameCounter;
+		bDirty = HashPostProcessSettings(PostProcessSettings) != CachedLensInputs.PostProcessHash;
+	}
 
-	for (int32 ViewIndex = 0; ViewIndex < This->ViewStates.Num(); ViewIndex++)
+	if (!bDirty)
 	{
-		FSceneViewStateInterface* Ref = This->ViewStates[ViewIndex].GetReference();
-		if (Ref)
-		{
-			Ref->AddReferencedObjects(Collector);
-		}
+		return;
 	}
 
-	Super::AddReferencedObjects(This, Collector);
-}
+	// Clamps the focal length and aperture to the lens, so snapshot the inputs afterwards
+	RecalcDerivedData();
 
-void UCineCameraCaptureComponent::HideComponent(UPrimitiveComponent* InComponent)
-{
-	if (InComponent)
+	CachedLensInputs.FilmbackSettings = FilmbackSettings;
+	CachedLensInputs.LensSettings = LensSettings;
+	CachedLensInputs.FocalLength = CurrentFocalLength;
+	CachedLensInputs.Aperture = CurrentAperture;
+	CachedLensInputs.FocusMethod = FocusSettings.FocusMethod;
+	CachedLensInputs.CaptureProfile = CaptureProfile;
+	if (bAutoDetect)
+	{
+		CachedLensInputs.PostProcessHash = HashPostProcessSettings(PostProcessSettings);
+		LensPostProcessValidatedFrame = GFrameCounter;
+	}
+	bLensPostProcessDirty = false;
+
+	CameraLensPostProcessSettings = PostProcessSettings;
+
+	if (FocusSettings.FocusMethod == ECameraFocusMethod::None)
+	{
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = false;
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = false;
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = false;
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = false;
+	}
+	else
 	{
-		HiddenComponents.AddUnique(InComponent);
+		// Update focus/DoF
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = true;
+		CameraLensPostProcessSettings.DepthOfFieldMethod = PostProcessSettings.DepthOfFieldMethod;
+
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = true;
+		CameraLensPostProcessSettings.DepthOfFieldFstop = CurrentAperture;
+
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = true;
+		CameraLensPostProcessSettings.DepthOfFieldFocalDistance = CurrentFocusDistance;
+
+		CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = true;
+		CameraLensPostProcessSettings.DepthOfFieldSensorWidth = FilmbackSettings.SensorWidth;
+	}
+
+	FCineCaptureProfiles::ApplyPostProcessOverrides(CaptureProfile, CameraLensPostProcessSettings);
+
+	if (DistortionLUT && DistortionMID)
+	{
+		CameraLensPostProcessSettings.AddBlendable(DistortionMID, 1.0f);
 	}
+
+	++LensPostProcessVersion;
 }
 
-void UCineCameraCaptureComponent::HideActorComponents(AActor* InActor)
+void UCineCameraCaptureComponent::UpdateLensDistortion()
 {
-	if (InActor)
+	// A cache lookup, the LUT is computed on a worker thread the first time a lens and resolution combination shows up
+	UTexture2D* NewLUT = nullptr;
+	const FIntPoint Resolution = GetCaptureTargetSize();
+	if (bApplyLensDistortion && DistortionMaterial && !LensDistortion.IsIdentity() && Resolution.X > 0 && Resolution.Y > 0)
 	{
-		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
-		InActor->GetComponents(PrimitiveComponents);
-		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+		// Offline frames must be distorted with their own focal length, so wait for it there
+		NewLUT = FCineLensDistortion::FindOrRequestLUT(LensDistortion, CurrentFocalLength, FilmbackSettings.SensorWidth, Resolution, FCineCaptureOfflineMode::IsActive());
+		if (!NewLUT)
 		{
-			HiddenComponents.AddUnique(PrimitiveComponents[ComponentIndex]);
+			// Still computing, keep distorting with the previous LUT meanwhile
+			return;
 		}
 	}
+
+	const bool bMaterialChanged = NewLUT && (!DistortionMID || DistortionMID->Parent != DistortionMaterial);
+	if (NewLUT == DistortionLUT && !bMaterialChanged)
+	{
+		return;
+	}
+
+	DistortionLUT = NewLUT;
+	if (bMaterialChanged)
+	{
+		DistortionMID = UMaterialInstanceDynamic::Create(DistortionMaterial, this);
+	}
+	if (DistortionLUT)
+	{
+		DistortionMID->SetTextureParameterValue(FCineLensDistortion::LUTParameterName, DistortionLUT);
+	}
+	MarkLensPostProcessDirty();
 }
 
-void UCineCameraCaptureComponent::ShowOnlyComponent(UPrimitiveComponent* InComponent)
+void UCineCameraCaptureComponent::SetCaptureProfile(ECineCaptureProfile InCaptureProfile)
 {
-	if (InComponent)
+	if (CaptureProfile != InCaptureProfile)
 	{
-		// Backward compatibility - set PrimitiveRenderMode to PRM_UseShowOnlyList if BP / game code tries to add a ShowOnlyComponent
-		PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
-		ShowOnlyComponents.Add(InComponent);
+		CaptureProfile = InCaptureProfile;
+		UpdateShowFlags();
+		MarkLensPostProcessDirty();
 	}
 }
 
-void UCineCameraCaptureComponent::ShowOnlyActorComponents(AActor* InActor)
+void UCineCameraCaptureComponent::SetPostProcessSettings(const FPostProcessSettings& InPostProcessSettings)
 {
-	if (InActor)
+	PostProcessSettings = InPostProcessSettings;
+	MarkLensPostProcessDirty();
+}
+
+void UCineCameraCaptureComponent::MarkLensPostProcessDirty()
+{
+	bLensPostProcessDirty = true;
+}
+
+void UCineCameraCaptureComponent::UpdateDeferredCaptures(FSceneInterface* Scene)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CineCapture_UpdateDeferredCaptures);
+	FCineCaptureScopedTiming ScopedTiming(ECineCaptureTimedScope::UpdateDeferredCaptures);
+	CSV_SCOPED_TIMING_STAT(CineCameraCapture, UpdateDeferredCaptures);
+
+	UCineCameraCaptureRigComponent::UpdateDeferredRigCaptures(Scene);
+
+	FCineRenderTargetPool::Get().Tick();
+	FCineViewStatePool::Get().Tick();
+
+	UWorld* World = Scene->GetWorld();
+	TSharedPtr<FCineCaptureWorldQueue, ESPMode::ThreadSafe>* QueuePtr = World ? SceneCaptureQueues.Find(World) : nullptr;
+	if (!QueuePtr)
 	{
-		// Backward compatibility - set PrimitiveRenderMode to PRM_UseShowOnlyList if BP / game code tries to add a ShowOnlyComponent
-		PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+		return;
+	}
 
-		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
-		InActor->GetComponents(PrimitiveComponents);
-		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+	UpdateBatchedFocusQueries(**QueuePtr);
+
+	if ((*QueuePtr)->PendingCaptures.IsEmpty())
+	{
+		return;
+	}
+
+	// Only used on the game thread, kept around to avoid reallocating every frame
+	static TArray<UCineCameraCaptureComponent*> DequeuedCaptures;
+	static TArray<bool> SkipCapture;
+	static TArray<FIntPoint> CaptureSizes;
+	static TArray<UCineCameraCaptureComponent*> QueuedCaptures;
+	static TArray<FCineCaptureScheduleEntry> ScheduleEntries;
+	static TArray<int32> ScheduledIndices;
+	static TBitArray<> IsScheduled;
+	static TArray<UCineCameraCaptureComponent*> LoggedCaptures;
+	static FCineCaptureScheduler Scheduler;
+	DequeuedCaptures.Reset();
+	QueuedCaptures.Reset();
+	ScheduleEntries.Reset();
+
+	FCineCaptureWorldQueue& Queue = **QueuePtr;
+	TWeakObjectPtr<UCineCameraCaptureComponent> QueuedComponent;
+	while (Queue.PendingCaptures.Dequeue(QueuedComponent))
+	{
+		if (UCineCameraCaptureComponent* Component = QueuedComponent.Get())
 		{
-			ShowOnlyComponents.Add(PrimitiveComponents[ComponentIndex]);
+			DequeuedCaptures.Add(Component);
 		}
 	}
-}
 
-void UCineCameraCaptureComponent::RemoveShowOnlyComponent(UPrimitiveComponent* InComponent)
-{
-	ShowOnlyComponents.Remove(InComponent);
-}
+	// Phase one, on every core: the lens (filmback derived data, lens post process and focus), the change check and the target size.
+	// Every component is queued at most once, so each task only touches its own component
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CineCapture_Prepare);
+		CSV_SCOPED_TIMING_STAT(CineCameraCapture, Prepare);
 
-void UCineCameraCaptureComponent::RemoveShowOnlyActorComponents(AActor* InActor)
-{
-	if (InActor)
+		const float DeltaTime = World->DeltaTimeSeconds;
+		SkipCapture.SetNumUninitialized(DequeuedCaptures.Num());
+		CaptureSizes.SetNumUninitialized(DequeuedCaptures.Num());
+		ParallelFor(DequeuedCaptures.Num(), [DeltaTime](int32 Index)
+		{
+			UCineCameraCaptureComponent* Component = DequeuedCaptures[Index];
+			Component->UpdateCameraLensCapture(DeltaTime);
+			SkipCapture[Index] = Component->ShouldSkipUnchangedCapture();
+			CaptureSizes[Index] = Component->GetCaptureTargetSize();
+		}, !FCineCaptureViewSetup::ShouldBuildInParallel(DequeuedCaptures.Num()));
+	}
+
+	int32 NumSkipped = 0;
+	for (int32 Index = 0; Index < DequeuedCaptures.Num(); ++Index)
 	{
-		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
-		InActor->GetComponents(PrimitiveComponents);
-		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+		UCineCameraCaptureComponent* Component = DequeuedCaptures[Index];
+		if (SkipCapture[Index])
 		{
-			ShowOnlyComponents.Remove(PrimitiveComponents[ComponentIndex]);
+			Component->bQueuedForCapture = false;
+			++NumSkipped;
+		}
+		else
+		{
+			FCineCaptureScheduleEntry& Entry = ScheduleEntries.AddDefaulted_GetRef();
+			Entry.Priority = Component->CaptureSortPriority;
+			Entry.FramesSinceLastCapture = (uint32)Component->GetFramesSinceLastCapture();
+			Entry.MaxStalenessFrames = (uint32)FMath::Max(Component->MaxStalenessFrames, 0);
+			Entry.PixelCost = (int64)CaptureSizes[Index].X * CaptureSizes[Index].Y;
+			QueuedCaptures.Add(Component);
 		}
 	}
-}
 
-void UCineCameraCaptureComponent::ClearShowOnlyComponents(UPrimitiveComponent* InComponent)
-{
-	ShowOnlyComponents.Reset();
-}
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CineCapture_Schedule);
+		CSV_SCOPED_TIMING_STAT(CineCameraCapture, Schedule);
 
-void UCineCameraCaptureComponent::ClearHiddenComponents()
+		Scheduler.MaxCapturesPerFrame = CVarCineCaptureMaxCapturesPerFrame.GetValueOnGameThread();
+		Scheduler.MaxPixelsPerFrame = CVarCineCaptureMaxPixelsPerFrame.GetValueOnGameThread();
+		Scheduler.PriorityAgingPerFrame = CVarCineCapturePriorityAging.GetValueOnGameThread();
+		Scheduler.Schedule(ScheduleEntries, ScheduledIndices);
+	}
+
+	IsScheduled.Init(false, QueuedCaptures.Num());
+	for (int32 Index : ScheduledIndices)
+	{
+		IsScheduled[Index] = true;
+	}
+
+	// Captures over budget stay queued (and flagged) for the next frame
+	for (int32 Index = 0; Index < QueuedCaptures.Num(); ++Index)
+	{
+		if (!IsScheduled[Index])
+		{
+			Queue.PendingCaptures.Enqueue(QueuedCaptures[Index]);
+		}
+	}
+
+	const int32 NumDeferred = QueuedCaptures.Num() - ScheduledIndices.Num();
+	INC_DWORD_STAT_BY(STAT_CineCapture_NumCaptures, ScheduledIndices.Num());
+	INC_DWORD_STAT_BY(STAT_CineCapture_NumSkipped, NumSkipped);
+	INC_DWORD_STAT_BY(STAT_CineCapture_NumDeferred, NumDeferred);
+	CSV_CUSTOM_STAT(CineCameraCapture, Captures, ScheduledIndices.Num(), ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(CineCameraCapture, SkippedCaptures, NumSkipped, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(CineCameraCapture, DeferredCaptures, NumDeferred, ECsvCustomStatOp::Accumulate);
+
+	// Also on every core, now that the schedule is known: the camera pose of each scheduled capture that logs metadata.
+	// The view itself is set up by the renderer from the component, so there is nothing else worth building ahead
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CineCapture_PrepareMetadata);
+		CSV_SCOPED_TIMING_STAT(CineCameraCapture, PrepareMetadata);
+
+		LoggedCaptures.Reset();
+		for (int32 Index : ScheduledIndices)
+		{
+			if (QueuedCaptures[Index]->bEnableMetadataLog)
+			{
+				LoggedCaptures.Add(QueuedCaptures[Index]);
+			}
+		}
+		ParallelFor(LoggedCaptures.Num(), [](int32 Index)
+		{
+			UCineCameraCaptureComponent* Component = LoggedCaptures[Index];
+			Component->BuildMetadataPose(Component->PreparedMetadataPose);
+			Component->bHasPreparedMetadataPose = true;
+		}, !FCineCaptureViewSetup::ShouldBuildInParallel(LoggedCaptures.Num()));
+	}
+
+	// Phase two, on the game thread: submission in CaptureSortPriority order
+	SCOPE_CYCLE_COUNTER(STAT_CineCapture_Dispatch);
+	CSV_SCOPED_TIMING_STAT(CineCameraCapture, Dispatch);
+	for (int32 Order = 0; Order < ScheduledIndices.Num(); ++Order)
+	{
+		UCineCameraCaptureComponent* Component = QueuedCaptures[ScheduledIndices[Order]];
+		Component->bQueuedForCapture = false;
+		Component->LastCaptureFrameNumber = GFrameCounter;
+		if (Component->bCaptureOnlyWhenChanged)
+		{
+			Component->LastCapturedStateHash = Component->PendingCaptureStateHash;
+			Component->bHasCapturedState = true;
+			Component->bForceCaptureOnChange = false;
+		}
+		Component->UpdateSceneCaptureContents(Scene);
+		Component->bHasPreparedMetadataPose = false;
+	}
+
+	// All scene captures for this world have been updated, drop queues nobody else references anymore
+	for (auto It = SceneCaptureQueues.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || (It.Value().IsUnique() && It.Value()->PendingCaptures.IsEmpty()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+uint32 UCineCameraCaptureComponent::ComputeCaptureStateHash() const
+{
+	const FTransform& Transform = GetComponentTransform();
+	const FVector Location = Transform.GetLocation();
+	const FQuat Rotation = Transform.GetRotation();
+	const FVector Scale = Transform.GetScale3D();
+
+	uint32 Hash = FCrc::MemCrc32(&Location, sizeof(Location));
+	Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+	Hash = FCrc::MemCrc32(&Scale, sizeof(Scale), Hash);
+
+	// Lens
+	Hash = FCrc::MemCrc32(&FilmbackSettings, sizeof(FilmbackSettings), Hash);
+	Hash = FCrc::MemCrc32(&LensSettings, sizeof(LensSettings), Hash);
+	Hash = FCrc::MemCrc32(&CurrentFocalLength, sizeof(CurrentFocalLength), Hash);
+	Hash = FCrc::MemCrc32(&CurrentAperture, sizeof(CurrentAperture), Hash);
+	Hash = FCrc::MemCrc32(&CurrentFocusDistance, sizeof(CurrentFocusDistance), Hash);
+
+	// View setup
+	Hash = FCrc::MemCrc32(&ShowFlags, sizeof(ShowFlags), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(TextureTarget));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)CaptureSource));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)CompositeMode));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)ProjectionType));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)PrimitiveRenderMode));
+	Hash = HashCombine(Hash, GetTypeHash(LODDistanceFactor));
+	Hash = HashCombine(Hash, GetTypeHash(MaxViewDistanceOverride));
+	if (bUseCustomProjectionMatrix)
+	{
+		Hash = FCrc::MemCrc32(&CustomProjectionMatrix, sizeof(CustomProjectionMatrix), Hash);
+	}
+	if (bEnableClipPlane)
+	{
+		Hash = FCrc::MemCrc32(&ClipPlaneBase, sizeof(ClipPlaneBase), Hash);
+		Hash = FCrc::MemCrc32(&ClipPlaneNormal, sizeof(ClipPlaneNormal), Hash);
+	}
+
+	// Primitive lists, the component lists can be huge so only their versions are hashed
+	Hash = HashCombine(Hash, HiddenComponentSet.GetVersion());
+	Hash = HashCombine(Hash, HiddenComponents.Num());
+	Hash = HashCombine(Hash, ShowOnlyComponentSet.GetVersion());
+	Hash = HashCombine(Hash, ShowOnlyComponents.Num());
+	for (const AActor* Actor : HiddenActors)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Actor));
+	}
+	for (const AActor* Actor : ShowOnlyActors)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Actor));
+	}
+
+	return Hash;
+}
+
+bool UCineCameraCaptureComponent::ShouldSkipUnchangedCapture()
+{
+	if (!bCaptureOnlyWhenChanged || TiledCapture.IsValid())
+	{
+		return false;
+	}
+
+	// Remembered until the capture is dispatched, captures deferred by the budget are re-evaluated next frame
+	PendingCaptureStateHash = ComputeCaptureStateHash();
+	return bHasCapturedState && !bForceCaptureOnChange && PendingCaptureStateHash == LastCapturedStateHash;
+}
+
+void UCineCameraCaptureComponent::MarkCaptureDirty()
+{
+	bForceCaptureOnChange = true;
+	CaptureSceneDeferred();
+}
+
+void UCineCameraCaptureComponent::UpdateBatchedFocusQueries(FCineCaptureWorldQueue& Queue)
+{
+	if (Queue.PendingFocusQueries.IsEmpty())
+	{
+		return;
+	}
+
+	static TArray<UCineCameraCaptureComponent*> FocusQueries;
+	FocusQueries.Reset();
+
+	TWeakObjectPtr<UCineCameraCaptureComponent> QueuedComponent;
+	while (Queue.PendingFocusQueries.Dequeue(QueuedComponent))
+	{
+		UCineCameraCaptureComponent* Component = QueuedComponent.Get();
+		if (Component)
+		{
+			Component->bFocusQueryQueued = false;
+			FocusQueries.Add(Component);
+		}
+	}
+
+	// Everything has been updated for this frame, so nothing moves while the queries read transforms.
+	// Results are picked up by next frame's UpdateCameraLensCapture() and go through the usual focus smoothing.
+	ParallelFor(FocusQueries.Num(), [](int32 Index)
+	{
+		UCineCameraCaptureComponent* Component = FocusQueries[Index];
+		Component->BatchedFocusDistance = Component->GetDesiredFocusDistance(Component->GetComponentLocation());
+		Component->bHasBatchedFocusDistance = true;
+	}, FocusQueries.Num() < 16);
+}
+
+int32 UCineCameraCaptureComponent::GetFramesSinceLastCapture() const
+{
+	return (int32)FMath::Min<uint64>(GFrameCounter - LastCaptureFrameNumber, MAX_int32);
+}
+
+/** Resolution scale granularity, keeps render target reallocations rare. */
+static const float AdaptiveScaleStep = 1.0f / 16.0f;
+
+/** Frames to wait after a resolution change so the smoothed GPU time reflects the new size. */
+static const uint64 AdaptiveSettleFrames = 30;
+
+/** Grow only if the predicted GPU time at the next step stays below this fraction of the budget, otherwise the scale would oscillate around it. */
+static const float AdaptiveGrowHeadroom = 0.9f;
+
+void UCineCameraCaptureComponent::UpdateAdaptiveQuality()
+{
+	// Suspended offline, GPU timings would make the output depend on the machine
+	const bool bAdaptive = bAdaptiveQuality && !FCineCaptureOfflineMode::IsActive();
+	if (AdaptiveTarget.IsValid() && (!bAdaptive || AdaptiveTarget.Get() != TextureTarget))
+	{
+		RestoreAdaptiveQuality();
+	}
+	if (!bAdaptive || !TextureTarget)
+	{
+		return;
+	}
+
+	if (!AdaptiveTarget.IsValid())
+	{
+		AdaptiveTarget = TextureTarget;
+		AdaptiveNativeSize = FIntPoint(TextureTarget->SizeX, TextureTarget->SizeY);
+		AdaptiveBaseLODDistanceFactor = LODDistanceFactor;
+		AdaptiveResolutionScale = 1.0f;
+		AdaptiveLastChangeFrame = GFrameCounter;
+	}
+
+	const float MinScale = FMath::Clamp(AdaptiveMinResolutionScale, 0.1f, 1.0f);
+	const float MaxScale = FMath::Clamp(AdaptiveMaxResolutionScale, MinScale, 1.0f);
+	const float GPUMs = CaptureTimer.IsValid() ? CaptureTimer->GetGPUMs() : 0.0f;
+	if (GPUMs <= 0.0f || GFrameCounter - AdaptiveLastChangeFrame < AdaptiveSettleFrames)
+	{
+		return;
+	}
+
+	// GPU time roughly follows the pixel count, so the square of the scale
+	const float BudgetMs = FMath::Max(AdaptiveGPUBudgetMs, 0.01f);
+	float NewScale = AdaptiveResolutionScale;
+	if (GPUMs > BudgetMs)
+	{
+		NewScale = FMath::FloorToFloat(AdaptiveResolutionScale * FMath::Sqrt(BudgetMs / GPUMs) / AdaptiveScaleStep) * AdaptiveScaleStep;
+	}
+	else
+	{
+		const float GrowScale = AdaptiveResolutionScale + AdaptiveScaleStep;
+		if (GPUMs * FMath::Square(GrowScale / AdaptiveResolutionScale) < BudgetMs * AdaptiveGrowHeadroom)
+		{
+			NewScale = GrowScale;
+		}
+	}
+
+	NewScale = FMath::Clamp(NewScale, MinScale, MaxScale);
+	if (NewScale != AdaptiveResolutionScale)
+	{
+		ApplyAdaptiveResolutionScale(NewScale);
+	}
+}
+
+void UCineCameraCaptureComponent::ApplyAdaptiveResolutionScale(float Scale)
+{
+	AdaptiveResolutionScale = Scale;
+	AdaptiveLastChangeFrame = GFrameCounter;
+
+	UTextureRenderTarget2D* Target = AdaptiveTarget.Get();
+	const int32 SizeX = FMath::Max(FMath::RoundToInt(AdaptiveNativeSize.X * Scale), 1);
+	const int32 SizeY = FMath::Max(FMath::RoundToInt(AdaptiveNativeSize.Y * Scale), 1);
+	if (Target && (Target->SizeX != SizeX || Target->SizeY != SizeY))
+	{
+		Target->ResizeTarget(SizeX, SizeY);
+	}
+
+	const float MinScale = FMath::Clamp(AdaptiveMinResolutionScale, 0.1f, 1.0f);
+	const float LODAlpha = MinScale < 1.0f ? FMath::Clamp((1.0f - Scale) / (1.0f - MinScale), 0.0f, 1.0f) : 0.0f;
+	LODDistanceFactor = AdaptiveBaseLODDistanceFactor * FMath::Lerp(1.0f, FMath::Max(AdaptiveMaxLODDistanceScale, 1.0f), LODAlpha);
+}
+
+void UCineCameraCaptureComponent::RestoreAdaptiveQuality()
+{
+	if (AdaptiveTarget.IsValid())
+	{
+		ApplyAdaptiveResolutionScale(1.0f);
+	}
+	AdaptiveTarget.Reset();
+	AdaptiveResolutionScale = 1.0f;
+}
+
+FIntPoint UCineCameraCaptureComponent::GetEffectiveResolution() const
+{
+	return GetCaptureTargetSize();
+}
+
+void UCineCameraCaptureComponent::UpdateSceneCaptureContents(FSceneInterface* Scene)
+{
+#if !UE_BUILD_SHIPPING
+	SCOPED_NAMED_EVENT_FSTRING(ProfilingEventName.IsEmpty() ? GetName() : ProfilingEventName, FColor::Cyan);
+#endif
+
+	if (TiledCapture.IsValid())
+	{
+		RenderTiledCaptureTile(Scene);
+		return;
+	}
+
+	const bool bTimed = IsCineCaptureTimingEnabled() || bAdaptiveQuality;
+	if (bTimed && !CaptureTimer.IsValid())
+	{
+		CaptureTimer = MakeShared<FCineCaptureTimer, ESPMode::ThreadSafe>();
+	}
+
+	if (Outputs.Num() > 0)
+	{
+		if (bTimed)
+		{
+			CaptureTimer->BeginCapture();
+		}
+		RenderOutputPasses(Scene);
+		if (bTimed)
+		{
+			CaptureTimer->EndCapture();
+		}
+		AppendMetadataRecord();
+		return;
+	}
+
+	// Pooled targets are lent for this capture only, the readback copy is enqueued before the next borrower renders into it
+	UTextureRenderTarget2D* OwnTarget = TextureTarget;
+	UTextureRenderTarget2D* PooledTarget = nullptr;
+	if (bUsePooledRenderTarget)
+	{
+		FCineRenderTargetPoolKey Key;
+		Key.SizeX = PooledTargetSize.X;
+		Key.SizeY = PooledTargetSize.Y;
+		Key.Format = PooledTargetFormat;
+		PooledTarget = FCineRenderTargetPool::Get().Acquire(Key);
+		TextureTarget = PooledTarget;
+	}
+
+	if (bTimed)
+	{
+		CaptureTimer->BeginCapture();
+		Scene->UpdateSceneCaptureContents(this);
+		CaptureTimer->EndCapture();
+	}
+	else
+	{
+		Scene->UpdateSceneCaptureContents(this);
+	}
+
+	EnqueueReadback();
+	AppendMetadataRecord();
+
+	if (PooledTarget)
+	{
+		TextureTarget = OwnTarget;
+		FCineRenderTargetPool::Get().Release(PooledTarget);
+	}
+}
+
+void UCineCameraCaptureComponent::BuildOutputPasses()
+{
+	if (BuiltOutputs == Outputs && BuiltCaptureSource == CaptureSource)
+	{
+		return;
+	}
+	DestroyOutputPasses();
+	BuiltOutputs = Outputs;
+	BuiltCaptureSource = CaptureSource;
+
+	const FCineCaptureOutputTarget* Color = Outputs.FindByPredicate([](const FCineCaptureOutputTarget& Entry) { return Entry.Output == ECineCaptureOutput::Color; });
+	const FCineCaptureOutputTarget* Depth = Outputs.FindByPredicate([](const FCineCaptureOutputTarget& Entry) { return Entry.Output == ECineCaptureOutput::Depth; });
+
+	// Color and depth share a render when both are requested and the color is scene color anyway, with depth in its alpha.
+	// Other sources have no room for depth, and the GBuffer outputs each need their own render.
+	// Passes that only produce one buffer skip the render features that buffer doesn't see
+	auto AddPass = [this](ECineCaptureOutput Output, ESceneCaptureSource Source, UTextureRenderTarget2D* Target, bool bSplitDepth, ECineCaptureProfile Profile)
+	{
+		FOutputPass& Pass = OutputPasses.AddDefaulted_GetRef();
+		Pass.Output = Output;
+		Pass.Source = Source;
+		Pass.Target = Target;
+		Pass.bSplitDepth = bSplitDepth;
+		Pass.Profile = Profile;
+	};
+
+	const bool bHasColor = Color && Color->Target;
+	const bool bSceneColorSource = CaptureSource == SCS_SceneColorHDR || CaptureSource == SCS_SceneColorHDRNoAlpha || CaptureSource == SCS_SceneColorSceneDepth;
+	const bool bShareDepth = bHasColor && Depth && bSceneColorSource;
+	if (bHasColor)
+	{
+		AddPass(ECineCaptureOutput::Color, bShareDepth ? SCS_SceneColorSceneDepth : CaptureSource.GetValue(), Color->Target, bShareDepth, ECineCaptureProfile::Custom);
+	}
+	if (Depth && Depth->Target && !bShareDepth)
+	{
+		AddPass(ECineCaptureOutput::Depth, SCS_SceneDepth, Depth->Target, false, ECineCaptureProfile::DepthOnly);
+	}
+
+	for (const FCineCaptureOutputTarget& Entry : Outputs)
+	{
+		if (Entry.Target && Entry.Output == ECineCaptureOutput::WorldNormal)
+		{
+			AddPass(Entry.Output, SCS_Normal, Entry.Target, false, ECineCaptureProfile::Normals);
+		}
+		else if (Entry.Target && Entry.Output == ECineCaptureOutput::BaseColor)
+		{
+			AddPass(Entry.Output, SCS_BaseColor, Entry.Target, false, ECineCaptureProfile::Normals);
+		}
+		else if (Entry.Target && Entry.Output == ECineCaptureOutput::Segmentation)
+		{
+			// Post process materials only run for the LDR final color
+			AddPass(Entry.Output, SCS_FinalColorLDR, Entry.Target, false, ECineCaptureProfile::Segmentation);
+		}
+	}
+}
+
+void UCineCameraCaptureComponent::RenderOutputPasses(FSceneInterface* Scene)
+{
+	BuildOutputPasses();
+
+	const TEnumAsByte<ESceneCaptureSource> OwnSource = CaptureSource;
+	UTextureRenderTarget2D* OwnTarget = TextureTarget;
+	const FEngineShowFlags OwnShowFlags = ShowFlags;
+	const bool bCameraCut = bCameraCutThisFrame;
+
+	for (int32 PassIndex = 0; PassIndex < OutputPasses.Num(); ++PassIndex)
+	{
+		FOutputPass& Pass = OutputPasses[PassIndex];
+		if (Pass.Output == ECineCaptureOutput::Segmentation)
+		{
+			RenderSegmentationPass(Scene, Pass);
+			continue;
+		}
+
+		CaptureSource = Pass.Source;
+		TextureTarget = Pass.Target;
+		bCameraCutThisFrame = bCameraCut;
+		if (Pass.Profile != ECineCaptureProfile::Custom)
+		{
+			FCineCaptureProfiles::ApplyShowFlags(Pass.Profile, ShowFlags);
+		}
+
+		// The first pass keeps the component's temporal history, the others must not mix theirs into it
+		if (PassIndex > 0)
+		{
+			SwapPassViewStates(Pass);
+		}
+		Scene->UpdateSceneCaptureContents(this);
+		if (PassIndex > 0)
+		{
+			SwapPassViewStates(Pass);
+		}
+		ShowFlags = OwnShowFlags;
+
+		// The color output stands in for TextureTarget, so async readback, the frame sink and shared memory export read it
+		if (Pass.Output == ECineCaptureOutput::Color)
+		{
+			EnqueueReadback();
+		}
+
+		if (OnCaptureOutputReady.IsBound())
+		{
+			if (!Pass.Readback.IsValid())
+			{
+				Pass.Readback = MakeShared<FCineCaptureReadback, ESPMode::ThreadSafe>(FMath::Clamp(ReadbackRingSize, 1, 8));
+			}
+			Pass.Readback->EnqueueCopy(Pass.Target, GFrameCounter, FCineCaptureOfflineMode::IsActive());
+		}
+	}
+
+	CaptureSource = OwnSource;
+	TextureTarget = OwnTarget;
+}
+
+void UCineCameraCaptureComponent::UpdateOutputReadbacks()
+{
+	for (FOutputPass& Pass : OutputPasses)
+	{
+		if (Pass.Output == ECineCaptureOutput::Segmentation)
+		{
+			UpdateSegmentationReadbacks(Pass);
+			continue;
+		}
+		if (!Pass.Readback.IsValid())
+		{
+			continue;
+		}
+
+		Pass.Readback->Poll();
+
+		FCineCaptureFrame Frame;
+		while (Pass.Readback->DequeueFrame(Frame))
+		{
+			OnCaptureOutputReady.Broadcast(Pass.Output, Frame);
+
+			if (Pass.bSplitDepth)
+			{
+				if (!OutputBufferPool.IsValid())
+				{
+					OutputBufferPool = MakeShared<FCineCaptureBufferPool, ESPMode::ThreadSafe>();
+				}
+
+				FCineCaptureFrame DepthFrame;
+				DepthFrame.FrameNumber = Frame.FrameNumber;
+				DepthFrame.Width = Frame.Width;
+				DepthFrame.Height = Frame.Height;
+				DepthFrame.Stride = Frame.Width * sizeof(float);
+				DepthFrame.PixelFormat = PF_R32_FLOAT;
+				DepthFrame.Data = OutputBufferPool->Acquire(DepthFrame.Stride * DepthFrame.Height);
+				if (FCinePixelConversion::ConvertFrame(Frame, ECineReadbackFormat::DepthFloat, *DepthFrame.Data, FCinePixelConversion::GetOptionsForSource(SCS_SceneColorSceneDepth)))
+				{
+					OnCaptureOutputReady.Broadcast(ECineCaptureOutput::Depth, DepthFrame);
+				}
+			}
+		}
+
+		if (!OnCaptureOutputReady.IsBound() && Pass.Readback->GetNumInFlight() == 0 && Pass.Readback->GetNumCompleted() == 0)
+		{
+			Pass.Readback.Reset();
+		}
+	}
+}
+
+void UCineCameraCaptureComponent::RenderSegmentationPass(FSceneInterface* Scene, FOutputPass& Pass)
+{
+	UWorld* World = GetWorld();
+	UCineSegmentationSubsystem* Segmentation = World ? World->GetSubsystem<UCineSegmentationSubsystem>() : nullptr;
+	if (!Segmentation || !SegmentationMaterial || !OnCaptureOutputReady.IsBound())
+	{
+		return;
+	}
+
+	const TEnumAsByte<ESceneCaptureSource> OwnSource = CaptureSource;
+	UTextureRenderTarget2D* OwnTarget = TextureTarget;
+	const FPostProcessSettings OwnPostProcess = CameraLensPostProcessSettings;
+	CaptureSource = Pass.Source;
+	TextureTarget = Pass.Target;
+	SwapPassViewStates(Pass);
+
+	// Only the material's output matters, nothing else of the lens post process
+	const FEngineShowFlags OwnShowFlags = ShowFlags;
+	FCineCaptureProfiles::ApplyShowFlags(Pass.Profile, ShowFlags);
+	CameraLensPostProcessSettings.WeightedBlendables.Array.Reset();
+	CameraLensPostProcessSettings.AddBlendable(SegmentationMaterial, 1.0f);
+
+	FOutputPass::FPendingSegmentation& Pending = Pass.PendingSegmentation.AddDefaulted_GetRef();
+	Pending.FrameNumber = GFrameCounter;
+	const int32 NumIdBits = Segmentation->GetNumIdBits();
+	Pending.NumPlanes = NumIdBits > 0 ? NumIdBits + 2 : 1;
+	Pending.Table = Segmentation->GetTable();
+
+	auto EnqueuePlane = [this, &Pass, &Pending](int32 Plane, UTextureRenderTarget2D* Target)
+	{
+		TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe>& PlaneReadback = Pass.PlaneReadbacks[Plane];
+		if (!PlaneReadback.IsValid())
+		{
+			PlaneReadback = MakeShared<FCineCaptureReadback, ESPMode::ThreadSafe>(FMath::Clamp(ReadbackRingSize, 1, 8));
+		}
+		Pending.bValid &= PlaneReadback->EnqueueCopy(Target, GFrameCounter, FCineCaptureOfflineMode::IsActive());
+	};
+
+	// Stencil digits, set on the primitives when their ids were handed out
+	Scene->UpdateSceneCaptureContents(this);
+	EnqueuePlane(0, Pass.Target);
+
+	if (NumIdBits > 0)
+	{
+		// The bits above the digit: a pixel has bit k where only the primitives with bit k, rendered alone, reproduce the scene depth.
+		// Depth renders without jitter, so a surface has the same depth in every one of them
+		CaptureSource = SCS_SceneDepth;
+		ShowFlags = OwnShowFlags;
+		FCineCaptureProfiles::ApplyShowFlags(ECineCaptureProfile::DepthOnly, ShowFlags);
+		ShowFlags.SetAntiAliasing(false);
+		ShowFlags.SetTemporalAA(false);
+
+		FCineRenderTargetPoolKey Key;
+		Key.SizeX = Pass.Target->SizeX;
+		Key.SizeY = Pass.Target->SizeY;
+		Key.Format = RTF_R32f;
+
+		// The scene capture builds its show only list from ShowOnlyComponents and ShowOnlyActors, so the bit lists are swapped in
+		// for their renders and our own lists swapped back right after, neither is copied
+		const ESceneCapturePrimitiveRenderMode OwnRenderMode = PrimitiveRenderMode;
+		TArray<AActor*> OwnShowOnlyActors;
+		for (int32 Plane = 1; Plane < Pending.NumPlanes; ++Plane)
+		{
+			TArray<TWeakObjectPtr<UPrimitiveComponent> >* BitComponents = nullptr;
+			if (Plane > 1)
+			{
+				BitComponents = &Segmentation->GetBitComponents(Plane - 2);
+				PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+				Exchange(ShowOnlyComponents, *BitComponents);
+				Exchange(ShowOnlyActors, OwnShowOnlyActors);
+			}
+
+			UTextureRenderTarget2D* DepthTarget = FCineRenderTargetPool::Get().Acquire(Key);
+			TextureTarget = DepthTarget;
+			Scene->UpdateSceneCaptureContents(this);
+			EnqueuePlane(Plane, DepthTarget);
+			FCineRenderTargetPool::Get().Release(DepthTarget);
+
+			if (BitComponents)
+			{
+				Exchange(ShowOnlyComponents, *BitComponents);
+				Exchange(ShowOnlyActors, OwnShowOnlyActors);
+			}
+		}
+		PrimitiveRenderMode = OwnRenderMode;
+	}
+
+	SwapPassViewStates(Pass);
+	CaptureSource = OwnSource;
+	TextureTarget = OwnTarget;
+	CameraLensPostProcessSettings = OwnPostProcess;
+	ShowFlags = OwnShowFlags;
+}
+
+void UCineCameraCaptureComponent::UpdateSegmentationReadbacks(FOutputPass& Pass)
+{
+	for (int32 Plane = 0; Plane < FOutputPass::MaxSegmentationPlanes; ++Plane)
+	{
+		TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe>& PlaneReadback = Pass.PlaneReadbacks[Plane];
+		if (!PlaneReadback.IsValid())
+		{
+			continue;
+		}
+
+		PlaneReadback->Poll();
+		FCineCaptureFrame Frame;
+		while (PlaneReadback->DequeueFrame(Frame))
+		{
+			FOutputPass::FPendingSegmentation* Pending = Pass.PendingSegmentation.FindByPredicate([&Frame](const FOutputPass::FPendingSegmentation& Entry) { return Entry.FrameNumber == Frame.FrameNumber; });
+			if (Pending && Plane < Pending->NumPlanes)
+			{
+				Pending->Planes[Plane] = MoveTemp(Frame);
+				++Pending->NumReceived;
+			}
+		}
+	}
+
+	// Complete in order; a capture that lost a plane, or that a later one overtook, is dropped
+	while (Pass.PendingSegmentation.Num() > 0)
+	{
+		FOutputPass::FPendingSegmentation& Pending = Pass.PendingSegmentation[0];
+		const bool bComplete = Pending.bValid && Pending.NumReceived == Pending.NumPlanes;
+		const bool bOvertaken = Pass.PendingSegmentation.ContainsByPredicate([](const FOutputPass::FPendingSegmentation& Entry) { return Entry.bValid && Entry.NumReceived == Entry.NumPlanes; });
+		if (!bComplete && Pending.bValid && !bOvertaken && Pass.PendingSegmentation.Num() <= 16)
+		{
+			break;
+		}
+
+		if (bComplete)
+		{
+			const FCineCaptureFrame& Plane0 = Pending.Planes[0];
+			const int32 BytesPerPixel = Plane0.PixelFormat == PF_G8 ? 1 : 4;
+			const int32 ChannelOffset = Plane0.PixelFormat == PF_B8G8R8A8 ? 2 : 0;
+
+			if (!OutputBufferPool.IsValid())
+			{
+				OutputBufferPool = MakeShared<FCineCaptureBufferPool, ESPMode::ThreadSafe>();
+			}
+
+			FCineCaptureFrame IdFrame;
+			IdFrame.FrameNumber = Pending.FrameNumber;
+			IdFrame.Width = Plane0.Width;
+			IdFrame.Height = Plane0.Height;
+			IdFrame.Stride = Plane0.Width * sizeof(uint32);
+			IdFrame.PixelFormat = PF_R32_UINT;
+			IdFrame.Data = OutputBufferPool->Acquire(IdFrame.Stride * IdFrame.Height);
+			IdFrame.SegmentationTable = Pending.Table;
+
+			// The stencil digit, then the bits above it where the bit's depth render matches the scene depth. A 0 digit is the background
+			const int32 NumIdBits = Pending.NumPlanes - 2;
+			const FCineCaptureFrame* Planes = Pending.Planes;
+			uint8* IdData = IdFrame.Data->GetData();
+			ParallelFor(IdFrame.Height, [&](int32 Row)
+			{
+				uint32* Dest = reinterpret_cast<uint32*>(IdData + Row * IdFrame.Stride);
+				const uint8* Digits = Plane0.Data->GetData() + Row * Plane0.Stride;
+				const float* SceneDepths = NumIdBits > 0 ? reinterpret_cast<const float*>(Planes[1].Data->GetData() + Row * Planes[1].Stride) : nullptr;
+				for (int32 Column = 0; Column < IdFrame.Width; ++Column)
+				{
+					const uint8 Digit = Digits[Column * BytesPerPixel + ChannelOffset];
+					uint32 IdBits = 0;
+					for (int32 Bit = 0; Digit != 0 && Bit < NumIdBits; ++Bit)
+					{
+						// Same surface, same depth; the tolerance only absorbs precision differences between the renders
+						const float BitDepth = reinterpret_cast<const float*>(Planes[Bit + 2].Data->GetData() + Row * Planes[Bit + 2].Stride)[Column];
+						if (FMath::Abs(BitDepth - SceneDepths[Column]) <= SceneDepths[Column] * 1e-5f)
+						{
+							IdBits |= 1u << Bit;
+						}
+					}
+					Dest[Column] = UCineSegmentationSubsystem::MakeId(Digit, IdBits);
+				}
+			}, IdFrame.Height < 64);
+
+			OnCaptureOutputReady.Broadcast(ECineCaptureOutput::Segmentation, IdFrame);
+		}
+		Pass.PendingSegmentation.RemoveAt(0, 1, false);
+	}
+}
+
+void UCineCameraCaptureComponent::DestroyOutputPasses()
+{
+	for (FOutputPass& Pass : OutputPasses)
+	{
+		for (FSceneViewStateReference& ViewState : Pass.ViewStates)
+		{
+			ViewState.Destroy();
+		}
+	}
+	OutputPasses.Reset();
+	BuiltOutputs.Reset();
+}
+
+FIntPoint UCineCameraCaptureComponent::GetCaptureTargetSize() const
+{
+	if (Outputs.Num() > 0)
+	{
+		const FCineCaptureOutputTarget* Output = Outputs.FindByPredicate([](const FCineCaptureOutputTarget& Entry) { return Entry.Target != nullptr; });
+		return Output ? FIntPoint(Output->Target->SizeX, Output->Target->SizeY) : FIntPoint::ZeroValue;
+	}
+	if (bUsePooledRenderTarget)
+	{
+		return PooledTargetSize;
+	}
+	return TextureTarget ? FIntPoint(TextureTarget->SizeX, TextureTarget->SizeY) : FIntPoint::ZeroValue;
+}
+
+void UCineCameraCaptureComponent::EnqueueReadback()
+{
+	if (!(bEnableAsyncReadback || bEnableFrameSink || bEnableSharedMemoryExport) || !TextureTarget)
+	{
+		return;
+	}
+
+	const int32 RingSize = FMath::Clamp(ReadbackRingSize, 1, 8);
+	if (!Readback.IsValid() || Readback->GetRingSize() != RingSize)
+	{
+		// Copies in flight on the old ring still complete, their frames are just not delivered
+		Readback = MakeShared<FCineCaptureReadback, ESPMode::ThreadSafe>(RingSize);
+	}
+	Readback->EnqueueCopy(TextureTarget, GFrameCounter, FCineCaptureOfflineMode::IsActive());
+
+	if (bEnableSharedMemoryExport)
+	{
+		// Bounded in case frames are dropped before they are exported
+		if (PendingIntrinsics.Num() >= 16)
+		{
+			PendingIntrinsics.RemoveAt(0, 1, false);
+		}
+		PendingIntrinsics.Emplace(GFrameCounter, GetCaptureIntrinsics(FIntPoint(TextureTarget->SizeX, TextureTarget->SizeY)));
+	}
+}
+
+void UCineCameraCaptureComponent::UpdateReadback()
+{
+	UpdateFrameSink();
+	UpdateOutputReadbacks();
+
+	if (!Readback.IsValid())
+	{
+		return;
+	}
+
+	Readback->Poll();
+
+	if (OnCaptureFrameReady.IsBound() || FrameSink.IsValid() || bEnableSharedMemoryExport)
+	{
+		FCineCaptureFrame Frame;
+		while (Readback->DequeueFrame(Frame))
+		{
+			if (bEnableSharedMemoryExport)
+			{
+				ExportSharedMemoryFrame(Frame);
+			}
+			if (FrameSink.IsValid())
+			{
+				FrameSink->SubmitFrame(Frame);
+			}
+			OnCaptureFrameReady.Broadcast(Frame);
+		}
+	}
+	else
+	{
+		// Nobody is polling fast enough, keep only the newest frames so pooled buffers get recycled
+		FCineCaptureFrame Frame;
+		while (Readback->GetNumCompleted() > Readback->GetRingSize() && Readback->DequeueFrame(Frame))
+		{
+		}
+	}
+
+	if (!bEnableSharedMemoryExport)
+	{
+		SharedMemoryExporter.Reset();
+		PendingIntrinsics.Reset();
+	}
+
+	if (!bEnableAsyncReadback && !bEnableFrameSink && !bEnableSharedMemoryExport && Readback->GetNumInFlight() == 0 && Readback->GetNumCompleted() == 0)
+	{
+		Readback.Reset();
+	}
+}
+
+void UCineCameraCaptureComponent::ExportSharedMemoryFrame(const FCineCaptureFrame& Frame)
+{
+	// Building the default name formats a few strings, so it is only done when the override or the owner changed
+	AActor* Owner = GetOwner();
+	if (SharedMemoryResolvedName.IsEmpty() || SharedMemoryResolvedOwner.Get() != Owner || SharedMemoryResolvedOverride != SharedMemoryName)
+	{
+		const FString BaseName = Owner ? FString::Printf(TEXT("%s_%s"), *Owner->GetName(), *GetName()) : GetName();
+		SharedMemoryResolvedName = !SharedMemoryName.IsEmpty() ? SharedMemoryName : FCineSharedMemoryExporter::MakeName(BaseName);
+		SharedMemoryResolvedOwner = Owner;
+		SharedMemoryResolvedOverride = SharedMemoryName;
+	}
+	const int64 FrameBytes = (int64)Frame.Stride * Frame.Height;
+
+	if (!SharedMemoryExporter.IsValid() || !SharedMemoryExporter->IsCompatible(SharedMemoryResolvedName, SharedMemorySlots, FrameBytes))
+	{
+		SharedMemoryExporter.Reset();
+		SharedMemoryExporter = MakeUnique<FCineSharedMemoryExporter>(SharedMemoryResolvedName, SharedMemorySlots, FrameBytes);
+	}
+
+	FCineCameraIntrinsics Intrinsics = GetCaptureIntrinsics(FIntPoint(Frame.Width, Frame.Height));
+	while (PendingIntrinsics.Num() > 0 && PendingIntrinsics[0].Key <= Frame.FrameNumber)
+	{
+		if (PendingIntrinsics[0].Key == Frame.FrameNumber)
+		{
+			Intrinsics = PendingIntrinsics[0].Value;
+		}
+		PendingIntrinsics.RemoveAt(0, 1, false);
+	}
+
+	SharedMemoryExporter->WriteFrame(Frame, Intrinsics);
+}
+
+FCineCameraIntrinsics UCineCameraCaptureComponent::GetCaptureIntrinsics(const FIntPoint& Resolution) const
+{
+	// The capture's horizontal field of view comes from the sensor width, pixels are square
+	FCineCameraIntrinsics Intrinsics;
+	Intrinsics.FocalLengthX = FilmbackSettings.SensorWidth > 0.f ? CurrentFocalLength / FilmbackSettings.SensorWidth * Resolution.X : 0.f;
+	Intrinsics.FocalLengthY = Intrinsics.FocalLengthX;
+	Intrinsics.PrincipalPointX = Resolution.X * 0.5f;
+	Intrinsics.PrincipalPointY = Resolution.Y * 0.5f;
+	return Intrinsics;
+}
+
+void UCineCameraCaptureComponent::BuildViewSetup(const FIntRect& ViewRect, FCineCaptureViewSetup& OutSetup)
+{
+	const FTransform& Transform = GetComponentTransform();
+	OutSetup.ViewLocation = Transform.GetLocation();
+	// Swizzle from UE's X forward / Z up to the view space the renderer expects
+	OutSetup.ViewRotationMatrix = FInverseRotationMatrix(Transform.Rotator()) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+	OutSetup.WorldToCamera = Transform.ToMatrixNoScale().InverseFast();
+
+	if (bUseCustomProjectionMatrix)
+	{
+		OutSetup.ProjectionMatrix = CustomProjectionMatrix;
+	}
+	else
+	{
+		// FieldOfView is kept in sync with the filmback and focal length by RecalcDerivedData()
+		const float HalfFOV = FMath::Max(0.001f, FieldOfView) * (float)PI / 360.0f;
+		OutSetup.ProjectionMatrix = FReversedZPerspectiveMatrix(HalfFOV, (float)FMath::Max(ViewRect.Width(), 1), (float)FMath::Max(ViewRect.Height(), 1), GNearClippingPlane);
+	}
+
+	OutSetup.ViewRect = ViewRect;
+	OutSetup.FieldOfView = FieldOfView;
+	OutSetup.bCameraCut = bCameraCutThisFrame;
+	OutSetup.Intrinsics = GetCaptureIntrinsics(ViewRect.Size());
+	OutSetup.HiddenPrimitiveIds = GetHiddenPrimitiveIds();
+	OutSetup.ShowOnlyPrimitiveIds = PrimitiveRenderMode == ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList ? GetShowOnlyPrimitiveIds() : nullptr;
+	OutSetup.LensPostProcess = &CameraLensPostProcessSettings;
+	OutSetup.PostProcessBlendWeight = PostProcessBlendWeight;
+}
+
+void UCineCameraCaptureComponent::BuildMetadataPose(FMetadataPose& OutPose) const
+{
+	OutPose.Resolution = GetCaptureTargetSize();
+	OutPose.Intrinsics = GetCaptureIntrinsics(OutPose.Resolution);
+	OutPose.WorldToCamera = GetComponentTransform().ToMatrixNoScale().InverseFast();
+}
+
+void UCineCameraCaptureComponent::AppendMetadataRecord()
+{
+	if (!bEnableMetadataLog)
+	{
+		MetadataLog.Reset();
+		return;
+	}
+
+	// Building the default path formats a few strings, so it is only done when the override or the owner changed
+	AActor* Owner = GetOwner();
+	if (!MetadataLog.IsValid() || MetadataLogResolvedOwner.Get() != Owner || MetadataLogResolvedOverride != MetadataLogPath)
+	{
+		const FString BaseName = Owner ? FString::Printf(TEXT("%s_%s"), *Owner->GetName(), *GetName()) : GetName();
+		const FString Path = !MetadataLogPath.IsEmpty() ? MetadataLogPath : FCineMetadataLog::MakePath(BaseName);
+		MetadataLogResolvedOwner = Owner;
+		MetadataLogResolvedOverride = MetadataLogPath;
+		if (!MetadataLog.IsValid() || MetadataLogRequestedPath != Path)
+		{
+			MetadataLog = FCineMetadataLog::FindOrCreate(Path, MetadataLogCapacity);
+			MetadataLogRequestedPath = Path;
+			MetadataCameraId = GetTypeHash(GetPathName());
+		}
+	}
+
+	if (!bHasPreparedMetadataPose)
+	{
+		BuildMetadataPose(PreparedMetadataPose);
+	}
+	const FIntPoint Resolution = PreparedMetadataPose.Resolution;
+	const FCineCameraIntrinsics& Intrinsics = PreparedMetadataPose.Intrinsics;
+	const FMatrix& WorldToCamera = PreparedMetadataPose.WorldToCamera;
+
+	FCineMetaRecord Record;
+	FMemory::Memzero(Record);
+	Record.CameraId = MetadataCameraId;
+	Record.FrameNumber = GFrameCounter;
+	Record.TimestampNs = FCineMetadataLog::GetTimestampNs();
+	Record.GameTimeSeconds = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+	Record.Width = (uint32)Resolution.X;
+	Record.Height = (uint32)Resolution.Y;
+	Record.Intrinsics[0] = Intrinsics.FocalLengthX;
+	Record.Intrinsics[2] = Intrinsics.PrincipalPointX;
+	Record.Intrinsics[4] = Intrinsics.FocalLengthY;
+	Record.Intrinsics[5] = Intrinsics.PrincipalPointY;
+	Record.Intrinsics[8] = 1.f;
+
+	// Engine matrices transform row vectors, the log stores the column vector form
+	for (int32 Row = 0; Row < 3; ++Row)
+	{
+		for (int32 Column = 0; Column < 3; ++Column)
+		{
+			Record.WorldToCamera[Row * 4 + Column] = WorldToCamera.M[Column][Row];
+		}
+		Record.WorldToCamera[Row * 4 + 3] = WorldToCamera.M[3][Row];
+	}
+
+	Record.FocalLength = CurrentFocalLength;
+	Record.Aperture = CurrentAperture;
+	Record.FocusDistance = CurrentFocusDistance;
+	Record.SensorWidth = FilmbackSettings.SensorWidth;
+	Record.SensorHeight = FilmbackSettings.SensorHeight;
+
+	MetadataLog->Append(Record);
+}
+
+/** Tiles rendered and not written to disk yet, which bounds the memory of a tiled capture. */
+static const int32 MaxTiledCaptureTilesInFlight = 4;
+
+bool UCineCameraCaptureComponent::StartTiledCapture(FIntPoint Resolution, const FString& Filename)
+{
+	if (TiledCapture.IsValid() || Resolution.X <= 0 || Resolution.Y <= 0 || !GetWorld())
+	{
+		return false;
+	}
+
+	TUniquePtr<FTiledCaptureState> State = MakeUnique<FTiledCaptureState>();
+	State->Layout = FCineTiledCaptureLayout(Resolution, TiledCaptureTileSize, TiledCaptureGuardBand);
+	State->TargetFormat = TextureTarget ? TextureTarget->RenderTargetFormat.GetValue() : PooledTargetFormat.GetValue();
+	State->Writer = MakeShared<FCineTiledImageWriter, ESPMode::ThreadSafe>(FPaths::ConvertRelativePathToFull(Filename), Resolution);
+	if (!State->Writer->IsValid())
+	{
+		return false;
+	}
+
+	if (bUseCustomProjectionMatrix)
+	{
+		State->ImageProjection = CustomProjectionMatrix;
+	}
+	else
+	{
+		// FieldOfView is kept in sync with the filmback and focal length by RecalcDerivedData()
+		const float HalfFOV = FMath::Max(0.001f, FieldOfView) * (float)PI / 360.0f;
+		State->ImageProjection = FReversedZPerspectiveMatrix(HalfFOV, (float)Resolution.X, (float)Resolution.Y, GNearClippingPlane);
+	}
+
+	State->ViewTransform = GetComponentTransform();
+
+	UpdateLensPostProcessCache();
+	FPostProcessSettings& PostProcess = State->PostProcess;
+	PostProcess = CameraLensPostProcessSettings;
+
+	// Each tile sees RenderSize / Resolution of the sensor, so circles of confusion keep their size in image pixels
+	const float SensorWidth = PostProcess.bOverride_DepthOfFieldSensorWidth ? PostProcess.DepthOfFieldSensorWidth : FilmbackSettings.SensorWidth;
+	PostProcess.bOverride_DepthOfFieldSensorWidth = true;
+	PostProcess.DepthOfFieldSensorWidth = SensorWidth * State->Layout.GetRenderSize().X / Resolution.X;
+
+	// Effects that depend on the position in the frame would repeat in every tile
+	PostProcess.bOverride_VignetteIntensity = true;
+	PostProcess.VignetteIntensity = 0.f;
+	PostProcess.bOverride_SceneFringeIntensity = true;
+	PostProcess.SceneFringeIntensity = 0.f;
+	if (DistortionMID)
+	{
+		PostProcess.RemoveBlendable(DistortionMID);
+	}
+
+	// Exposure stays where the camera last adapted to instead of following each tile's content
+	PostProcess.bOverride_AutoExposureSpeedUp = true;
+	PostProcess.AutoExposureSpeedUp = 0.f;
+	PostProcess.bOverride_AutoExposureSpeedDown = true;
+	PostProcess.AutoExposureSpeedDown = 0.f;
+
+	TiledCapture = MoveTemp(State);
+	return true;
+}
+
+void UCineCameraCaptureComponent::CancelTiledCapture()
+{
+	if (TiledCapture.IsValid())
+	{
+		TiledCapture->bFailed = true;
+		FinishTiledCapture(false);
+	}
+}
+
+float UCineCameraCaptureComponent::GetTiledCaptureProgress() const
+{
+	return TiledCapture.IsValid() ? (float)TiledCapture->NumTilesRead / TiledCapture->Layout.GetNumTiles() : 0.f;
+}
+
+void UCineCameraCaptureComponent::RenderTiledCaptureTile(FSceneInterface* Scene)
+{
+	// Captures requested by anything else than UpdateTiledCapture() land here too, they must not render past the budget
+	FTiledCaptureState& State = *TiledCapture;
+	if (State.NextTile >= State.Layout.GetNumTiles() || State.bFailed || State.GetNumTilesInFlight() >= MaxTiledCaptureTilesInFlight)
+	{
+		return;
+	}
+	const int32 TileIndex = State.NextTile++;
+
+	FCineRenderTargetPoolKey Key;
+	Key.SizeX = State.Layout.GetRenderSize().X;
+	Key.SizeY = State.Layout.GetRenderSize().Y;
+	Key.Format = State.TargetFormat;
+	UTextureRenderTarget2D* TileTarget = FCineRenderTargetPool::Get().Acquire(Key);
+
+	UTextureRenderTarget2D* OwnTarget = TextureTarget;
+	const FTransform OwnTransform = GetComponentTransform();
+	const bool bOwnUseCustomProjection = bUseCustomProjectionMatrix;
+	const FMatrix OwnProjection = CustomProjectionMatrix;
+	const FPostProcessSettings OwnPostProcess = CameraLensPostProcessSettings;
+	const FEngineShowFlags OwnShowFlags = ShowFlags;
+
+	TextureTarget = TileTarget;
+	SetComponentToWorld(State.ViewTransform);
+	bUseCustomProjectionMatrix = true;
+	CustomProjectionMatrix = State.Layout.GetTileProjection(State.ImageProjection, TileIndex);
+	CameraLensPostProcessSettings = State.PostProcess;
+	// History of the previous tile does not line up with this one
+	ShowFlags.SetTemporalAA(false);
+	ShowFlags.SetMotionBlur(false);
+
+	Scene->UpdateSceneCaptureContents(this);
+
+	TextureTarget = OwnTarget;
+	SetComponentToWorld(OwnTransform);
+	bUseCustomProjectionMatrix = bOwnUseCustomProjection;
+	CustomProjectionMatrix = OwnProjection;
+	CameraLensPostProcessSettings = OwnPostProcess;
+	ShowFlags = OwnShowFlags;
+
+	if (!State.Readback.IsValid())
+	{
+		State.Readback = MakeShared<FCineCaptureReadback, ESPMode::ThreadSafe>(MaxTiledCaptureTilesInFlight);
+	}
+	// The frame number carries the tile index. The budget above leaves a free slot, so waiting for one never stalls, it only guarantees no tile is dropped
+	State.bFailed |= !State.Readback->EnqueueCopy(TileTarget, (uint64)TileIndex, true);
+	FCineRenderTargetPool::Get().Release(TileTarget);
+}
+
+void UCineCameraCaptureComponent::UpdateTiledCapture()
+{
+	if (!TiledCapture.IsValid())
+	{
+		return;
+	}
+
+	FTiledCaptureState& State = *TiledCapture;
+	if (State.Readback.IsValid())
+	{
+		State.Readback->Poll();
+
+		FCineCaptureFrame Frame;
+		while (State.Readback->DequeueFrame(Frame))
+		{
+			const int32 TileIndex = (int32)Frame.FrameNumber;
+			State.Writer->SubmitTile(Frame, State.Layout.GetTileSourceRect(TileIndex), State.Layout.GetTileRect(TileIndex).Min);
+			++State.NumTilesRead;
+		}
+	}
+
+	if (State.bFailed || (State.NumTilesRead == State.Layout.GetNumTiles() && State.Writer->GetNumPendingTiles() == 0))
+	{
+		FinishTiledCapture(!State.bFailed);
+		return;
+	}
+
+	// Render ahead only as far as the readback and the writer keep up
+	if (State.NextTile < State.Layout.GetNumTiles() && State.GetNumTilesInFlight() < MaxTiledCaptureTilesInFlight)
+	{
+		CaptureSceneDeferred();
+	}
+}
+
+void UCineCameraCaptureComponent::FinishTiledCapture(bool bSuccess)
+{
+	const FString Filename = TiledCapture->Writer->GetFilename();
+	bSuccess &= TiledCapture->Writer->Finish();
+	TiledCapture.Reset();
+
+	if (!bSuccess)
+	{
+		IFileManager::Get().Delete(*Filename, false, false, true);
+	}
+	OnTiledCaptureFinished.Broadcast(Filename, bSuccess);
+}
+
+void UCineCameraCaptureComponent::UpdateFrameSink()
+{
+	const FString Directory = !FrameSinkDirectory.IsEmpty() ? FrameSinkDirectory : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CineCapture"));
+	const FString BaseName = GetOwner() ? FString::Printf(TEXT("%s_%s"), *GetOwner()->GetName(), *GetName()) : GetName();
+
+	// Offline every frame has to reach the disk
+	const ECineFrameSinkBackpressure Backpressure = FCineCaptureOfflineMode::IsActive() ? ECineFrameSinkBackpressure::Block : FrameSinkBackpressure;
+
+	if (FrameSink.IsValid() && (!bEnableFrameSink || !FrameSink->IsCompatible(Directory, BaseName, FrameSinkFormat, FrameSinkMaxQueuedFrames, Backpressure)))
+	{
+		FrameSink->Shutdown();
+		FrameSink.Reset();
+	}
+
+	if (bEnableFrameSink && !FrameSink.IsValid())
+	{
+		FrameSink = MakeShared<FCineCameraFrameSink, ESPMode::ThreadSafe>(Directory, BaseName, FrameSinkFormat, FrameSinkMaxQueuedFrames, Backpressure);
+		FrameSink->Start();
+	}
+}
+
+bool UCineCameraCaptureComponent::DequeueCaptureFrame(FCineCaptureFrame& OutFrame)
+{
+	return Readback.IsValid() && Readback->DequeueFrame(OutFrame);
+}
+
+int32 UCineCameraCaptureComponent::GetReadbackQueueDepth() const
+{
+	return Readback.IsValid() ? Readback->GetNumInFlight() : 0;
+}
+
+int32 UCineCameraCaptureComponent::GetReadbackLatencyFrames() const
+{
+	return Readback.IsValid() ? Readback->GetLastLatencyFrames() : 0;
+}
+
+FSceneViewStateInterface* UCineCameraCaptureComponent::GetViewState(int32 ViewIndex)
+{
+	if (ViewIndex >= ViewStates.Num())
+	{
+		ViewStates.AddZeroed(ViewIndex - ViewStates.Num() + 1);
+	}
+
+	FSceneViewStateInterface* ViewStateInterface = ViewStates[ViewIndex].GetReference();
+	if (bCaptureEveryFrame || bAlwaysPersistRenderingState)
+	{
+		if (ViewStateInterface == NULL)
+		{
+			ViewStates[ViewIndex].Allocate();
+			ViewStateInterface = ViewStates[ViewIndex].GetReference();
+		}
+		else if (!bRenderingWithPassViewStates)
+		{
+			// In case persistence was turned back on before the pool destroyed the idle view state
+			FCineViewStatePool::Get().MarkUsed(this, ViewIndex);
+		}
+	}
+	else if (ViewStateInterface)
+	{
+		if (bRenderingWithPassViewStates)
+		{
+			// The pool tracks the component's own view states by index, output pass states never go through it
+			ViewStates[ViewIndex].Destroy();
+		}
+		else
+		{
+			// Not destroyed right away, toggling persistence back on reuses it
+			FCineViewStatePool::Get().MarkIdle(this, ViewIndex);
+		}
+		ViewStateInterface = NULL;
+	}
+	return ViewStateInterface;
+}
+
+void UCineCameraCaptureComponent::SwapPassViewStates(FOutputPass& Pass)
+{
+	Swap(ViewStates, Pass.ViewStates);
+	bRenderingWithPassViewStates = !bRenderingWithPassViewStates;
+}
+
+void UCineCameraCaptureComponent::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	UCineCameraCaptureComponent* This = CastChecked<UCineCameraCaptureComponent>(InThis);
+
+	for (int32 ViewIndex = 0; ViewIndex < This->ViewStates.Num(); ViewIndex++)
+	{
+		FSceneViewStateInterface* Ref = This->ViewStates[ViewIndex].GetReference();
+		if (Ref)
+		{
+			Ref->AddReferencedObjects(Collector);
+		}
+	}
+	for (FOutputPass& Pass : This->OutputPasses)
+	{
+		for (FSceneViewStateReference& ViewState : Pass.ViewStates)
+		{
+			if (FSceneViewStateInterface* Ref = ViewState.GetReference())
+			{
+				Ref->AddReferencedObjects(Collector);
+			}
+		}
+	}
+
+	Super::AddReferencedObjects(This, Collector);
+}
+
+void UCineCameraCaptureComponent::HideComponent(UPrimitiveComponent* InComponent)
+{
+	if (InComponent)
+	{
+		HiddenComponentSet.Add(HiddenComponents, InComponent);
+	}
+}
+
+void UCineCameraCaptureComponent::HideActorComponents(AActor* InActor)
+{
+	if (InActor)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
+		InActor->GetComponents(PrimitiveComponents);
+		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+		{
+			HiddenComponentSet.Add(HiddenComponents, PrimitiveComponents[ComponentIndex]);
+		}
+	}
+}
+
+void UCineCameraCaptureComponent::ShowOnlyComponent(UPrimitiveComponent* InComponent)
+{
+	if (InComponent)
+	{
+		// Backward compatibility - set PrimitiveRenderMode to PRM_UseShowOnlyList if BP / game code tries to add a ShowOnlyComponent
+		PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+		ShowOnlyComponentSet.Add(ShowOnlyComponents, InComponent);
+	}
+}
+
+void UCineCameraCaptureComponent::ShowOnlyActorComponents(AActor* InActor)
+{
+	if (InActor)
+	{
+		// Backward compatibility - set PrimitiveRenderMode to PRM_UseShowOnlyList if BP / game code tries to add a ShowOnlyComponent
+		PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+
+		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
+		InActor->GetComponents(PrimitiveComponents);
+		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+		{
+			ShowOnlyComponentSet.Add(ShowOnlyComponents, PrimitiveComponents[ComponentIndex]);
+		}
+	}
+}
+
+void UCineCameraCaptureComponent::RemoveShowOnlyComponent(UPrimitiveComponent* InComponent)
+{
+	ShowOnlyComponentSet.Remove(ShowOnlyComponents, InComponent);
+}
+
+void UCineCameraCaptureComponent::RemoveShowOnlyActorComponents(AActor* InActor)
+{
+	if (InActor)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
+		InActor->GetComponents(PrimitiveComponents);
+		for (int32 ComponentIndex = 0, NumComponents = PrimitiveComponents.Num(); ComponentIndex < NumComponents; ++ComponentIndex)
+		{
+			ShowOnlyComponentSet.Remove(ShowOnlyComponents, PrimitiveComponents[ComponentIndex]);
+		}
+	}
+}
+
+void UCineCameraCaptureComponent::ClearShowOnlyComponents(UPrimitiveComponent* InComponent)
+{
+	ShowOnlyComponentSet.Reset(ShowOnlyComponents);
+}
+
+void UCineCameraCaptureComponent::ClearHiddenComponents()
+{
+	HiddenComponentSet.Reset(HiddenComponents);
+}
+
+FCinePrimitiveIdSetPtr UCineCameraCaptureComponent::GetHiddenPrimitiveIds()
+{
+	return HiddenComponentSet.GetPrimitiveIds(HiddenComponents);
+}
+
+FCinePrimitiveIdSetPtr UCineCameraCaptureComponent::GetShowOnlyPrimitiveIds()
 {
-	HiddenComponents.Reset();
+	return ShowOnlyComponentSet.GetPrimitiveIds(ShowOnlyComponents);
 }
 
 
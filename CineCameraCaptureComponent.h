@@ -3,12 +3,28 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
 #include "ShowFlags.h"
 #include "Components/SceneCaptureComponent.h"
 #include "CineCameraComponent.h"
+#include "CineCameraCaptureReadback.h"
+#include "CineCameraPrimitiveSet.h"
+#include "CineCameraCaptureStats.h"
+#include "CineCameraFrameSink.h"
+#include "CineCameraCapturePool.h"
+#include "CineCameraSharedMemoryExport.h"
+#include "CineCameraMetadataLog.h"
+#include "CineCameraTiledCapture.h"
+#include "CineCameraCaptureProfiles.h"
+#include "CineCameraCaptureViewSetup.h"
+#include "CineCameraLensDistortion.h"
+#include "CineCameraCaptureOutputs.h"
+#include "CineCameraSegmentation.h"
 #include "CineCameraCaptureComponent.generated.h"
 
 class FSceneViewStateInterface;
+class UCineCameraCaptureRigComponent;
+struct FCineCaptureWorldQueue;
 
 /**
  * 
@@ -18,6 +34,10 @@ class CINEMATICCAMERA_API UCineCameraCaptureComponent : public UCineCameraCompon
 {
 	GENERATED_BODY()
 
+	friend class UCineCameraCaptureRigComponent;
+	friend class FCineViewStatePool;
+	friend struct FCineCaptureTestAccess;
+
 protected:
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
 	virtual void OnRegister() override;
@@ -34,6 +54,8 @@ protected:
 	
 	void UpdateSceneCaptureContents(FSceneInterface* Scene);
 	void UpdateCameraLensCapture(float DeltaTime);
+	/** Rebuilds CameraLensPostProcessSettings if the post process, lens, filmback or focus method changed since it was last built. */
+	void UpdateLensPostProcessCache();
 	/** Update the show flags from our show flags settings (ideally, you'd be able to set this more directly, but currently unable to make FEngineShowFlags a UStruct to use it as a UProperty...) */
 	void UpdateShowFlags();
 	
@@ -44,6 +66,255 @@ protected:
 	*/
 	TArray<FSceneViewStateReference> ViewStates;
 
+	/** Deferred capture queue of the world this component is registered in. Cached on register so enqueueing never has to look it up. */
+	TSharedPtr<FCineCaptureWorldQueue, ESPMode::ThreadSafe> CaptureQueue;
+
+	/** Set by the first CaptureSceneDeferred() of a frame, cleared when UpdateDeferredCaptures() drains the queue. Keeps each component queued at most once. */
+	FThreadSafeBool bQueuedForCapture;
+
+	/** GFrameCounter of the last frame this component was actually captured. */
+	uint64 LastCaptureFrameNumber;
+
+	/** Game time accumulated towards the next CaptureRateHz capture, and the rate the phase offset was assigned for. */
+	double CaptureRateAccumulator;
+	float CaptureRatePhaseHz;
+
+	/** Returns whether a CaptureRateHz capture is due this frame. Without bWantsCapture the capture stays due for a later call instead. */
+	bool UpdateCaptureRate(float DeltaTime, bool bWantsCapture = true);
+
+	/** Set by movement when CaptureRateHz limits bCaptureOnMovement captures. Set from parallel transform updates. */
+	FThreadSafeBool bPendingMovementCapture;
+
+	/** Hash of everything that affects the captured image, as of the last capture. Only maintained when bCaptureOnlyWhenChanged is set. */
+	uint32 LastCapturedStateHash;
+	uint32 PendingCaptureStateHash;
+	bool bHasCapturedState;
+
+	/** Set by MarkCaptureDirty() to capture on the next opportunity even if nothing we track has changed. */
+	bool bForceCaptureOnChange;
+
+	/** Hashes transform, lens, show flags and primitive lists. Two equal hashes mean a capture would produce the same image in an unchanged scene. */
+	uint32 ComputeCaptureStateHash() const;
+
+	/** Set while the component waits in its world's focus query batch. */
+	FThreadSafeBool bFocusQueryQueued;
+
+	/** Focus distance resolved by the last focus query batch, used when bBatchFocusQueries is set. */
+	float BatchedFocusDistance;
+	bool bHasBatchedFocusDistance;
+
+	/** Resolves the focus distance of every component queued in the world's focus batch, in parallel. */
+	static void UpdateBatchedFocusQueries(FCineCaptureWorldQueue& Queue);
+
+	/** Lens inputs CameraLensPostProcessSettings was last built from. */
+	struct FCachedLensInputs
+	{
+		FCameraFilmbackSettings FilmbackSettings;
+		FCameraLensSettings LensSettings;
+		float FocalLength = 0.f;
+		float Aperture = 0.f;
+		ECameraFocusMethod FocusMethod = ECameraFocusMethod::None;
+		ECineCaptureProfile CaptureProfile = ECineCaptureProfile::Custom;
+		uint32 PostProcessHash = 0;
+	};
+	FCachedLensInputs CachedLensInputs;
+
+	/** Forces the next lens update to rebuild CameraLensPostProcessSettings. */
+	bool bLensPostProcessDirty;
+
+	/** GFrameCounter of the last PostProcessSettings change check. */
+	uint64 LensPostProcessValidatedFrame;
+
+	/** GFrameCounter of the last lens update, used to step the lens once per frame in offline capture. */
+	uint64 LastLensUpdateFrame;
+
+	/** O(1) index and cached primitive ids of HiddenComponents / ShowOnlyComponents. */
+	FCinePrimitiveSet HiddenComponentSet;
+	FCinePrimitiveSet ShowOnlyComponentSet;
+
+	/** UV displacement LUT of LensDistortion at the capture resolution, shared with every camera using the same lens. */
+	UPROPERTY(Transient)
+		class UTexture2D* DistortionLUT;
+
+	UPROPERTY(Transient)
+		class UMaterialInstanceDynamic* DistortionMID;
+
+	/**
+	* Picks up the LUT for the current lens and resolution, rebuilding the lens post process if it changed. Game thread only.
+	* While a new LUT is being computed the previous one stays in use, except offline where the LUT is waited for.
+	*/
+	void UpdateLensDistortion();
+
+	/** One scene render producing one or two of Outputs. */
+	struct FOutputPass
+	{
+		ECineCaptureOutput Output;
+		ESceneCaptureSource Source;
+		UTextureRenderTarget2D* Target;
+		/** Depth is in the alpha of this pass' color. */
+		bool bSplitDepth;
+		/** Show flags of the pass on top of the component's, Custom keeps them as they are. */
+		ECineCaptureProfile Profile;
+		TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe> Readback;
+		/** Used instead of ViewStates by every pass but the first. */
+		TArray<FSceneViewStateReference> ViewStates;
+
+		/**
+		* Segmentation only: one readback per render of a capture, the stencil digits first, then when ids need more than the stencil
+		* the scene depth and the depth of every id bit. Also the captures whose renders are still being read back.
+		*/
+		static const int32 MaxSegmentationPlanes = UCineSegmentationSubsystem::MaxIdBits + 2;
+		TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe> PlaneReadbacks[MaxSegmentationPlanes];
+		struct FPendingSegmentation
+		{
+			uint64 FrameNumber = 0;
+			int32 NumPlanes = 0;
+			/** Cleared if a plane could not be read back. */
+			bool bValid = true;
+			FCineSegmentationTablePtr Table;
+			FCineCaptureFrame Planes[MaxSegmentationPlanes];
+			int32 NumReceived = 0;
+		};
+		TArray<FPendingSegmentation> PendingSegmentation;
+	};
+	TArray<FOutputPass> OutputPasses;
+
+	/** Outputs and CaptureSource OutputPasses was built from. */
+	TArray<FCineCaptureOutputTarget> BuiltOutputs;
+	TEnumAsByte<ESceneCaptureSource> BuiltCaptureSource;
+
+	/** Buffers of depth frames split from color. */
+	TSharedPtr<FCineCaptureBufferPool, ESPMode::ThreadSafe> OutputBufferPool;
+
+	/** Swaps the pass' view states in for rendering, and back. The view state pool only ever sees the component's own. */
+	void SwapPassViewStates(FOutputPass& Pass);
+	/** Set while ViewStates holds an output pass' view states. */
+	bool bRenderingWithPassViewStates;
+
+	void BuildOutputPasses();
+	void RenderOutputPasses(FSceneInterface* Scene);
+	void UpdateOutputReadbacks();
+	void RenderSegmentationPass(FSceneInterface* Scene, FOutputPass& Pass);
+
+	void UpdateSegmentationReadbacks(FOutputPass& Pass);
+	void DestroyOutputPasses();
+
+	/** Adaptive quality state. The native size and LOD factor are recorded when adaptive quality takes over the target, and restored when it lets go. */
+	TWeakObjectPtr<class UTextureRenderTarget2D> AdaptiveTarget;
+	FIntPoint AdaptiveNativeSize;
+	float AdaptiveBaseLODDistanceFactor;
+	float AdaptiveResolutionScale;
+	uint64 AdaptiveLastChangeFrame;
+
+	/** Moves the resolution scale towards AdaptiveGPUBudgetMs, called every tick. */
+	void UpdateAdaptiveQuality();
+	void ApplyAdaptiveResolutionScale(float Scale);
+	void RestoreAdaptiveQuality();
+
+	/** Rig rendering this camera as one of its views. While set, the camera is not captured on its own. */
+	TWeakObjectPtr<UCineCameraCaptureRigComponent> OwningRig;
+
+	/** Created with the first frame to export, recreated when the settings change or frames outgrow its slots. */
+	TUniquePtr<FCineSharedMemoryExporter> SharedMemoryExporter;
+	/** Name of SharedMemoryExporter, resolved again only when SharedMemoryName or the owner changes. */
+	FString SharedMemoryResolvedName;
+	FString SharedMemoryResolvedOverride;
+	TWeakObjectPtr<AActor> SharedMemoryResolvedOwner;
+
+	/** Intrinsics of captures whose readback is in flight, by frame number, so exported frames carry the lens they were rendered with. */
+	TArray<TPair<uint64, FCineCameraIntrinsics> > PendingIntrinsics;
+
+	void ExportSharedMemoryFrame(const FCineCaptureFrame& Frame);
+
+	/** Pinhole intrinsics of the current lens at the given resolution. */
+	FCineCameraIntrinsics GetCaptureIntrinsics(const FIntPoint& Resolution) const;
+
+	/** Opened with the first capture to log, shared with every camera logging to the same file. */
+	TSharedPtr<FCineMetadataLog, ESPMode::ThreadSafe> MetadataLog;
+	FString MetadataLogRequestedPath;
+	uint32 MetadataCameraId;
+	/** MetadataLogPath and owner MetadataLogRequestedPath was resolved for, it is only resolved again when either changes. */
+	FString MetadataLogResolvedOverride;
+	TWeakObjectPtr<AActor> MetadataLogResolvedOwner;
+
+	/** Logs the camera state of the capture that was just dispatched. */
+	void AppendMetadataRecord();
+
+	/**
+	* Gathers the view of a capture into ViewRect, for the views UCineCameraCaptureRigComponent adds to its family.
+	* Only touches this component's own state, so setups of different components can be built in parallel. The lens has to be updated beforehand.
+	*/
+	void BuildViewSetup(const FIntRect& ViewRect, FCineCaptureViewSetup& OutSetup);
+
+	/** Camera pose of a capture as the metadata log records it. */
+	struct FMetadataPose
+	{
+		FIntPoint Resolution = FIntPoint::ZeroValue;
+		FCineCameraIntrinsics Intrinsics;
+		FMatrix WorldToCamera = FMatrix::Identity;
+	};
+
+	/** Only touches this component's own state, so poses of different components can be built in parallel. */
+	void BuildMetadataPose(FMetadataPose& OutPose) const;
+
+	/** Pose of the capture being submitted, built ahead by UpdateDeferredCaptures() while bHasPreparedMetadataPose is set. */
+	FMetadataPose PreparedMetadataPose;
+	bool bHasPreparedMetadataPose;
+
+	/** A tiled capture in progress, see StartTiledCapture(). */
+	struct FTiledCaptureState
+	{
+		FCineTiledCaptureLayout Layout;
+		/** Projection of the whole image, every tile renders a sub-frustum of it. */
+		FMatrix ImageProjection;
+		/** Lens post process frozen at the start, adjusted so every tile matches the whole image. */
+		FPostProcessSettings PostProcess;
+		/** Camera transform at the start, so tiles rendered over several frames see the same view even if the camera moves. */
+		FTransform ViewTransform;
+		ETextureRenderTargetFormat TargetFormat;
+		int32 NextTile = 0;
+		int32 NumTilesRead = 0;
+		bool bFailed = false;
+		TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe> Readback;
+		TSharedPtr<FCineTiledImageWriter, ESPMode::ThreadSafe> Writer;
+
+		/** Tiles rendered and not written to disk yet. */
+		int32 GetNumTilesInFlight() const
+		{
+			return (Readback.IsValid() ? Readback->GetNumInFlight() + Readback->GetNumCompleted() : 0) + Writer->GetNumPendingTiles();
+		}
+	};
+	TUniquePtr<FTiledCaptureState> TiledCapture;
+
+	/** Renders the next tile instead of the regular capture, unless MaxTiledCaptureTilesInFlight tiles are still on their way to disk. */
+	void RenderTiledCaptureTile(FSceneInterface* Scene);
+
+	/** Hands read back tiles to the writer, requests the next tile once there is room for it and finishes the capture, called every tick. */
+	void UpdateTiledCapture();
+
+	void FinishTiledCapture(bool bSuccess);
+
+	/** Async readback of TextureTarget, created on first use when bEnableAsyncReadback is set. */
+	TSharedPtr<FCineCaptureReadback, ESPMode::ThreadSafe> Readback;
+
+	/** Queues a readback of what the capture just rendered into TextureTarget. */
+	void EnqueueReadback();
+
+	/** Maps finished readbacks and hands completed frames to the frame sink and OnCaptureFrameReady. */
+	void UpdateReadback();
+
+	/** Creates, recreates or shuts down FrameSink to match the frame sink settings. */
+	void UpdateFrameSink();
+
+	/** Streams read back frames to disk while bEnableFrameSink is set. */
+	TSharedPtr<FCineCameraFrameSink, ESPMode::ThreadSafe> FrameSink;
+
+	/** Render thread and GPU timing of this component's captures, created when r.CineCapture.TrackCaptureTimes is enabled. */
+	TSharedPtr<FCineCaptureTimer, ESPMode::ThreadSafe> CaptureTimer;
+
+	/** Returns true if a queued capture should be skipped because bCaptureOnlyWhenChanged is set and nothing changed since the last capture. */
+	bool ShouldSkipUnchangedCapture();
+
 public:
 	UCineCameraCaptureComponent();
 
@@ -59,15 +330,120 @@ public:
 		TArray<FEngineShowFlagsSetting> ShowFlagSettings;
 
 	FEngineShowFlags ShowFlags;
+
+	/** Strips the render features the output doesn't need. ShowFlagSettings still apply on top. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SceneCapture)
+		ECineCaptureProfile CaptureProfile;
 	/** Indicates which stereo pass this component is capturing for, if any */
 	EStereoscopicPass CaptureStereoPass;
 
+	/** PostProcessSettings with the lens' depth of field applied. Only rebuilt when its inputs change, see LensPostProcessVersion. */
 	FPostProcessSettings CameraLensPostProcessSettings;
 
+	/** Incremented every time CameraLensPostProcessSettings is rebuilt (focus distance updates excluded). */
+	uint32 LensPostProcessVersion;
+
 	/** Controls what primitives get rendered into the scene capture. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
 		ESceneCapturePrimitiveRenderMode PrimitiveRenderMode;
 
+	/**
+	* Whether to resolve the desired focus distance in a parallel batch with every other capture of the world at the end of the frame, instead of on each capture.
+	* The focus distance lags one frame behind, which FocusSmoothingInterpSpeed smooths over. Mostly useful with tracking focus and many cameras.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Current Camera Settings")
+		bool bBatchFocusQueries;
+
+	/** Whether to read back TextureTarget to the CPU after every capture, see OnCaptureFrameReady and DequeueCaptureFrame(). Readbacks never stall; frames are dropped while the ring is full. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Readback)
+		bool bEnableAsyncReadback;
+
+	/** Number of readbacks that can be in flight at once. Higher values tolerate more GPU latency at the cost of staging memory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Readback, meta = (ClampMin = "1", ClampMax = "8", editcondition = "bEnableAsyncReadback"))
+		int32 ReadbackRingSize;
+
+	/** Whether to stream every captured frame to disk. Reads TextureTarget back asynchronously even if bEnableAsyncReadback is off. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FrameSink)
+		bool bEnableFrameSink;
+
+	/** Directory frames are written to, defaults to Saved/CineCapture. Files are named <Owner>_<Component>_<Index>. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FrameSink, meta = (editcondition = "bEnableFrameSink"))
+		FString FrameSinkDirectory;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FrameSink, meta = (editcondition = "bEnableFrameSink"))
+		ECineFrameSinkFormat FrameSinkFormat;
+
+	/** Maximum number of frames being encoded or waiting to be written. Bounds the memory the sink can hold on to. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FrameSink, meta = (ClampMin = "1", editcondition = "bEnableFrameSink"))
+		int32 FrameSinkMaxQueuedFrames;
+
+	/** What happens to new frames while FrameSinkMaxQueuedFrames frames are queued. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FrameSink, meta = (editcondition = "bEnableFrameSink"))
+		ECineFrameSinkBackpressure FrameSinkBackpressure;
+
+	/** Whether to publish every read back frame into a shared memory ring for other local processes, see CineCameraSharedMemoryReader.h. Linux and Mac only. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SharedMemory)
+		bool bEnableSharedMemoryExport;
+
+	/** POSIX shared memory name, defaults to /CineCapture_<Owner>_<Component>. Mac limits names to 31 characters. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SharedMemory, meta = (editcondition = "bEnableSharedMemoryExport"))
+		FString SharedMemoryName;
+
+	/** Number of frames the ring holds. Readers slower than this many frames get lapped and have to skip ahead. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SharedMemory, meta = (ClampMin = "1", ClampMax = "64", editcondition = "bEnableSharedMemoryExport"))
+		int32 SharedMemorySlots;
+
+	/** Whether to append the lens and transform of every capture to a memory mapped log, see CineCameraMetadataLogReader.h. Linux and Mac only. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MetadataLog)
+		bool bEnableMetadataLog;
+
+	/** Log file, defaults to <Saved>/CineCapture/<Owner>_<Component>.cinemeta. Cameras with the same path share a log. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MetadataLog, meta = (editcondition = "bEnableMetadataLog"))
+		FString MetadataLogPath;
+
+	/** Number of captures the log has room for, later ones are dropped. The file is sparse until written and shrinks to fit when closed. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MetadataLog, meta = (ClampMin = "1024", editcondition = "bEnableMetadataLog"))
+		int32 MetadataLogCapacity;
+
+	/** Edge length of a tile of StartTiledCapture(), without the guard band. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TiledCapture, meta = (ClampMin = "64", ClampMax = "8192"))
+		int32 TiledCaptureTileSize;
+
+	/** Pixels rendered around every tile and cropped away, so screen space effects like bloom and depth of field line up across tile edges. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = TiledCapture, meta = (ClampMin = "0", ClampMax = "512"))
+		int32 TiledCaptureGuardBand;
+
+	/** Called on the game thread when a tiled capture finished or was cancelled. */
+	FOnCineTiledCaptureFinished OnTiledCaptureFinished;
+
+	/**
+	* Post process material of the Segmentation output. It should replace the tonemapper and output CustomStencil / 255 in red,
+	* so the stencil digit reaches the 8 bit target unchanged. Ids beyond the stencil digit come from depth renders, see UCineSegmentationSubsystem.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		class UMaterialInterface* SegmentationMaterial;
+
+	/** Called on the game thread for every read back frame of every entry of Outputs. Outputs are only read back while this is bound. */
+	FOnCineCaptureOutputReady OnCaptureOutputReady;
+
+	/** Called on the game thread for every read back frame. When nothing is bound, frames are kept for DequeueCaptureFrame() (up to ReadbackRingSize of them). */
+	FOnCineCaptureFrameReady OnCaptureFrameReady;
+
+	/** Whether to distort the capture with LensDistortion, through DistortionMaterial. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		bool bApplyLensDistortion;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion, meta = (editcondition = "bApplyLensDistortion"))
+		FCineLensDistortionModel LensDistortion;
+
+	/**
+	* Post process material applying the distortion: it samples the scene at its UV plus the offset read from the DistortionLUT texture parameter.
+	* The scene is rendered with the undistorted field of view and no overscan, so barrel distortion samples outside the rendered frame near the corners
+	* and those samples are clamped to the border, smearing the edge pixels. The overscan a lens would need is logged when its LUT is computed.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion, meta = (editcondition = "bApplyLensDistortion"))
+		class UMaterialInterface* DistortionMaterial;
+
 	/** Name of the profiling event. */
 	UPROPERTY(EditAnywhere, interp, Category = SceneCapture)
 		FString ProfilingEventName;
@@ -95,6 +471,29 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
 		class UTextureRenderTarget2D* TextureTarget;
 
+	/**
+	* Whether to borrow a render target of PooledTargetSize and PooledTargetFormat from the shared pool for each capture instead of owning TextureTarget.
+	* TextureTarget is only set while the capture is enqueued, so results have to be consumed through async readback or the frame sink.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		bool bUsePooledRenderTarget;
+
+	/**
+	* Outputs to produce per capture. When not empty this replaces CaptureSource and TextureTarget (and bUsePooledRenderTarget).
+	* Color and Depth come from a single scene render when CaptureSource is a scene color source (SceneColorHDR, SceneColorHDRNoAlpha or SceneColorSceneDepth),
+	* otherwise Depth is rendered on its own. WorldNormal and BaseColor each need one more render of the same view, since the renderer
+	* writes a single capture source per render; those renders keep their own temporal history.
+	* Async readback, the frame sink and shared memory export read the Color output in place of TextureTarget, and nothing without one.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		TArray<FCineCaptureOutputTarget> Outputs;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (editcondition = "bUsePooledRenderTarget"))
+		FIntPoint PooledTargetSize;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (editcondition = "bUsePooledRenderTarget"))
+		TEnumAsByte<ETextureRenderTargetFormat> PooledTargetFormat;
+
 	/** Whether to persist the rendering state even if bCaptureEveryFrame==false.  This allows velocities for Motion Blur and Temporal AA to be computed. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (editcondition = "!bCaptureEveryFrame"))
 		bool bAlwaysPersistRenderingState;
@@ -103,6 +502,20 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
 		bool bCaptureEveryFrame;
 
+	/**
+	* If > 0, captures this many times per second of game time at most instead of every frame. Applies to bCaptureEveryFrame and to bCaptureOnMovement,
+	* movement then only captures on the next due frame. Components sharing a rate are phase offset so their captures spread across frames.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (ClampMin = "0", UIMax = "120", editcondition = "bCaptureEveryFrame || bCaptureOnMovement"))
+		float CaptureRateHz;
+
+	/**
+	* Whether to skip queued captures when the transform, lens, show flags and hidden/show-only lists are unchanged since the last capture.
+	* Changes in the scene itself are not detected, call MarkCaptureDirty() when the captured scene is known to have changed.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (DisplayName = "Capture Only When Changed"))
+		bool bCaptureOnlyWhenChanged;
+
 	/** Whether to update the capture's contents on movement.  Disable if you are going to capture manually from blueprint. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
 		bool bCaptureOnMovement;
@@ -149,6 +562,36 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = SceneCapture)
 		int32 CaptureSortPriority;
 
+	/**
+	* If > 0, the capture is rendered once it has waited this many frames, even if that exceeds the per-frame capture budget (r.CineCapture.MaxCapturesPerFrame / r.CineCapture.MaxPixelsPerFrame).
+	* Captures that don't fit the budget are otherwise deferred and gain priority every frame they wait.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (ClampMin = "0"))
+		int32 MaxStalenessFrames;
+
+	/**
+	* Whether to scale the render target resolution and LODDistanceFactor to keep the measured GPU time of this capture within AdaptiveGPUBudgetMs.
+	* TextureTarget is resized in steps of 1/16 of its size when this is enabled, use GetEffectiveResolution() to rescale intrinsics.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AdaptiveQuality)
+		bool bAdaptiveQuality;
+
+	/** GPU time budget of one capture, in milliseconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AdaptiveQuality, meta = (ClampMin = "0.01", editcondition = "bAdaptiveQuality"))
+		float AdaptiveGPUBudgetMs;
+
+	/** Lowest fraction of the native target size adaptive quality may render at. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AdaptiveQuality, meta = (ClampMin = "0.1", ClampMax = "1.0", editcondition = "bAdaptiveQuality"))
+		float AdaptiveMinResolutionScale;
+
+	/** Highest fraction of the native target size adaptive quality may render at. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AdaptiveQuality, meta = (ClampMin = "0.1", ClampMax = "1.0", editcondition = "bAdaptiveQuality"))
+		float AdaptiveMaxResolutionScale;
+
+	/** LODDistanceFactor is multiplied by up to this much as the resolution scale drops to AdaptiveMinResolutionScale. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AdaptiveQuality, meta = (ClampMin = "1.0", editcondition = "bAdaptiveQuality"))
+		float AdaptiveMaxLODDistanceScale;
+
 	/**
 	* True if we did a camera cut this frame. Automatically reset to false at every capture.
 	* This flag affects various things in the renderer (such as whether to use the occlusion queries from last frame, and motion blur).
@@ -192,6 +635,77 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
 		void CaptureScene();
 
+	/** Switches CaptureProfile and updates the show flags and lens post process right away. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void SetCaptureProfile(ECineCaptureProfile InCaptureProfile);
+
+	/** Replaces PostProcessSettings and rebuilds the lens post process on the next capture. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void SetPostProcessSettings(const FPostProcessSettings& InPostProcessSettings);
+
+	/** Call after editing PostProcessSettings in place from code, unless r.CineCapture.LensCacheAutoDetect is enabled. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void MarkLensPostProcessDirty();
+
+	/** Forces the next queued capture to render even if bCaptureOnlyWhenChanged would skip it, e.g. because something moved in front of the camera. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void MarkCaptureDirty();
+
+	/**
+	* Captures an image of any size, beyond the largest render target, as tiles rendered one per frame into a pooled target of TiledCaptureTileSize.
+	* Tiles are stitched into Filename, a Raw frame file (see FCineRawFrameHeader), while the capture runs; only a few tiles are ever held in memory.
+	* The lens and focus are frozen for the duration, the camera should not move. Regular captures of this component pause until it finished.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		bool StartTiledCapture(FIntPoint Resolution, const FString& Filename);
+
+	/** Stops the tiled capture in progress and deletes its partial file. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void CancelTiledCapture();
+
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		bool IsTiledCaptureActive() const { return TiledCapture.IsValid(); }
+
+	/** Fraction of the tiles of the tiled capture in progress that were read back. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		float GetTiledCaptureProgress() const;
+
+	/** Pops the oldest read back frame that wasn't delivered through OnCaptureFrameReady. */
+	bool DequeueCaptureFrame(FCineCaptureFrame& OutFrame);
+
+	/** Readbacks currently waiting on the GPU. */
+	int32 GetReadbackQueueDepth() const;
+
+	/** Latency, in frames, of the last completed readback. */
+	int32 GetReadbackLatencyFrames() const;
+
+	/**
+	* Primitive ids of HiddenComponents, rebuilt only when the list changes. Capture rigs hand the snapshot to their views as is;
+	* a capture of its own is set up by the engine, which resolves HiddenComponents and HiddenActors itself on every capture.
+	*/
+	FCinePrimitiveIdSetPtr GetHiddenPrimitiveIds();
+
+	/** Primitive ids of ShowOnlyComponents, see GetHiddenPrimitiveIds(). */
+	FCinePrimitiveIdSetPtr GetShowOnlyPrimitiveIds();
+
+	/** Timing of this component's captures, null unless r.CineCapture.TrackCaptureTimes or bAdaptiveQuality is enabled. */
+	const FCineCaptureTimer* GetCaptureTimer() const { return CaptureTimer.Get(); }
+
+	/** Number of frames since this component was last rendered by the deferred capture path. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		int32 GetFramesSinceLastCapture() const;
+
+	/** Resolution the capture currently renders at, which differs from the native target size while adaptive quality is scaling it down. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		FIntPoint GetEffectiveResolution() const;
+
+	/** Size of the target the next capture renders into, the pooled size when bUsePooledRenderTarget is set. */
+	FIntPoint GetCaptureTargetSize() const;
+
+	/** Current fraction of the native target size, 1 unless adaptive quality is active. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		float GetAdaptiveResolutionScale() const { return AdaptiveTarget.IsValid() ? AdaptiveResolutionScale : 1.f; }
+
 #if WITH_EDITOR
 	virtual bool CanEditChange(const UProperty* InProperty) const override;
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
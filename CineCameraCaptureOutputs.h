@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CineCameraCaptureReadback.h"
+#include "CineCameraCaptureOutputs.generated.h"
+
+class UTextureRenderTarget2D;
+
+/** An image a capture component can produce besides, or instead of, its single CaptureSource. */
+UENUM(BlueprintType)
+enum class ECineCaptureOutput : uint8
+{
+	/** Scene color as selected by CaptureSource. Carries scene depth in alpha when Depth is requested too and CaptureSource is a scene color source. */
+	Color,
+	/** Scene depth in world units. Split from the color render when that render is scene color, so no extra scene render is needed. */
+	Depth,
+	/** World space normals from the GBuffer. */
+	WorldNormal,
+	/** Base color from the GBuffer. */
+	BaseColor,
+	/**
+	* UCineSegmentationSubsystem instance ids, read back as one uint32 per pixel (PF_R32_UINT) with the id table attached.
+	* Needs SegmentationMaterial. One render up to 255 ids, beyond that a scene depth render plus one depth render per id bit in use.
+	*/
+	Segmentation,
+};
+
+/** One requested output and where it is rendered to. */
+USTRUCT(BlueprintType)
+struct CINEMATICCAMERA_API FCineCaptureOutputTarget
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		ECineCaptureOutput Output = ECineCaptureOutput::Color;
+
+	/** Render target of the output. Depth split from Color has no target of its own, it is only delivered through OnCaptureOutputReady. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		UTextureRenderTarget2D* Target = nullptr;
+
+	bool operator==(const FCineCaptureOutputTarget& Other) const
+	{
+		return Output == Other.Output && Target == Other.Target;
+	}
+};
+
+/** Called on the game thread for every read back frame of every output. */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCineCaptureOutputReady, ECineCaptureOutput, const FCineCaptureFrame&);
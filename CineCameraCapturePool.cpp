@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCapturePool.h"
+#include "CineCameraCaptureComponent.h"
+#include "CineCameraCaptureStats.h"
+#include "SceneManagement.h"
+#include "UObject/Package.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarCineCaptureRenderTargetPoolIdleSeconds(
+	TEXT("r.CineCapture.RenderTargetPool.IdleSeconds"),
+	10.0f,
+	TEXT("Seconds a pooled cine camera capture render target may go unused before it is freed."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarCineCaptureViewStatePoolIdleSeconds(
+	TEXT("r.CineCapture.ViewStatePool.IdleSeconds"),
+	5.0f,
+	TEXT("Seconds the view state of a cine camera capture that stopped persisting rendering state is kept for reuse. 0 destroys it on the next update."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCineCaptureViewStatePoolMaxIdle(
+	TEXT("r.CineCapture.ViewStatePool.MaxIdle"),
+	16,
+	TEXT("Maximum number of idle cine camera capture view states kept for reuse, the least recently used are destroyed first."),
+	ECVF_Default);
+
+FCineRenderTargetPool& FCineRenderTargetPool::Get()
+{
+	static FCineRenderTargetPool Pool;
+	return Pool;
+}
+
+UTextureRenderTarget2D* FCineRenderTargetPool::Acquire(const FCineRenderTargetPoolKey& Key)
+{
+	check(IsInGameThread());
+
+	for (FPooledTarget& Pooled : Targets)
+	{
+		if (!Pooled.bInUse && Pooled.Key == Key)
+		{
+			Pooled.bInUse = true;
+			return Pooled.Target;
+		}
+	}
+
+	UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
+	Target->RenderTargetFormat = Key.Format;
+	Target->ClearColor = FLinearColor::Black;
+	Target->InitAutoFormat(FMath::Max(Key.SizeX, 1), FMath::Max(Key.SizeY, 1));
+	Target->UpdateResourceImmediate(true);
+
+	FPooledTarget& Pooled = Targets.AddDefaulted_GetRef();
+	Pooled.Target = Target;
+	Pooled.Key = Key;
+	Pooled.LastUsedTime = FPlatformTime::Seconds();
+	Pooled.bInUse = true;
+	return Target;
+}
+
+void FCineRenderTargetPool::Release(UTextureRenderTarget2D* Target)
+{
+	check(IsInGameThread());
+
+	for (FPooledTarget& Pooled : Targets)
+	{
+		if (Pooled.Target == Target)
+		{
+			Pooled.bInUse = false;
+			Pooled.LastUsedTime = FPlatformTime::Seconds();
+			return;
+		}
+	}
+}
+
+void FCineRenderTargetPool::Tick()
+{
+	check(IsInGameThread());
+
+	// Dropping the reference is enough, the next GC frees the target and its resource
+	const double ExpireTime = FPlatformTime::Seconds() - CVarCineCaptureRenderTargetPoolIdleSeconds.GetValueOnGameThread();
+	Targets.RemoveAllSwap([ExpireTime](const FPooledTarget& Pooled)
+	{
+		return !Pooled.bInUse && Pooled.LastUsedTime < ExpireTime;
+	});
+
+	SET_DWORD_STAT(STAT_CineCapture_NumPooledTargets, Targets.Num());
+	SET_MEMORY_STAT(STAT_CineCapture_PooledTargetMemory, GetAllocatedBytes());
+}
+
+int32 FCineRenderTargetPool::GetNumInUse() const
+{
+	int32 NumInUse = 0;
+	for (const FPooledTarget& Pooled : Targets)
+	{
+		NumInUse += Pooled.bInUse ? 1 : 0;
+	}
+	return NumInUse;
+}
+
+int64 FCineRenderTargetPool::GetAllocatedBytes() const
+{
+	int64 Bytes = 0;
+	for (const FPooledTarget& Pooled : Targets)
+	{
+		Bytes += Pooled.Target->CalcTextureMemorySizeEnum(TMC_AllMips);
+	}
+	return Bytes;
+}
+
+void FCineRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FPooledTarget& Pooled : Targets)
+	{
+		Collector.AddReferencedObject(Pooled.Target);
+	}
+}
+
+FCineViewStatePool& FCineViewStatePool::Get()
+{
+	static FCineViewStatePool Pool;
+	return Pool;
+}
+
+void FCineViewStatePool::MarkIdle(UCineCameraCaptureComponent* Component, int32 ViewIndex)
+{
+	check(IsInGameThread());
+
+	for (const FIdleViewState& Idle : IdleViewStates)
+	{
+		if (Idle.Component.Get() == Component && Idle.ViewIndex == ViewIndex)
+		{
+			return;
+		}
+	}
+
+	FIdleViewState& Idle = IdleViewStates.AddDefaulted_GetRef();
+	Idle.Component = Component;
+	Idle.ViewIndex = ViewIndex;
+	Idle.IdleSince = FPlatformTime::Seconds();
+}
+
+bool FCineViewStatePool::MarkUsed(UCineCameraCaptureComponent* Component, int32 ViewIndex)
+{
+	check(IsInGameThread());
+
+	for (int32 Index = 0; Index < IdleViewStates.Num(); ++Index)
+	{
+		if (IdleViewStates[Index].Component.Get() == Component && IdleViewStates[Index].ViewIndex == ViewIndex)
+		{
+			// Keep the order, it is the LRU order
+			IdleViewStates.RemoveAt(Index);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FCineViewStatePool::RemoveAll(UCineCameraCaptureComponent* Component)
+{
+	check(IsInGameThread());
+
+	IdleViewStates.RemoveAll([Component](const FIdleViewState& Idle)
+	{
+		return Idle.Component.Get() == Component;
+	});
+}
+
+void FCineViewStatePool::Tick()
+{
+	check(IsInGameThread());
+
+	const double ExpireTime = FPlatformTime::Seconds() - CVarCineCaptureViewStatePoolIdleSeconds.GetValueOnGameThread();
+	const int32 MaxIdle = FMath::Max(CVarCineCaptureViewStatePoolMaxIdle.GetValueOnGameThread(), 0);
+
+	int32 NumExpired = 0;
+	while (NumExpired < IdleViewStates.Num())
+	{
+		const FIdleViewState& Idle = IdleViewStates[NumExpired];
+		if (Idle.Component.IsValid() && Idle.IdleSince >= ExpireTime && IdleViewStates.Num() - NumExpired <= MaxIdle)
+		{
+			break;
+		}
+		Destroy(Idle);
+		++NumExpired;
+	}
+	IdleViewStates.RemoveAt(0, NumExpired, false);
+
+	SET_DWORD_STAT(STAT_CineCapture_NumIdleViewStates, IdleViewStates.Num());
+	SET_MEMORY_STAT(STAT_CineCapture_IdleViewStateMemory, GetIdleBytes());
+}
+
+int64 FCineViewStatePool::GetIdleBytes() const
+{
+	int64 Bytes = 0;
+	for (const FIdleViewState& Idle : IdleViewStates)
+	{
+		UCineCameraCaptureComponent* Component = Idle.Component.Get();
+		if (Component && Component->ViewStates.IsValidIndex(Idle.ViewIndex))
+		{
+			const FSceneViewStateInterface* ViewState = Component->ViewStates[Idle.ViewIndex].GetReference();
+			Bytes += ViewState ? ViewState->GetSizeBytes() : 0;
+		}
+	}
+	return Bytes;
+}
+
+void FCineViewStatePool::Destroy(const FIdleViewState& Idle)
+{
+	UCineCameraCaptureComponent* Component = Idle.Component.Get();
+	if (Component && Component->ViewStates.IsValidIndex(Idle.ViewIndex))
+	{
+		Component->ViewStates[Idle.ViewIndex].Destroy();
+	}
+}
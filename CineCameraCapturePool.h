@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/WeakObjectPtr.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+class UCineCameraCaptureComponent;
+
+/** Size and format a pooled render target is shared by. */
+struct FCineRenderTargetPoolKey
+{
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	ETextureRenderTargetFormat Format = RTF_RGBA16f;
+
+	bool operator==(const FCineRenderTargetPoolKey& Other) const
+	{
+		return SizeX == Other.SizeX && SizeY == Other.SizeY && Format == Other.Format;
+	}
+
+	friend uint32 GetTypeHash(const FCineRenderTargetPoolKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.SizeX), GetTypeHash(Key.SizeY)), GetTypeHash((uint8)Key.Format));
+	}
+};
+
+/**
+ * Render targets lent to capture components with bUsePooledRenderTarget for the duration of one capture.
+ * A target is released as soon as the capture and its readback copy are enqueued, so later captures of the same frame, from this or other
+ * components, reuse it. Render commands run in order, so a reused target is only overwritten after the earlier copy read it.
+ * Memory follows the sizes and formats in use rather than the number of cameras.
+ * Game thread only.
+ */
+class CINEMATICCAMERA_API FCineRenderTargetPool : public FGCObject
+{
+public:
+	static FCineRenderTargetPool& Get();
+
+	/** Returns a free target matching Key, creating one if none is free. Return it with Release() once the capture and its readback are enqueued. */
+	UTextureRenderTarget2D* Acquire(const FCineRenderTargetPoolKey& Key);
+
+	void Release(UTextureRenderTarget2D* Target);
+
+	/** Frees targets that have not been borrowed for r.CineCapture.RenderTargetPool.IdleSeconds and updates the memory stats. */
+	void Tick();
+
+	int32 GetNumTargets() const { return Targets.Num(); }
+	int32 GetNumInUse() const;
+	/** GPU memory of all pooled targets, in use or not. */
+	int64 GetAllocatedBytes() const;
+
+	//~ Begin FGCObject Interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FCineRenderTargetPool"); }
+	//~ End FGCObject Interface
+
+private:
+	struct FPooledTarget
+	{
+		UTextureRenderTarget2D* Target;
+		FCineRenderTargetPoolKey Key;
+		double LastUsedTime;
+		bool bInUse;
+	};
+
+	TArray<FPooledTarget> Targets;
+};
+
+/**
+ * View states of capture components that stopped persisting rendering state (bCaptureEveryFrame and bAlwaysPersistRenderingState both off).
+ * Instead of being destroyed right away they are kept, least recently used first, and reused if persistence is turned back on.
+ * They are destroyed once idle for r.CineCapture.ViewStatePool.IdleSeconds or when more than r.CineCapture.ViewStatePool.MaxIdle are kept.
+ * Game thread only.
+ */
+class CINEMATICCAMERA_API FCineViewStatePool
+{
+public:
+	static FCineViewStatePool& Get();
+
+	/** Called when a component stops using the view state at ViewIndex. */
+	void MarkIdle(UCineCameraCaptureComponent* Component, int32 ViewIndex);
+
+	/** Called when a component uses the view state at ViewIndex again. Returns true if it was idle. */
+	bool MarkUsed(UCineCameraCaptureComponent* Component, int32 ViewIndex);
+
+	/** Forgets all idle view states of Component, which destroys them itself. */
+	void RemoveAll(UCineCameraCaptureComponent* Component);
+
+	/** Destroys view states idle for too long, or over the idle count, and updates the memory stats. */
+	void Tick();
+
+	int32 GetNumIdle() const { return IdleViewStates.Num(); }
+	/** Memory of the idle view states, as far as the renderer reports it. */
+	int64 GetIdleBytes() const;
+
+private:
+	struct FIdleViewState
+	{
+		TWeakObjectPtr<UCineCameraCaptureComponent> Component;
+		int32 ViewIndex;
+		double IdleSince;
+	};
+
+	void Destroy(const FIdleViewState& Idle);
+
+	/** Oldest first. */
+	TArray<FIdleViewState> IdleViewStates;
+};
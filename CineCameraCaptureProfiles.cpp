@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureProfiles.h"
+#include "ShowFlags.h"
+#include "Engine/Scene.h"
+
+namespace CineCaptureProfiles
+{
+	struct FFlag
+	{
+		const TCHAR* Name;
+		bool bEnabled;
+	};
+
+	/** Shared by every profile whose output never sees lighting or post processing. */
+	static const FFlag UnlitFlags[] =
+	{
+		{ TEXT("Lighting"), false },
+		{ TEXT("DirectLighting"), false },
+		{ TEXT("DynamicShadows"), false },
+		{ TEXT("ContactShadows"), false },
+		{ TEXT("CapsuleShadows"), false },
+		{ TEXT("GlobalIllumination"), false },
+		{ TEXT("SkyLighting"), false },
+		{ TEXT("ReflectionEnvironment"), false },
+		{ TEXT("ScreenSpaceReflections"), false },
+		{ TEXT("AmbientOcclusion"), false },
+		{ TEXT("DistanceFieldAO"), false },
+		{ TEXT("SubsurfaceScattering"), false },
+		{ TEXT("Fog"), false },
+		{ TEXT("AtmosphericFog"), false },
+		{ TEXT("VolumetricFog"), false },
+		{ TEXT("LightShafts"), false },
+		{ TEXT("Translucency"), false },
+		{ TEXT("Bloom"), false },
+		{ TEXT("DepthOfField"), false },
+		{ TEXT("MotionBlur"), false },
+		{ TEXT("EyeAdaptation"), false },
+		{ TEXT("LensFlares"), false },
+		{ TEXT("Vignette"), false },
+		{ TEXT("Grain"), false },
+		{ TEXT("SceneColorFringe"), false },
+		{ TEXT("TemporalAA"), false },
+		{ TEXT("AntiAliasing"), false },
+	};
+
+	static const FFlag FinalColorFlags[] =
+	{
+		{ TEXT("Lighting"), true },
+		{ TEXT("PostProcessing"), true },
+		{ TEXT("Translucency"), true },
+		{ TEXT("AntiAliasing"), true },
+	};
+
+	static const FFlag DepthOnlyFlags[] =
+	{
+		{ TEXT("PostProcessing"), false },
+		{ TEXT("Decals"), false },
+	};
+
+	static const FFlag NormalsFlags[] =
+	{
+		{ TEXT("PostProcessing"), false },
+		{ TEXT("Decals"), true },
+	};
+
+	static const FFlag SegmentationFlags[] =
+	{
+		{ TEXT("PostProcessing"), true },
+		{ TEXT("Decals"), false },
+	};
+
+	static const FFlag PreviewFlags[] =
+	{
+		{ TEXT("ScreenSpaceReflections"), false },
+		{ TEXT("DistanceFieldAO"), false },
+		{ TEXT("ContactShadows"), false },
+		{ TEXT("CapsuleShadows"), false },
+		{ TEXT("VolumetricFog"), false },
+		{ TEXT("LightShafts"), false },
+		{ TEXT("DepthOfField"), false },
+		{ TEXT("MotionBlur"), false },
+		{ TEXT("LensFlares"), false },
+	};
+
+	/** Flag indices and values of one profile. */
+	typedef TArray<TPair<uint32, bool> > FResolvedFlags;
+
+	static void Resolve(FResolvedFlags& OutFlags, const FFlag* Flags, int32 NumFlags)
+	{
+		for (int32 Index = 0; Index < NumFlags; ++Index)
+		{
+			// Flags this engine version doesn't have are skipped
+			const int32 FlagIndex = FEngineShowFlags::FindIndexByName(Flags[Index].Name);
+			if (FlagIndex != INDEX_NONE)
+			{
+				OutFlags.Emplace((uint32)FlagIndex, Flags[Index].bEnabled);
+			}
+		}
+	}
+
+	static const FResolvedFlags& GetResolvedFlags(ECineCaptureProfile Profile)
+	{
+		static FResolvedFlags ResolvedFlags[(int32)ECineCaptureProfile::Preview + 1];
+		static bool bResolved = false;
+		if (!bResolved)
+		{
+			bResolved = true;
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::FinalColor], FinalColorFlags, ARRAY_COUNT(FinalColorFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::DepthOnly], UnlitFlags, ARRAY_COUNT(UnlitFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::DepthOnly], DepthOnlyFlags, ARRAY_COUNT(DepthOnlyFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::Normals], UnlitFlags, ARRAY_COUNT(UnlitFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::Normals], NormalsFlags, ARRAY_COUNT(NormalsFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::Segmentation], UnlitFlags, ARRAY_COUNT(UnlitFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::Segmentation], SegmentationFlags, ARRAY_COUNT(SegmentationFlags));
+			Resolve(ResolvedFlags[(int32)ECineCaptureProfile::Preview], PreviewFlags, ARRAY_COUNT(PreviewFlags));
+		}
+		return ResolvedFlags[(int32)Profile];
+	}
+}
+
+void FCineCaptureProfiles::ApplyShowFlags(ECineCaptureProfile Profile, FEngineShowFlags& ShowFlags)
+{
+	check(IsInGameThread());
+
+	for (const TPair<uint32, bool>& Flag : CineCaptureProfiles::GetResolvedFlags(Profile))
+	{
+		ShowFlags.SetSingleFlag(Flag.Key, Flag.Value);
+	}
+}
+
+void FCineCaptureProfiles::ApplyPostProcessOverrides(ECineCaptureProfile Profile, FPostProcessSettings& Settings)
+{
+	switch (Profile)
+	{
+	case ECineCaptureProfile::DepthOnly:
+	case ECineCaptureProfile::Normals:
+	case ECineCaptureProfile::Segmentation:
+		// Whatever a volume or the lens asks for never reaches these outputs
+		Settings.bOverride_BloomIntensity = true;
+		Settings.BloomIntensity = 0.f;
+		Settings.bOverride_AmbientOcclusionIntensity = true;
+		Settings.AmbientOcclusionIntensity = 0.f;
+		Settings.bOverride_ScreenSpaceReflectionIntensity = true;
+		Settings.ScreenSpaceReflectionIntensity = 0.f;
+		Settings.bOverride_MotionBlurAmount = true;
+		Settings.MotionBlurAmount = 0.f;
+		Settings.bOverride_LensFlareIntensity = true;
+		Settings.LensFlareIntensity = 0.f;
+		Settings.bOverride_DepthOfFieldFstop = false;
+		Settings.bOverride_DepthOfFieldFocalDistance = false;
+		Settings.bOverride_DepthOfFieldSensorWidth = false;
+		break;
+	case ECineCaptureProfile::Preview:
+		Settings.bOverride_AmbientOcclusionQuality = true;
+		Settings.AmbientOcclusionQuality = 25.f;
+		Settings.bOverride_ScreenSpaceReflectionQuality = true;
+		Settings.ScreenSpaceReflectionQuality = 25.f;
+		Settings.bOverride_MotionBlurAmount = true;
+		Settings.MotionBlurAmount = 0.f;
+		Settings.bOverride_LensFlareIntensity = true;
+		Settings.LensFlareIntensity = 0.f;
+		break;
+	default:
+		break;
+	}
+}
+
+int32 FCineCaptureProfiles::FindShowFlagIndex(const FString& Name)
+{
+	check(IsInGameThread());
+
+	static TMap<FString, int32> IndexByName;
+	if (const int32* Index = IndexByName.Find(Name))
+	{
+		return *Index;
+	}
+	return IndexByName.Add(Name, FEngineShowFlags::FindIndexByName(*Name));
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CineCameraCaptureProfiles.generated.h"
+
+struct FEngineShowFlags;
+struct FPostProcessSettings;
+
+/** Render features a capture needs, everything its output can't show is switched off. */
+UENUM(BlueprintType)
+enum class ECineCaptureProfile : uint8
+{
+	/** Only ShowFlagSettings and PostProcessSettings apply. */
+	Custom,
+	/** Everything a final frame needs, the game defaults. */
+	FinalColor,
+	/** No lighting, translucency, fog or post processing, for scene depth. */
+	DepthOnly,
+	/** No lighting, translucency, fog or post processing, but decals, for the GBuffer outputs. */
+	Normals,
+	/** Post process materials only, without anti-aliasing so ids are never blended. */
+	Segmentation,
+	/** Final color without the expensive screen space effects, for monitoring. */
+	Preview,
+};
+
+/**
+ * Show flag and post process overrides of every ECineCaptureProfile.
+ * Show flag names are resolved to indices once, applying a profile is a handful of bit writes.
+ */
+struct CINEMATICCAMERA_API FCineCaptureProfiles
+{
+	/** Overrides the show flags Profile decides on, leaving the others as they are. */
+	static void ApplyShowFlags(ECineCaptureProfile Profile, FEngineShowFlags& ShowFlags);
+
+	/** Overrides the post process settings Profile decides on. */
+	static void ApplyPostProcessOverrides(ECineCaptureProfile Profile, FPostProcessSettings& Settings);
+
+	/** FEngineShowFlags::FindIndexByName() with the result cached, for ShowFlagSettings. Game thread only. */
+	static int32 FindShowFlagIndex(const FString& Name);
+};
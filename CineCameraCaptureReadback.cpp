@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureReadback.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "HAL/PlatformProcess.h"
+
+FCineCaptureBufferPool::~FCineCaptureBufferPool()
+{
+	for (TArray<uint8>* Buffer : FreeBuffers)
+	{
+		delete Buffer;
+	}
+}
+
+FCineCaptureBufferPtr FCineCaptureBufferPool::Acquire(int32 NumBytes)
+{
+	TArray<uint8>* Buffer = nullptr;
+	{
+		FScopeLock Lock(&FreeBuffersLock);
+		// Prefer a buffer that is already big enough, frames of one capture are all the same size
+		for (int32 Index = FreeBuffers.Num() - 1; Index >= 0; --Index)
+		{
+			if (FreeBuffers[Index]->Max() >= NumBytes)
+			{
+				Buffer = FreeBuffers[Index];
+				FreeBuffers.RemoveAtSwap(Index, 1, false);
+				break;
+			}
+		}
+		if (!Buffer && FreeBuffers.Num() > 0)
+		{
+			Buffer = FreeBuffers.Pop(false);
+		}
+	}
+
+	if (!Buffer)
+	{
+		Buffer = new TArray<uint8>();
+	}
+	Buffer->SetNumUninitialized(NumBytes, false);
+
+	TWeakPtr<FCineCaptureBufferPool, ESPMode::ThreadSafe> WeakPool = AsShared();
+	return FCineCaptureBufferPtr(Buffer, [WeakPool](TArray<uint8>* InBuffer)
+	{
+		TSharedPtr<FCineCaptureBufferPool, ESPMode::ThreadSafe> Pool = WeakPool.Pin();
+		if (Pool.IsValid())
+		{
+			Pool->Release(InBuffer);
+		}
+		else
+		{
+			delete InBuffer;
+		}
+	});
+}
+
+int32 FCineCaptureBufferPool::GetNumFreeBuffers() const
+{
+	FScopeLock Lock(&FreeBuffersLock);
+	return FreeBuffers.Num();
+}
+
+void FCineCaptureBufferPool::Release(TArray<uint8>* Buffer)
+{
+	FScopeLock Lock(&FreeBuffersLock);
+	FreeBuffers.Add(Buffer);
+}
+
+FCineCaptureReadback::FCineCaptureReadback(int32 InRingSize)
+	: RingSize(FMath::Max(InRingSize, 1))
+	, OldestSlot(0)
+	, NumPendingSlots(0)
+	, BufferPool(MakeShared<FCineCaptureBufferPool, ESPMode::ThreadSafe>())
+{
+	Slots.SetNum(RingSize);
+}
+
+bool FCineCaptureReadback::EnqueueCopy(UTextureRenderTarget2D* Target, uint64 FrameNumber, bool bWaitForSlot)
+{
+	check(IsInGameThread());
+
+	FTextureRenderTargetResource* TargetResource = Target ? Target->GameThread_GetRenderTargetResource() : nullptr;
+	if (!TargetResource)
+	{
+		return false;
+	}
+
+	if (bWaitForSlot && NumInFlight.GetValue() >= RingSize)
+	{
+		ENQUEUE_RENDER_COMMAND(CineCaptureReadbackSubmit)(
+			[](FRHICommandListImmediate& RHICmdList)
+		{
+			RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
+		});
+
+		// Bounded, a lost device must not hang the game thread
+		const double WaitEndTime = FPlatformTime::Seconds() + 5.0;
+		while (NumInFlight.GetValue() >= RingSize && FPlatformTime::Seconds() < WaitEndTime)
+		{
+			Poll();
+			FlushRenderingCommands();
+			if (NumInFlight.GetValue() >= RingSize)
+			{
+				FPlatformProcess::Sleep(0.0005f);
+			}
+		}
+	}
+
+	// Otherwise never wait for a slot, a dropped frame is cheaper than a stall
+	if (NumInFlight.GetValue() >= RingSize)
+	{
+		NumDropped.Increment();
+		return false;
+	}
+	NumInFlight.Increment();
+
+	TSharedRef<FCineCaptureReadback, ESPMode::ThreadSafe> This = AsShared();
+	ENQUEUE_RENDER_COMMAND(CineCaptureReadbackCopy)(
+		[This, TargetResource, FrameNumber](FRHICommandListImmediate& RHICmdList)
+	{
+		This->CopyToSlot_RenderThread(RHICmdList, TargetResource->GetRenderTargetTexture(), FrameNumber);
+	});
+	return true;
+}
+
+void FCineCaptureReadback::CopyToSlot_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture2D* SourceTexture, uint64 FrameNumber)
+{
+	if (!SourceTexture)
+	{
+		NumInFlight.Decrement();
+		return;
+	}
+
+	check(NumPendingSlots < RingSize);
+	FStagingSlot& Slot = Slots[(OldestSlot + NumPendingSlots) % RingSize];
+	++NumPendingSlots;
+
+	const FIntPoint Size = SourceTexture->GetSizeXY();
+	const EPixelFormat Format = SourceTexture->GetFormat();
+	if (!Slot.StagingTexture.IsValid() || Slot.StagingTexture->GetSizeXY() != Size || Slot.StagingTexture->GetFormat() != Format)
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		Slot.StagingTexture = RHICreateTexture2D(Size.X, Size.Y, Format, 1, 1, TexCreate_CPUReadback, CreateInfo);
+	}
+	if (!Slot.Fence.IsValid())
+	{
+		Slot.Fence = RHICreateGPUFence(TEXT("CineCaptureReadback"));
+	}
+
+	Slot.Fence->Clear();
+	Slot.FrameNumber = FrameNumber;
+	Slot.SubmitFrameRenderThread = GFrameNumberRenderThread;
+
+	RHICmdList.CopyToResolveTarget(SourceTexture, Slot.StagingTexture, FResolveParams());
+	RHICmdList.WriteGPUFence(Slot.Fence);
+}
+
+void FCineCaptureReadback::Poll()
+{
+	check(IsInGameThread());
+
+	if (NumInFlight.GetValue() == 0)
+	{
+		return;
+	}
+
+	TSharedRef<FCineCaptureReadback, ESPMode::ThreadSafe> This = AsShared();
+	ENQUEUE_RENDER_COMMAND(CineCaptureReadbackPoll)(
+		[This](FRHICommandListImmediate& RHICmdList)
+	{
+		This->Poll_RenderThread(RHICmdList);
+	});
+}
+
+void FCineCaptureReadback::Poll_RenderThread(FRHICommandListImmediate& RHICmdList)
+{
+	while (NumPendingSlots > 0)
+	{
+		FStagingSlot& Slot = Slots[OldestSlot];
+		if (!Slot.Fence->Poll())
+		{
+			// Later copies can't be done before this one
+			break;
+		}
+
+		const FIntPoint Size = Slot.StagingTexture->GetSizeXY();
+		const EPixelFormat Format = Slot.StagingTexture->GetFormat();
+		const int32 BytesPerPixel = GPixelFormats[Format].BlockBytes;
+		const int32 Stride = Size.X * BytesPerPixel;
+
+		FCineCaptureFrame Frame;
+		Frame.FrameNumber = Slot.FrameNumber;
+		Frame.Width = Size.X;
+		Frame.Height = Size.Y;
+		Frame.Stride = Stride;
+		Frame.PixelFormat = Format;
+		Frame.Data = BufferPool->Acquire(Stride * Size.Y);
+
+		void* MappedData = nullptr;
+		int32 MappedWidth = 0;
+		int32 MappedHeight = 0;
+		RHICmdList.MapStagingSurface(Slot.StagingTexture, MappedData, MappedWidth, MappedHeight);
+		if (MappedData)
+		{
+			// The staging surface may be padded, MappedWidth is its row pitch in pixels
+			const int32 MappedStride = MappedWidth * BytesPerPixel;
+			const uint8* Src = static_cast<const uint8*>(MappedData);
+			uint8* Dest = Frame.Data->GetData();
+			if (MappedStride == Stride)
+			{
+				FMemory::Memcpy(Dest, Src, Stride * Size.Y);
+			}
+			else
+			{
+				for (int32 Row = 0; Row < Size.Y; ++Row)
+				{
+					FMemory::Memcpy(Dest + Row * Stride, Src + Row * MappedStride, Stride);
+				}
+			}
+			RHICmdList.UnmapStagingSurface(Slot.StagingTexture);
+
+			CompletedFrames.Enqueue(MoveTemp(Frame));
+			NumCompleted.Increment();
+		}
+
+		LastLatencyFrames.Set((int32)(GFrameNumberRenderThread - Slot.SubmitFrameRenderThread));
+		OldestSlot = (OldestSlot + 1) % RingSize;
+		--NumPendingSlots;
+		NumInFlight.Decrement();
+	}
+}
+
+bool FCineCaptureReadback::DequeueFrame(FCineCaptureFrame& OutFrame)
+{
+	if (CompletedFrames.Dequeue(OutFrame))
+	{
+		NumCompleted.Decrement();
+		return true;
+	}
+	return false;
+}
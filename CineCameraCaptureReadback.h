@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIResources.h"
+#include "Containers/Queue.h"
+#include "HAL/ThreadSafeCounter.h"
+
+class UTextureRenderTarget2D;
+
+typedef TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FCineCaptureBufferPtr;
+
+/** Recycles CPU buffers for read back frames. Buffers go back to the pool when their last reference is released. */
+class CINEMATICCAMERA_API FCineCaptureBufferPool : public TSharedFromThis<FCineCaptureBufferPool, ESPMode::ThreadSafe>
+{
+public:
+	~FCineCaptureBufferPool();
+
+	/** Returns a buffer of exactly NumBytes, reusing a released one when possible. Thread safe. */
+	FCineCaptureBufferPtr Acquire(int32 NumBytes);
+
+	int32 GetNumFreeBuffers() const;
+
+private:
+	void Release(TArray<uint8>* Buffer);
+
+	mutable FCriticalSection FreeBuffersLock;
+	TArray<TArray<uint8>*> FreeBuffers;
+};
+
+/** A frame read back from a capture's render target. */
+struct FCineCaptureFrame
+{
+	/** GFrameCounter of the frame the capture was dispatched in. */
+	uint64 FrameNumber = 0;
+	int32 Width = 0;
+	int32 Height = 0;
+	/** Bytes per row in Data, rows are tightly packed. */
+	int32 Stride = 0;
+	EPixelFormat PixelFormat = PF_Unknown;
+	/** Pooled pixel data, recycled once every copy of this frame is gone. */
+	FCineCaptureBufferPtr Data;
+	/** Segmentation frames only: the instance and class ids as of the capture. */
+	TSharedPtr<const struct FCineSegmentationTable, ESPMode::ThreadSafe> SegmentationTable;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCineCaptureFrameReady, const FCineCaptureFrame&);
+
+/**
+ * Pipelined GPU readback of a render target through a ring of staging textures.
+ * Copies are fenced and only mapped once the GPU is done with them, so neither the game thread nor the render thread waits on the GPU.
+ * When every slot is in flight new copies are dropped rather than stalling.
+ */
+class CINEMATICCAMERA_API FCineCaptureReadback : public TSharedFromThis<FCineCaptureReadback, ESPMode::ThreadSafe>
+{
+public:
+	explicit FCineCaptureReadback(int32 InRingSize);
+
+	/**
+	* Game thread. Enqueues a copy of the target's current contents, returns false if the ring is full.
+	* With bWaitForSlot a full ring is drained by waiting for the GPU instead, for offline capture where no frame may be lost.
+	*/
+	bool EnqueueCopy(UTextureRenderTarget2D* Target, uint64 FrameNumber, bool bWaitForSlot = false);
+
+	/** Game thread. Enqueues a render command that maps every copy the GPU has finished, oldest first. */
+	void Poll();
+
+	/** Game thread. Pops the oldest completed frame, if any. */
+	bool DequeueFrame(FCineCaptureFrame& OutFrame);
+
+	int32 GetRingSize() const { return RingSize; }
+
+	/** Copies enqueued but not yet read back. */
+	int32 GetNumInFlight() const { return NumInFlight.GetValue(); }
+
+	/** Frames read back but not yet dequeued. */
+	int32 GetNumCompleted() const { return NumCompleted.GetValue(); }
+
+	/** Render thread frames between the last completed copy being enqueued and being mapped. */
+	int32 GetLastLatencyFrames() const { return LastLatencyFrames.GetValue(); }
+
+	/** Copies dropped because the ring was full. */
+	int32 GetNumDropped() const { return NumDropped.GetValue(); }
+
+private:
+	struct FStagingSlot
+	{
+		FTexture2DRHIRef StagingTexture;
+		FGPUFenceRHIRef Fence;
+		uint64 FrameNumber = 0;
+		uint32 SubmitFrameRenderThread = 0;
+	};
+
+	void CopyToSlot_RenderThread(FRHICommandListImmediate& RHICmdList, FRHITexture2D* SourceTexture, uint64 FrameNumber);
+	void Poll_RenderThread(FRHICommandListImmediate& RHICmdList);
+
+	const int32 RingSize;
+
+	/** Render thread only. Slots are used and completed in FIFO order. */
+	TArray<FStagingSlot> Slots;
+	int32 OldestSlot;
+	int32 NumPendingSlots;
+
+	TQueue<FCineCaptureFrame, EQueueMode::Spsc> CompletedFrames;
+	TSharedRef<FCineCaptureBufferPool, ESPMode::ThreadSafe> BufferPool;
+
+	FThreadSafeCounter NumInFlight;
+	FThreadSafeCounter NumCompleted;
+	FThreadSafeCounter LastLatencyFrames;
+	FThreadSafeCounter NumDropped;
+};
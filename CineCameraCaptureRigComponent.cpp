@@ -0,0 +1,373 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureRigComponent.h"
+#include "CineCameraCaptureComponent.h"
+#include "Engine/World.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "SceneInterface.h"
+#include "SceneView.h"
+#include "SceneManagement.h"
+#include "CanvasTypes.h"
+#include "EngineModule.h"
+#include "RendererInterface.h"
+#include "LegacyScreenPercentageDriver.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "Async/ParallelFor.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+#include "CineCameraCaptureStats.h"
+
+/** Rigs waiting to be rendered, per world. Rigs only queue from the game thread. */
+static TMap<TWeakObjectPtr<UWorld>, TArray<TWeakObjectPtr<UCineCameraCaptureRigComponent> > > RigCapturesToUpdateMap;
+
+UCineCameraCaptureRigComponent::UCineCameraCaptureRigComponent() : Super(), ShowFlags(ESFIM_Game)
+{
+	AtlasTarget = nullptr;
+	AtlasColumns = 0;
+	bCopyViewsToCameraTargets = false;
+	bCaptureEveryFrame = true;
+	CaptureSource = SCS_FinalColorLDR;
+	bAutoActivate = true;
+	bTickInEditor = true;
+
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_DuringPhysics;
+
+	// Same defaults as the individual capture components
+	ShowFlags.SetMotionBlur(0);
+	ShowFlags.SetSeparateTranslucency(0);
+	ShowFlags.SetHMDDistortion(0);
+}
+
+void UCineCameraCaptureRigComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	BindCameras();
+}
+
+void UCineCameraCaptureRigComponent::OnUnregister()
+{
+	UnbindCameras();
+
+	for (int32 ViewIndex = 0; ViewIndex < ViewStates.Num(); ViewIndex++)
+	{
+		ViewStates[ViewIndex].Destroy();
+	}
+
+	Super::OnUnregister();
+}
+
+void UCineCameraCaptureRigComponent::BindCameras()
+{
+	UnbindCameras();
+
+	for (UCineCameraCaptureComponent* Camera : Cameras)
+	{
+		if (Camera)
+		{
+			Camera->OwningRig = this;
+			BoundCameras.Add(Camera);
+		}
+	}
+}
+
+void UCineCameraCaptureRigComponent::UnbindCameras()
+{
+	for (const TWeakObjectPtr<UCineCameraCaptureComponent>& Camera : BoundCameras)
+	{
+		if (Camera.IsValid() && Camera->OwningRig == this)
+		{
+			Camera->OwningRig = nullptr;
+		}
+	}
+	BoundCameras.Reset();
+}
+
+void UCineCameraCaptureRigComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Cameras can be swapped from blueprint at any time, BoundCameras holds the non-null ones in order
+	int32 NumBound = 0;
+	bool bCamerasChanged = false;
+	for (UCineCameraCaptureComponent* Camera : Cameras)
+	{
+		if (!Camera)
+		{
+			continue;
+		}
+		if (!BoundCameras.IsValidIndex(NumBound) || BoundCameras[NumBound].Get() != Camera)
+		{
+			bCamerasChanged = true;
+			break;
+		}
+		++NumBound;
+	}
+	if (bCamerasChanged || NumBound != BoundCameras.Num())
+	{
+		BindCameras();
+	}
+
+	if (bCaptureEveryFrame)
+	{
+		CaptureRigDeferred();
+	}
+}
+
+void UCineCameraCaptureRigComponent::CaptureRig()
+{
+	BindCameras();
+	CaptureRigDeferred();
+}
+
+void UCineCameraCaptureRigComponent::CaptureRigDeferred()
+{
+	UWorld* World = GetWorld();
+	if (World && World->Scene && IsVisible() && AtlasTarget)
+	{
+		RigCapturesToUpdateMap.FindOrAdd(World).AddUnique(this);
+	}
+}
+
+FIntRect UCineCameraCaptureRigComponent::GetViewRect(int32 CameraIndex) const
+{
+	const int32 NumViews = Cameras.Num();
+	if (!AtlasTarget || NumViews == 0 || !Cameras.IsValidIndex(CameraIndex))
+	{
+		return FIntRect();
+	}
+
+	const int32 Columns = AtlasColumns > 0 ? AtlasColumns : FMath::CeilToInt(FMath::Sqrt((float)NumViews));
+	const int32 Rows = FMath::DivideAndRoundUp(NumViews, Columns);
+	const int32 ViewWidth = AtlasTarget->SizeX / Columns;
+	const int32 ViewHeight = AtlasTarget->SizeY / Rows;
+
+	const FIntPoint Min((CameraIndex % Columns) * ViewWidth, (CameraIndex / Columns) * ViewHeight);
+	return FIntRect(Min, Min + FIntPoint(ViewWidth, ViewHeight));
+}
+
+void UCineCameraCaptureRigComponent::UpdateDeferredRigCaptures(FSceneInterface* Scene)
+{
+	UWorld* World = Scene->GetWorld();
+
+	// Rendering a rig re-enters the deferred capture update, and rigs can be queued meanwhile, so work on a list of our own
+	TArray<TWeakObjectPtr<UCineCameraCaptureRigComponent> > RigsToUpdate;
+	if (!World || !RigCapturesToUpdateMap.RemoveAndCopyValue(World, RigsToUpdate))
+	{
+		return;
+	}
+
+	for (const TWeakObjectPtr<UCineCameraCaptureRigComponent>& Rig : RigsToUpdate)
+	{
+		if (Rig.IsValid())
+		{
+			Rig->UpdateRigCaptureContents(Scene);
+		}
+	}
+}
+
+/** Adds the primitives of Actors to PrimitiveIds, the way the engine's scene captures resolve their actor lists. */
+static void AddActorPrimitives(const TArray<AActor*>& Actors, TSet<FPrimitiveComponentId>& PrimitiveIds)
+{
+	for (const AActor* Actor : Actors)
+	{
+		if (!Actor)
+		{
+			continue;
+		}
+
+		for (const UActorComponent* Component : Actor->GetComponents())
+		{
+			if (const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+			{
+				PrimitiveIds.Add(Primitive->ComponentId);
+			}
+		}
+	}
+}
+
+FSceneView* UCineCameraCaptureRigComponent::CreateRigView(FSceneViewFamily& ViewFamily, UCineCameraCaptureComponent* Camera, int32 CameraIndex, const FCineCaptureViewSetup& Setup)
+{
+	if (CameraIndex >= ViewStates.Num())
+	{
+		ViewStates.AddZeroed(CameraIndex - ViewStates.Num() + 1);
+	}
+	if (ViewStates[CameraIndex].GetReference() == nullptr)
+	{
+		ViewStates[CameraIndex].Allocate();
+	}
+
+	FSceneViewInitOptions ViewInitOptions;
+	ViewInitOptions.SetViewRectangle(Setup.ViewRect);
+	ViewInitOptions.ViewFamily = &ViewFamily;
+	ViewInitOptions.ViewActor = Camera->GetViewOwner();
+	ViewInitOptions.ViewOrigin = Setup.ViewLocation;
+	ViewInitOptions.ViewRotationMatrix = Setup.ViewRotationMatrix;
+	ViewInitOptions.ProjectionMatrix = Setup.ProjectionMatrix;
+	ViewInitOptions.SceneViewStateInterface = ViewStates[CameraIndex].GetReference();
+	ViewInitOptions.BackgroundColor = FLinearColor::Black;
+	ViewInitOptions.OverrideFarClippingPlaneDistance = Camera->MaxViewDistanceOverride;
+	ViewInitOptions.LODDistanceFactor = FMath::Clamp(Camera->LODDistanceFactor, .01f, 100.0f);
+	ViewInitOptions.StereoPass = Camera->CaptureStereoPass;
+	ViewInitOptions.bUseFieldOfViewForLOD = true;
+	ViewInitOptions.FOV = Setup.FieldOfView;
+	ViewInitOptions.bInCameraCut = Setup.bCameraCut;
+
+	FSceneView* View = new FSceneView(ViewInitOptions);
+	View->bIsSceneCapture = true;
+	View->bCameraCut = Setup.bCameraCut;
+
+	View->HiddenPrimitives = *Setup.HiddenPrimitiveIds;
+	AddActorPrimitives(Camera->HiddenActors, View->HiddenPrimitives);
+	if (Setup.ShowOnlyPrimitiveIds.IsValid())
+	{
+		View->ShowOnlyPrimitives = *Setup.ShowOnlyPrimitiveIds;
+		AddActorPrimitives(Camera->ShowOnlyActors, View->ShowOnlyPrimitives.GetValue());
+	}
+
+	// Each view gets its own filmback, lens and DoF
+	View->StartFinalPostprocessSettings(Setup.ViewLocation);
+	View->OverridePostProcessSettings(*Setup.LensPostProcess, Setup.PostProcessBlendWeight);
+	View->EndFinalPostprocessSettings(ViewInitOptions);
+
+	ViewFamily.Views.Add(View);
+	return View;
+}
+
+void UCineCameraCaptureRigComponent::UpdateRigCaptureContents(FSceneInterface* Scene)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CineCapture_RigDispatch);
+	CSV_SCOPED_TIMING_STAT(CineCameraCapture, RigDispatch);
+
+	UWorld* World = GetWorld();
+	FTextureRenderTargetResource* AtlasResource = AtlasTarget ? AtlasTarget->GameThread_GetRenderTargetResource() : nullptr;
+	if (!World || !AtlasResource)
+	{
+		return;
+	}
+
+	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(AtlasResource, Scene, ShowFlags)
+		.SetResolveScene(true)
+		.SetRealtimeUpdate(true));
+	ViewFamily.SceneCaptureSource = CaptureSource;
+	ViewFamily.EngineShowFlags.SetScreenPercentage(false);
+	ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(ViewFamily, 1.0f, false));
+
+	TArray<TPair<UCineCameraCaptureComponent*, FIntRect>, TInlineAllocator<8> > RenderedViews;
+	TArray<int32, TInlineAllocator<8> > RenderedCameraIndices;
+	for (int32 CameraIndex = 0; CameraIndex < Cameras.Num(); ++CameraIndex)
+	{
+		UCineCameraCaptureComponent* Camera = Cameras[CameraIndex];
+		if (!Camera || !Camera->IsVisible())
+		{
+			continue;
+		}
+
+		// Cameras that capture every frame already updated their lens this frame
+		if (!Camera->bCaptureEveryFrame && !RenderedViews.ContainsByPredicate([Camera](const TPair<UCineCameraCaptureComponent*, FIntRect>& View) { return View.Key == Camera; }))
+		{
+			Camera->UpdateCameraLensCapture(World->DeltaTimeSeconds);
+		}
+		RenderedViews.Emplace(Camera, GetViewRect(CameraIndex));
+		RenderedCameraIndices.Add(CameraIndex);
+	}
+
+	// A camera listed twice must not build two setups at once, its repeated views are built afterwards
+	TBitArray<TInlineAllocator<1> > IsRepeatedView(false, RenderedViews.Num());
+	for (int32 ViewIndex = 1; ViewIndex < RenderedViews.Num(); ++ViewIndex)
+	{
+		for (int32 OtherIndex = 0; OtherIndex < ViewIndex; ++OtherIndex)
+		{
+			if (RenderedViews[OtherIndex].Key == RenderedViews[ViewIndex].Key)
+			{
+				IsRepeatedView[ViewIndex] = true;
+				break;
+			}
+		}
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CineCapture_Prepare);
+		CSV_SCOPED_TIMING_STAT(CineCameraCapture, Prepare);
+
+		ViewSetups.SetNum(RenderedViews.Num(), false);
+		ParallelFor(RenderedViews.Num(), [this, &RenderedViews, &IsRepeatedView](int32 ViewIndex)
+		{
+			if (!IsRepeatedView[ViewIndex])
+			{
+				RenderedViews[ViewIndex].Key->BuildViewSetup(RenderedViews[ViewIndex].Value, ViewSetups[ViewIndex]);
+			}
+		}, !FCineCaptureViewSetup::ShouldBuildInParallel(RenderedViews.Num()));
+
+		for (TConstSetBitIterator<TInlineAllocator<1> > It(IsRepeatedView); It; ++It)
+		{
+			RenderedViews[It.GetIndex()].Key->BuildViewSetup(RenderedViews[It.GetIndex()].Value, ViewSetups[It.GetIndex()]);
+		}
+	}
+
+	for (int32 ViewIndex = 0; ViewIndex < RenderedViews.Num(); ++ViewIndex)
+	{
+		// View states follow the camera slot, so hiding a camera does not hand its history to the next one
+		CreateRigView(ViewFamily, RenderedViews[ViewIndex].Key, RenderedCameraIndices[ViewIndex], ViewSetups[ViewIndex]);
+	}
+	for (const TPair<UCineCameraCaptureComponent*, FIntRect>& RenderedView : RenderedViews)
+	{
+		RenderedView.Key->bCameraCutThisFrame = false;
+		RenderedView.Key->LastCaptureFrameNumber = GFrameCounter;
+	}
+
+	if (RenderedViews.Num() == 0)
+	{
+		return;
+	}
+
+	FCanvas Canvas(AtlasResource, nullptr, World, Scene->GetFeatureLevel());
+	Canvas.Clear(FLinearColor::Transparent);
+	GetRendererModule().BeginRenderingViewFamily(&Canvas, &ViewFamily);
+
+	if (!bCopyViewsToCameraTargets)
+	{
+		return;
+	}
+
+	for (const TPair<UCineCameraCaptureComponent*, FIntRect>& RenderedView : RenderedViews)
+	{
+		UCineCameraCaptureComponent* Camera = RenderedView.Key;
+		const FIntRect ViewRect = RenderedView.Value;
+		UTextureRenderTarget2D* CameraTarget = Camera->TextureTarget;
+		if (!CameraTarget || CameraTarget->SizeX != ViewRect.Width() || CameraTarget->SizeY != ViewRect.Height() || CameraTarget->GetFormat() != AtlasTarget->GetFormat())
+		{
+			continue;
+		}
+
+		FTextureRenderTargetResource* CameraResource = CameraTarget->GameThread_GetRenderTargetResource();
+		ENQUEUE_RENDER_COMMAND(CineCaptureRigCopyView)(
+			[AtlasResource, CameraResource, ViewRect](FRHICommandListImmediate& RHICmdList)
+		{
+			FRHICopyTextureInfo CopyInfo;
+			CopyInfo.Size = FIntVector(ViewRect.Width(), ViewRect.Height(), 1);
+			CopyInfo.SourcePosition = FIntVector(ViewRect.Min.X, ViewRect.Min.Y, 0);
+			RHICmdList.CopyTexture(AtlasResource->GetRenderTargetTexture(), CameraResource->GetRenderTargetTexture(), CopyInfo);
+		});
+
+		Camera->EnqueueReadback();
+	}
+}
+
+void UCineCameraCaptureRigComponent::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	UCineCameraCaptureRigComponent* This = CastChecked<UCineCameraCaptureRigComponent>(InThis);
+
+	for (int32 ViewIndex = 0; ViewIndex < This->ViewStates.Num(); ViewIndex++)
+	{
+		FSceneViewStateInterface* Ref = This->ViewStates[ViewIndex].GetReference();
+		if (Ref)
+		{
+			Ref->AddReferencedObjects(Collector);
+		}
+	}
+
+	Super::AddReferencedObjects(This, Collector);
+}
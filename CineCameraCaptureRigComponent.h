@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShowFlags.h"
+#include "Components/SceneComponent.h"
+#include "Components/SceneCaptureComponent.h"
+#include "CineCameraCaptureViewSetup.h"
+#include "CineCameraCaptureRigComponent.generated.h"
+
+class UCineCameraCaptureComponent;
+class UTextureRenderTarget2D;
+class FSceneViewFamily;
+class FSceneView;
+
+/**
+ * Captures several cine camera capture components as the views of a single view family, like split screen does for local players.
+ * Scene traversal, shadow setup and the rest of the per-family work is done once for the whole rig instead of once per camera.
+ * Every camera keeps its own filmback, lens and depth of field post process and renders into its own viewport of AtlasTarget,
+ * which can additionally be copied into the camera's own TextureTarget.
+ */
+UCLASS(Blueprintable, ClassGroup = Rendering, meta = (BlueprintSpawnableComponent))
+class CINEMATICCAMERA_API UCineCameraCaptureRigComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+
+	/** Queues the rig to be rendered with the deferred captures at the end of the frame. */
+	void CaptureRigDeferred();
+
+	void UpdateRigCaptureContents(FSceneInterface* Scene);
+
+	/**
+	 * Adds a view for the camera at CameraIndex to the family from a setup built by the camera, rendering into the setup's ViewRect of the atlas.
+	 * Applies the camera's HiddenActors and ShowOnlyActors on top of its component lists.
+	 */
+	FSceneView* CreateRigView(FSceneViewFamily& ViewFamily, UCineCameraCaptureComponent* Camera, int32 CameraIndex, const FCineCaptureViewSetup& Setup);
+
+	/** Hooks the cameras up so their own deferred captures are suppressed while the rig renders them. */
+	void BindCameras();
+	void UnbindCameras();
+
+	/** One persistent view state per entry of Cameras, indexed like Cameras. */
+	TArray<FSceneViewStateReference> ViewStates;
+
+	/** Cameras BindCameras() was last called with. */
+	TArray<TWeakObjectPtr<UCineCameraCaptureComponent> > BoundCameras;
+
+	/** View setups of the cameras rendered this frame, kept around to avoid reallocating every frame. */
+	TArray<FCineCaptureViewSetup> ViewSetups;
+
+public:
+	UCineCameraCaptureRigComponent();
+
+	/** Renders every rig queued for the scene's world. Called from UCineCameraCaptureComponent::UpdateDeferredCaptures(). */
+	static void UpdateDeferredRigCaptures(FSceneInterface* Scene);
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	/** The cameras of the rig, in view order. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		TArray<UCineCameraCaptureComponent*> Cameras;
+
+	/** Render target every view of the rig is rendered into. Views are laid out in a grid of AtlasColumns columns. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		UTextureRenderTarget2D* AtlasTarget;
+
+	/** Number of columns of the atlas grid. 0 picks the smallest square grid that fits every camera. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (ClampMin = "0"))
+		int32 AtlasColumns;
+
+	/** Whether to copy each view out of the atlas into its camera's TextureTarget. The camera target must match the view size and atlas format. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		bool bCopyViewsToCameraTargets;
+
+	/** Whether to render the rig every frame. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture)
+		bool bCaptureEveryFrame;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = SceneCapture, meta = (DisplayName = "Capture Source"))
+		TEnumAsByte<enum ESceneCaptureSource> CaptureSource;
+
+	/** Show flags shared by every view of the rig, the family can only have one set. */
+	FEngineShowFlags ShowFlags;
+
+	/** Returns the viewport of the camera at CameraIndex within AtlasTarget. */
+	FIntRect GetViewRect(int32 CameraIndex) const;
+
+	/** Renders the rig at the end of this frame. */
+	UFUNCTION(BlueprintCallable, Category = "Rendering|SceneCapture")
+		void CaptureRig();
+};
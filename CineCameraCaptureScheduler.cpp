@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureScheduler.h"
+
+void FCineCaptureScheduler::Schedule(const TArray<FCineCaptureScheduleEntry>& Entries, TArray<int32>& OutSelected) const
+{
+	OutSelected.Reset();
+
+	const bool bLimitCount = MaxCapturesPerFrame > 0;
+	const bool bLimitPixels = MaxPixelsPerFrame > 0;
+	if (!bLimitCount && !bLimitPixels)
+	{
+		// Nothing to budget, capture everything
+		OutSelected.Reserve(Entries.Num());
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			OutSelected.Add(Index);
+		}
+	}
+	else
+	{
+		SortedIndices.Reset();
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			SortedIndices.Add(Index);
+		}
+
+		// Overdue entries first, then by aged priority. Ties go to whoever waited longest, then to queue order, which makes equal entries round-robin.
+		SortedIndices.Sort([this, &Entries](int32 A, int32 B)
+		{
+			const FCineCaptureScheduleEntry& EntryA = Entries[A];
+			const FCineCaptureScheduleEntry& EntryB = Entries[B];
+
+			const bool bOverdueA = IsOverdue(EntryA);
+			const bool bOverdueB = IsOverdue(EntryB);
+			if (bOverdueA != bOverdueB)
+			{
+				return bOverdueA;
+			}
+
+			const float PriorityA = GetEffectivePriority(EntryA);
+			const float PriorityB = GetEffectivePriority(EntryB);
+			if (PriorityA != PriorityB)
+			{
+				return PriorityA > PriorityB;
+			}
+
+			if (EntryA.FramesSinceLastCapture != EntryB.FramesSinceLastCapture)
+			{
+				return EntryA.FramesSinceLastCapture > EntryB.FramesSinceLastCapture;
+			}
+			return A < B;
+		});
+
+		int64 PixelsUsed = 0;
+		for (int32 Index : SortedIndices)
+		{
+			const FCineCaptureScheduleEntry& Entry = Entries[Index];
+
+			// Overdue entries bypass the budget, and the first entry is always taken so an oversized capture can't stall forever
+			const bool bForced = IsOverdue(Entry) || OutSelected.Num() == 0;
+			if (!bForced)
+			{
+				if (bLimitCount && OutSelected.Num() >= MaxCapturesPerFrame)
+				{
+					continue;
+				}
+				if (bLimitPixels && PixelsUsed + Entry.PixelCost > MaxPixelsPerFrame)
+				{
+					continue;
+				}
+			}
+
+			OutSelected.Add(Index);
+			PixelsUsed += Entry.PixelCost;
+		}
+	}
+
+	// Dispatch in CaptureSortPriority order so interdependent captures still resolve correctly
+	OutSelected.StableSort([&Entries](int32 A, int32 B)
+	{
+		return Entries[A].Priority > Entries[B].Priority;
+	});
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** A queued capture as seen by the scheduler. Plain data so the scheduler can be driven without a scene or renderer. */
+struct FCineCaptureScheduleEntry
+{
+	/** CaptureSortPriority of the component, highest come first. */
+	int32 Priority = 0;
+
+	/** Frames since this entry was last captured, used to age its priority. */
+	uint32 FramesSinceLastCapture = 0;
+
+	/** If > 0, the entry is captured regardless of the budget once it has waited this many frames. */
+	uint32 MaxStalenessFrames = 0;
+
+	/** Estimated cost of the capture, typically the pixel count of its render target. */
+	int64 PixelCost = 0;
+};
+
+/**
+ * Decides which of the queued captures fit into this frame's budget.
+ * Entries that don't fit stay queued and gain priority every frame they wait, so equal-priority captures round-robin and none starves.
+ */
+class CINEMATICCAMERA_API FCineCaptureScheduler
+{
+public:
+	/** Maximum number of captures per frame. <= 0 means unlimited. */
+	int32 MaxCapturesPerFrame = 0;
+
+	/** Maximum summed PixelCost per frame. <= 0 means unlimited. */
+	int64 MaxPixelsPerFrame = 0;
+
+	/** Priority gained for every frame an entry has not been captured. */
+	float PriorityAgingPerFrame = 1.0f;
+
+	/**
+	 * Picks the entries to capture this frame.
+	 * @param Entries		Everything currently queued.
+	 * @param OutSelected	Indices into Entries to capture, in dispatch order (highest CaptureSortPriority first). Everything else should be re-queued.
+	 */
+	void Schedule(const TArray<FCineCaptureScheduleEntry>& Entries, TArray<int32>& OutSelected) const;
+
+	/** Priority of an entry once aging is applied. */
+	float GetEffectivePriority(const FCineCaptureScheduleEntry& Entry) const
+	{
+		return (float)Entry.Priority + PriorityAgingPerFrame * (float)Entry.FramesSinceLastCapture;
+	}
+
+	static bool IsOverdue(const FCineCaptureScheduleEntry& Entry)
+	{
+		return Entry.MaxStalenessFrames > 0 && Entry.FramesSinceLastCapture >= Entry.MaxStalenessFrames;
+	}
+
+private:
+	/** Scratch space reused between frames. */
+	mutable TArray<int32> SortedIndices;
+};
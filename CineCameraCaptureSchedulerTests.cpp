@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureScheduler.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Adds Num entries of the same priority and cost, which only the budget and the queue order tell apart. */
+static void AddTestEntries(int32 Num, int32 Priority, int64 PixelCost, TArray<FCineCaptureScheduleEntry>& OutEntries)
+{
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		FCineCaptureScheduleEntry& Entry = OutEntries.AddDefaulted_GetRef();
+		Entry.Priority = Priority;
+		Entry.PixelCost = PixelCost;
+	}
+}
+
+static int64 SumPixelCost(const TArray<FCineCaptureScheduleEntry>& Entries, const TArray<int32>& Selected)
+{
+	int64 Sum = 0;
+	for (int32 Index : Selected)
+	{
+		Sum += Entries[Index].PixelCost;
+	}
+	return Sum;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureSchedulerBudgetTest, "CineCamera.Scheduler.Budget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** The count and pixel budgets hold, except for the first entry, which is taken even when it alone is over budget. */
+bool FCineCaptureSchedulerBudgetTest::RunTest(const FString& Parameters)
+{
+	FCineCaptureScheduler Scheduler;
+	TArray<FCineCaptureScheduleEntry> Entries;
+	TArray<int32> Selected;
+
+	AddTestEntries(10, 0, 100, Entries);
+	Scheduler.Schedule(Entries, Selected);
+	TestEqual(TEXT("Without a budget everything is captured"), Selected.Num(), Entries.Num());
+
+	Scheduler.MaxCapturesPerFrame = 3;
+	Scheduler.Schedule(Entries, Selected);
+	TestEqual(TEXT("The count budget holds"), Selected.Num(), 3);
+
+	Scheduler.MaxCapturesPerFrame = 0;
+	Scheduler.MaxPixelsPerFrame = 250;
+	Scheduler.Schedule(Entries, Selected);
+	TestEqual(TEXT("The pixel budget takes as many entries as fit"), Selected.Num(), 2);
+	TestTrue(TEXT("The pixel budget holds"), SumPixelCost(Entries, Selected) <= Scheduler.MaxPixelsPerFrame);
+
+	// An entry that doesn't fit is passed over, smaller ones behind it still get the rest of the budget
+	Entries.Reset();
+	AddTestEntries(1, 2, 100, Entries);
+	AddTestEntries(1, 1, 200, Entries);
+	AddTestEntries(1, 0, 100, Entries);
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("Entries behind one over budget still fit"), Selected == TArray<int32>({ 0, 2 }));
+
+	Entries.Reset();
+	AddTestEntries(1, 0, 1000, Entries);
+	AddTestEntries(1, 0, 10, Entries);
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("The first entry is taken over budget, nothing else is"), Selected == TArray<int32>({ 0 }));
+
+	Scheduler.MaxPixelsPerFrame = 0;
+	Scheduler.MaxCapturesPerFrame = 1;
+	Entries.Reset();
+	AddTestEntries(1, 0, 100, Entries);
+	AddTestEntries(1, 5, 100, Entries);
+	AddTestEntries(1, 3, 100, Entries);
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("The highest priority goes first"), Selected == TArray<int32>({ 1 }));
+
+	Scheduler.MaxCapturesPerFrame = 2;
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("Selected entries dispatch in priority order"), Selected == TArray<int32>({ 1, 2 }));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureSchedulerStalenessTest, "CineCamera.Scheduler.Staleness", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** Entries that waited MaxStalenessFrames go ahead of any priority and past the budget. */
+bool FCineCaptureSchedulerStalenessTest::RunTest(const FString& Parameters)
+{
+	FCineCaptureScheduler Scheduler;
+	Scheduler.MaxCapturesPerFrame = 1;
+	Scheduler.PriorityAgingPerFrame = 0.f;
+
+	TArray<FCineCaptureScheduleEntry> Entries;
+	TArray<int32> Selected;
+	AddTestEntries(1, 100, 100, Entries);
+	AddTestEntries(1, 0, 100, Entries);
+	Entries[1].MaxStalenessFrames = 5;
+	Entries[1].FramesSinceLastCapture = 4;
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("Before its limit a low priority entry waits"), Selected == TArray<int32>({ 0 }));
+
+	Entries[1].FramesSinceLastCapture = 5;
+	Scheduler.Schedule(Entries, Selected);
+	TestTrue(TEXT("An overdue entry takes the budget"), Selected == TArray<int32>({ 1 }));
+
+	AddTestEntries(1, 0, 100, Entries);
+	Entries[2].MaxStalenessFrames = 2;
+	Entries[2].FramesSinceLastCapture = 7;
+	Scheduler.Schedule(Entries, Selected);
+	TestEqual(TEXT("Overdue entries are captured past the budget"), Selected.Num(), 2);
+	TestFalse(TEXT("Overdue entries leave no room for others"), Selected.Contains(0));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureSchedulerAgingTest, "CineCamera.Scheduler.Aging", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * One capture per frame shared by a high priority entry and a few low priority ones, run for a thousand frames as the component queue would:
+ * the low priority entries age in, each within a bounded wait, instead of starving behind the high priority one.
+ */
+bool FCineCaptureSchedulerAgingTest::RunTest(const FString& Parameters)
+{
+	const int32 HighPriority = 100;
+	const int32 NumLowPriority = 5;
+	const int32 NumFrames = 1000;
+
+	FCineCaptureScheduler Scheduler;
+	Scheduler.MaxCapturesPerFrame = 1;
+	Scheduler.PriorityAgingPerFrame = 1.f;
+
+	TArray<FCineCaptureScheduleEntry> Entries;
+	AddTestEntries(1, HighPriority, 100, Entries);
+	AddTestEntries(NumLowPriority, 0, 100, Entries);
+
+	TArray<int32> NumCaptures;
+	NumCaptures.SetNumZeroed(Entries.Num());
+	TArray<uint32> LongestWait;
+	LongestWait.SetNumZeroed(Entries.Num());
+	TArray<int32> Selected;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (FCineCaptureScheduleEntry& Entry : Entries)
+		{
+			++Entry.FramesSinceLastCapture;
+		}
+
+		Scheduler.Schedule(Entries, Selected);
+		TestEqual(TEXT("One capture per frame"), Selected.Num(), 1);
+		for (int32 Index : Selected)
+		{
+			LongestWait[Index] = FMath::Max(LongestWait[Index], Entries[Index].FramesSinceLastCapture);
+			Entries[Index].FramesSinceLastCapture = 0;
+			++NumCaptures[Index];
+		}
+	}
+
+	// A low priority entry overtakes the high priority one once it waited HighPriority frames longer, and waits behind its peers for that
+	const uint32 MaxWait = (uint32)(HighPriority + NumLowPriority + 1);
+	for (int32 Index = 1; Index < Entries.Num(); ++Index)
+	{
+		TestTrue(FString::Printf(TEXT("Low priority entry %d is captured"), Index), NumCaptures[Index] > 0);
+		TestTrue(FString::Printf(TEXT("Low priority entry %d waits at most %u frames, waited %u"), Index, MaxWait, LongestWait[Index]), LongestWait[Index] <= MaxWait);
+	}
+	TestTrue(TEXT("The high priority entry gets most captures"), NumCaptures[0] > NumFrames / 2);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureStats.h"
+#include "CineCameraCaptureComponent.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "UObject/UObjectIterator.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_STAT(STAT_CineCapture_CaptureSceneDeferred);
+DEFINE_STAT(STAT_CineCapture_UpdateCameraLens);
+DEFINE_STAT(STAT_CineCapture_Enqueue);
+DEFINE_STAT(STAT_CineCapture_UpdateDeferredCaptures);
+DEFINE_STAT(STAT_CineCapture_Schedule);
+DEFINE_STAT(STAT_CineCapture_Prepare);
+DEFINE_STAT(STAT_CineCapture_PrepareMetadata);
+DEFINE_STAT(STAT_CineCapture_Dispatch);
+DEFINE_STAT(STAT_CineCapture_RigDispatch);
+DEFINE_STAT(STAT_CineCapture_NumCaptures);
+DEFINE_STAT(STAT_CineCapture_NumSkipped);
+DEFINE_STAT(STAT_CineCapture_NumDeferred);
+DEFINE_STAT(STAT_CineCapture_NumPooledTargets);
+DEFINE_STAT(STAT_CineCapture_PooledTargetMemory);
+DEFINE_STAT(STAT_CineCapture_NumIdleViewStates);
+DEFINE_STAT(STAT_CineCapture_IdleViewStateMemory);
+
+CSV_DEFINE_CATEGORY(CineCameraCapture, true);
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineCameraCapture, Log, All);
+
+static TAutoConsoleVariable<int32> CVarCineCaptureTrackCaptureTimes(
+	TEXT("r.CineCapture.TrackCaptureTimes"),
+	0,
+	TEXT("Whether cine camera captures measure their render thread and GPU time, see r.CineCapture.DumpTopCaptures."),
+	ECVF_Default);
+
+bool IsCineCaptureTimingEnabled()
+{
+	return CVarCineCaptureTrackCaptureTimes.GetValueOnGameThread() != 0;
+}
+
+/** Exponential moving average, in integer microseconds so it can live in a thread safe counter. */
+static void SmoothMicroseconds(FThreadSafeCounter& Counter, uint64 NewMicroseconds)
+{
+	const int32 Previous = Counter.GetValue();
+	const int32 Sample = (int32)FMath::Min<uint64>(NewMicroseconds, MAX_int32);
+	Counter.Set(Previous == 0 ? Sample : (Previous * 7 + Sample) / 8);
+}
+
+void FCineCaptureTimer::BeginCapture()
+{
+	TSharedRef<FCineCaptureTimer, ESPMode::ThreadSafe> This = AsShared();
+	ENQUEUE_RENDER_COMMAND(CineCaptureTimerBegin)(
+		[This](FRHICommandListImmediate& RHICmdList)
+	{
+		This->Begin_RenderThread(RHICmdList);
+	});
+}
+
+void FCineCaptureTimer::EndCapture()
+{
+	TSharedRef<FCineCaptureTimer, ESPMode::ThreadSafe> This = AsShared();
+	ENQUEUE_RENDER_COMMAND(CineCaptureTimerEnd)(
+		[This](FRHICommandListImmediate& RHICmdList)
+	{
+		This->End_RenderThread(RHICmdList);
+	});
+	NumCaptures.Increment();
+}
+
+void FCineCaptureTimer::Begin_RenderThread(FRHICommandListImmediate& RHICmdList)
+{
+	ResolveQueries_RenderThread();
+
+	BeginCycles = FPlatformTime::Cycles64();
+
+	FQuerySlot& Slot = QuerySlots[CurrentSlot];
+	if (Slot.bPending)
+	{
+		// Queries are still in flight, skip GPU timing for this capture rather than waiting
+		return;
+	}
+	if (!Slot.BeginQuery.IsValid())
+	{
+		Slot.BeginQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+		Slot.EndQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+	}
+	if (Slot.BeginQuery.IsValid())
+	{
+		RHICmdList.EndRenderQuery(Slot.BeginQuery);
+	}
+}
+
+void FCineCaptureTimer::End_RenderThread(FRHICommandListImmediate& RHICmdList)
+{
+	SmoothMicroseconds(RenderThreadMicroseconds, (uint64)(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - BeginCycles) * 1000000.0));
+
+	FQuerySlot& Slot = QuerySlots[CurrentSlot];
+	if (!Slot.bPending && Slot.EndQuery.IsValid())
+	{
+		RHICmdList.EndRenderQuery(Slot.EndQuery);
+		Slot.bPending = true;
+		CurrentSlot = (CurrentSlot + 1) % NumQuerySlots;
+	}
+}
+
+void FCineCaptureTimer::ResolveQueries_RenderThread()
+{
+	for (FQuerySlot& Slot : QuerySlots)
+	{
+		uint64 BeginMicroseconds = 0;
+		uint64 EndMicroseconds = 0;
+		if (Slot.bPending
+			&& RHIGetRenderQueryResult(Slot.BeginQuery, BeginMicroseconds, false)
+			&& RHIGetRenderQueryResult(Slot.EndQuery, EndMicroseconds, false))
+		{
+			SmoothMicroseconds(GPUMicroseconds, EndMicroseconds > BeginMicroseconds ? EndMicroseconds - BeginMicroseconds : 0);
+			Slot.bPending = false;
+		}
+	}
+}
+
+bool FCineCaptureScopedTiming::bRecording = false;
+
+struct FCineCaptureTimingTotals
+{
+	FThreadSafeCounter64 Cycles[(int32)ECineCaptureTimedScope::Num];
+	FThreadSafeCounter64 Calls[(int32)ECineCaptureTimedScope::Num];
+	uint64 StartFrame = 0;
+	double StartTime = 0.0;
+};
+static FCineCaptureTimingTotals TimingTotals;
+
+void FCineCaptureScopedTiming::Accumulate(ECineCaptureTimedScope Scope, uint64 Cycles)
+{
+	// Called from parallel transform updates too
+	TimingTotals.Cycles[(int32)Scope].Add((int64)Cycles);
+	TimingTotals.Calls[(int32)Scope].Increment();
+}
+
+void FCineCaptureScopedTiming::StartRecording()
+{
+	check(IsInGameThread());
+
+	for (int32 Index = 0; Index < (int32)ECineCaptureTimedScope::Num; ++Index)
+	{
+		TimingTotals.Cycles[Index].Reset();
+		TimingTotals.Calls[Index].Reset();
+	}
+	TimingTotals.StartFrame = GFrameCounter;
+	TimingTotals.StartTime = FPlatformTime::Seconds();
+	bRecording = true;
+}
+
+FString FCineCaptureScopedTiming::StopRecording()
+{
+	check(IsInGameThread());
+
+	bRecording = false;
+
+	static const TCHAR* ScopeNames[] = { TEXT("CaptureSceneDeferred"), TEXT("UpdateCameraLensCapture"), TEXT("UpdateDeferredCaptures") };
+	static_assert(ARRAY_COUNT(ScopeNames) == (int32)ECineCaptureTimedScope::Num, "Missing ECineCaptureTimedScope name");
+
+	const uint64 NumFrames = FMath::Max<uint64>(GFrameCounter - TimingTotals.StartFrame, 1);
+
+	// Component counts per capture mode, so results of differently populated runs aren't compared by accident
+	int32 NumComponents = 0;
+	int32 NumEveryFrame = 0;
+	int32 NumOnMovement = 0;
+	for (TObjectIterator<UCineCameraCaptureComponent> It; It; ++It)
+	{
+		if (!It->IsTemplate() && It->IsRegistered())
+		{
+			++NumComponents;
+			NumEveryFrame += It->bCaptureEveryFrame ? 1 : 0;
+			NumOnMovement += It->bCaptureOnMovement ? 1 : 0;
+		}
+	}
+
+	FString Json = TEXT("{\n");
+	Json += FString::Printf(TEXT("\t\"frames\": %llu,\n"), NumFrames);
+	Json += FString::Printf(TEXT("\t\"seconds\": %.6f,\n"), FPlatformTime::Seconds() - TimingTotals.StartTime);
+	Json += FString::Printf(TEXT("\t\"components\": { \"total\": %d, \"capture_every_frame\": %d, \"capture_on_movement\": %d },\n"), NumComponents, NumEveryFrame, NumOnMovement);
+	Json += TEXT("\t\"game_thread\": {\n");
+	for (int32 Index = 0; Index < (int32)ECineCaptureTimedScope::Num; ++Index)
+	{
+		const double TotalMs = FPlatformTime::ToMilliseconds64((uint64)TimingTotals.Cycles[Index].GetValue());
+		const int64 Calls = TimingTotals.Calls[Index].GetValue();
+		Json += FString::Printf(TEXT("\t\t\"%s\": { \"calls\": %lld, \"total_ms\": %.4f, \"ms_per_frame\": %.4f, \"us_per_call\": %.4f }%s\n"),
+			ScopeNames[Index], Calls, TotalMs, TotalMs / NumFrames, Calls > 0 ? TotalMs * 1000.0 / Calls : 0.0,
+			Index + 1 < (int32)ECineCaptureTimedScope::Num ? TEXT(",") : TEXT(""));
+	}
+	Json += TEXT("\t}\n}\n");
+	return Json;
+}
+
+static void StartTimings(const TArray<FString>& Args)
+{
+	FCineCaptureScopedTiming::StartRecording();
+}
+
+static void StopTimings(const TArray<FString>& Args)
+{
+	const FString Json = FCineCaptureScopedTiming::StopRecording();
+	if (Args.Num() > 0)
+	{
+		const FString Filename = FPaths::ConvertRelativePathToFull(Args[0]);
+		if (FFileHelper::SaveStringToFile(Json, *Filename))
+		{
+			UE_LOG(LogCineCameraCapture, Display, TEXT("Wrote cine camera capture timings to %s"), *Filename);
+		}
+		else
+		{
+			UE_LOG(LogCineCameraCapture, Error, TEXT("Failed to write cine camera capture timings to %s"), *Filename);
+		}
+	}
+	else
+	{
+		UE_LOG(LogCineCameraCapture, Display, TEXT("%s"), *Json);
+	}
+}
+
+static FAutoConsoleCommand StartTimingsCommand(
+	TEXT("r.CineCapture.Timings.Start"),
+	TEXT("Starts recording game thread time spent in CaptureSceneDeferred, UpdateCameraLensCapture and UpdateDeferredCaptures."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StartTimings));
+
+static FAutoConsoleCommand StopTimingsCommand(
+	TEXT("r.CineCapture.Timings.Stop"),
+	TEXT("Stops recording cine camera capture timings and writes them as JSON to the given file, or to the log without one."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StopTimings));
+
+static void DumpTopCaptures(const TArray<FString>& Args)
+{
+	const int32 NumToDump = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+
+	struct FCaptureCost
+	{
+		FString Name;
+		float RenderThreadMs;
+		float GPUMs;
+		int32 FramesSinceLastCapture;
+	};
+	TArray<FCaptureCost> Costs;
+
+	for (TObjectIterator<UCineCameraCaptureComponent> It; It; ++It)
+	{
+		const FCineCaptureTimer* Timer = It->GetCaptureTimer();
+		if (Timer && !It->IsTemplate())
+		{
+			FCaptureCost& Cost = Costs.AddDefaulted_GetRef();
+			Cost.Name = It->GetPathName();
+			Cost.RenderThreadMs = Timer->GetRenderThreadMs();
+			Cost.GPUMs = Timer->GetGPUMs();
+			Cost.FramesSinceLastCapture = It->GetFramesSinceLastCapture();
+		}
+	}
+
+	if (Costs.Num() == 0)
+	{
+		UE_LOG(LogCineCameraCapture, Display, TEXT("No capture timings recorded, enable them with r.CineCapture.TrackCaptureTimes 1"));
+		return;
+	}
+
+	Costs.Sort([](const FCaptureCost& A, const FCaptureCost& B)
+	{
+		return A.GPUMs + A.RenderThreadMs > B.GPUMs + B.RenderThreadMs;
+	});
+
+	UE_LOG(LogCineCameraCapture, Display, TEXT("Top %d of %d cine camera captures:"), FMath::Min(NumToDump, Costs.Num()), Costs.Num());
+	UE_LOG(LogCineCameraCapture, Display, TEXT("%8s %8s %8s  %s"), TEXT("GPU ms"), TEXT("RT ms"), TEXT("Age"), TEXT("Component"));
+	for (int32 Index = 0; Index < Costs.Num() && Index < NumToDump; ++Index)
+	{
+		const FCaptureCost& Cost = Costs[Index];
+		UE_LOG(LogCineCameraCapture, Display, TEXT("%8.3f %8.3f %8d  %s"), Cost.GPUMs, Cost.RenderThreadMs, Cost.FramesSinceLastCapture, *Cost.Name);
+	}
+}
+
+static FAutoConsoleCommand DumpTopCapturesCommand(
+	TEXT("r.CineCapture.DumpTopCaptures"),
+	TEXT("Logs the N (default 10) most expensive cine camera captures by GPU + render thread time. Requires r.CineCapture.TrackCaptureTimes 1."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&DumpTopCaptures));
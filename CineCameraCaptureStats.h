@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "RHI.h"
+#include "RHIResources.h"
+#include "HAL/ThreadSafeCounter.h"
+
+DECLARE_STATS_GROUP(TEXT("CineCameraCapture"), STATGROUP_CineCameraCapture, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CaptureSceneDeferred"), STAT_CineCapture_CaptureSceneDeferred, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateCameraLensCapture"), STAT_CineCapture_UpdateCameraLens, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enqueue"), STAT_CineCapture_Enqueue, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateDeferredCaptures"), STAT_CineCapture_UpdateDeferredCaptures, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Schedule"), STAT_CineCapture_Schedule, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prepare"), STAT_CineCapture_Prepare, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prepare Metadata"), STAT_CineCapture_PrepareMetadata, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dispatch"), STAT_CineCapture_Dispatch, STATGROUP_CineCameraCapture, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rig Dispatch"), STAT_CineCapture_RigDispatch, STATGROUP_CineCameraCapture, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Captures"), STAT_CineCapture_NumCaptures, STATGROUP_CineCameraCapture, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Skipped Captures"), STAT_CineCapture_NumSkipped, STATGROUP_CineCameraCapture, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deferred Captures"), STAT_CineCapture_NumDeferred, STATGROUP_CineCameraCapture, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Pooled Render Targets"), STAT_CineCapture_NumPooledTargets, STATGROUP_CineCameraCapture, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Pooled Render Target Memory"), STAT_CineCapture_PooledTargetMemory, STATGROUP_CineCameraCapture, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Idle View States"), STAT_CineCapture_NumIdleViewStates, STATGROUP_CineCameraCapture, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Idle View State Memory"), STAT_CineCapture_IdleViewStateMemory, STATGROUP_CineCameraCapture, );
+
+CSV_DECLARE_CATEGORY_EXTERN(CineCameraCapture);
+
+/** Game thread functions whose totals are recorded between r.CineCapture.Timings.Start and r.CineCapture.Timings.Stop. */
+enum class ECineCaptureTimedScope : uint8
+{
+	CaptureSceneDeferred,
+	UpdateCameraLensCapture,
+	UpdateDeferredCaptures,
+	Num
+};
+
+/** Accumulates time spent in a scope into the recorded totals, costs a single branch while nothing is being recorded. */
+class CINEMATICCAMERA_API FCineCaptureScopedTiming
+{
+public:
+	explicit FCineCaptureScopedTiming(ECineCaptureTimedScope InScope)
+		: Scope(InScope)
+		, StartCycles(bRecording ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FCineCaptureScopedTiming()
+	{
+		if (StartCycles != 0)
+		{
+			Accumulate(Scope, FPlatformTime::Cycles64() - StartCycles);
+		}
+	}
+
+	static void StartRecording();
+	/** Stops recording and returns the totals as a JSON document. */
+	static FString StopRecording();
+
+private:
+	static void Accumulate(ECineCaptureTimedScope Scope, uint64 Cycles);
+
+	static bool bRecording;
+
+	ECineCaptureTimedScope Scope;
+	uint64 StartCycles;
+};
+
+/** Whether capture components measure their own render thread and GPU time, see r.CineCapture.TrackCaptureTimes. */
+bool IsCineCaptureTimingEnabled();
+
+/**
+ * Render thread and GPU time of one capture component.
+ * Render commands bracket the capture's own commands, GPU time comes from timestamp queries that are read back a few frames later without waiting.
+ */
+class CINEMATICCAMERA_API FCineCaptureTimer : public TSharedFromThis<FCineCaptureTimer, ESPMode::ThreadSafe>
+{
+public:
+	/** Game thread. Call right before enqueueing the capture's render commands. */
+	void BeginCapture();
+
+	/** Game thread. Call right after enqueueing the capture's render commands. */
+	void EndCapture();
+
+	/** Smoothed render thread time of a capture, in milliseconds. */
+	float GetRenderThreadMs() const { return RenderThreadMicroseconds.GetValue() / 1000.0f; }
+
+	/** Smoothed GPU time of a capture, in milliseconds. 0 until the first queries resolved. */
+	float GetGPUMs() const { return GPUMicroseconds.GetValue() / 1000.0f; }
+
+	/** Total captures measured. */
+	int32 GetNumCaptures() const { return NumCaptures.GetValue(); }
+
+private:
+	enum { NumQuerySlots = 4 };
+
+	struct FQuerySlot
+	{
+		FRenderQueryRHIRef BeginQuery;
+		FRenderQueryRHIRef EndQuery;
+		bool bPending = false;
+	};
+
+	void Begin_RenderThread(FRHICommandListImmediate& RHICmdList);
+	void End_RenderThread(FRHICommandListImmediate& RHICmdList);
+	/** Reads back finished queries without waiting. */
+	void ResolveQueries_RenderThread();
+
+	/** Render thread only. */
+	FQuerySlot QuerySlots[NumQuerySlots];
+	int32 CurrentSlot = 0;
+	uint64 BeginCycles = 0;
+
+	FThreadSafeCounter RenderThreadMicroseconds;
+	FThreadSafeCounter GPUMicroseconds;
+	FThreadSafeCounter NumCaptures;
+};
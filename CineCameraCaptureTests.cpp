@@ -0,0 +1,695 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureComponent.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/UObjectGlobals.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "CineCameraCaptureStats.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/DirectionalLight.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "RenderingThread.h"
+#include "RHI.h"
+#include "ShaderCompiler.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialExpressionDivide.h"
+#include "Materials/MaterialExpressionSceneTexture.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Reaches the protected parts of the capture component the tests drive directly. */
+struct FCineCaptureTestAccess
+{
+	static void CaptureSceneDeferred(UCineCameraCaptureComponent* Capture)
+	{
+		Capture->CaptureSceneDeferred();
+	}
+
+	static void UpdateCameraLensCapture(UCineCameraCaptureComponent* Capture, float DeltaTime)
+	{
+		Capture->UpdateCameraLensCapture(DeltaTime);
+	}
+
+	/** The lens update as it was before the lens post process was cached: every call copies PostProcessSettings whole. */
+	static void UpdateCameraLensCaptureUncached(UCineCameraCaptureComponent* Capture, float DeltaTime)
+	{
+		Capture->RecalcDerivedData();
+
+		Capture->CameraLensPostProcessSettings = Capture->PostProcessSettings;
+
+		if (Capture->FocusSettings.FocusMethod == ECameraFocusMethod::None)
+		{
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = false;
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = false;
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = false;
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = false;
+		}
+		else
+		{
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldMethod = true;
+			Capture->CameraLensPostProcessSettings.DepthOfFieldMethod = Capture->PostProcessSettings.DepthOfFieldMethod;
+
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldFstop = true;
+			Capture->CameraLensPostProcessSettings.DepthOfFieldFstop = Capture->CurrentAperture;
+
+			Capture->CurrentFocusDistance = Capture->GetDesiredFocusDistance(Capture->GetComponentLocation());
+
+			float const MinFocusDistInWorldUnits = Capture->LensSettings.MinimumFocusDistance * (Capture->GetWorldToMetersScale() / 1000.f);
+			Capture->CurrentFocusDistance = FMath::Max(Capture->CurrentFocusDistance, MinFocusDistInWorldUnits);
+
+			if (Capture->FocusSettings.bSmoothFocusChanges)
+			{
+				if (Capture->bResetInterpolation == false)
+				{
+					Capture->CurrentFocusDistance = FMath::FInterpTo(Capture->LastFocusDistance, Capture->CurrentFocusDistance, DeltaTime, Capture->FocusSettings.FocusSmoothingInterpSpeed);
+				}
+			}
+			Capture->LastFocusDistance = Capture->CurrentFocusDistance;
+
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldFocalDistance = true;
+			Capture->CameraLensPostProcessSettings.DepthOfFieldFocalDistance = Capture->CurrentFocusDistance;
+
+			Capture->CameraLensPostProcessSettings.bOverride_DepthOfFieldSensorWidth = true;
+			Capture->CameraLensPostProcessSettings.DepthOfFieldSensorWidth = Capture->FilmbackSettings.SensorWidth;
+		}
+
+		Capture->bResetInterpolation = false;
+	}
+
+	static FCineCameraIntrinsics GetCaptureIntrinsics(const UCineCameraCaptureComponent* Capture, const FIntPoint& Resolution)
+	{
+		return Capture->GetCaptureIntrinsics(Resolution);
+	}
+
+	static bool IsQueuedForCapture(const UCineCameraCaptureComponent* Capture)
+	{
+		return Capture->bQueuedForCapture;
+	}
+};
+
+/** A game world of its own for one test, destroyed with it. Every capture gets an actor of its own so it can move independently. */
+class FCineCaptureTestWorld
+{
+public:
+	FCineCaptureTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FCineCaptureTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	/** Whether the world has a scene to capture, which -nullrhi runs have as well. */
+	bool CanCapture() const { return World && World->Scene; }
+
+	UWorld* GetWorld() const { return World; }
+
+	/** Adds a capture without a render target, so captures run the whole game thread path and render nothing. */
+	UCineCameraCaptureComponent* AddCapture(bool bCaptureEveryFrame, bool bCaptureOnMovement)
+	{
+		AActor* Actor = World->SpawnActor<AActor>();
+		UCineCameraCaptureComponent* Capture = NewObject<UCineCameraCaptureComponent>(Actor);
+		Capture->bCaptureEveryFrame = bCaptureEveryFrame;
+		Capture->bCaptureOnMovement = bCaptureOnMovement;
+		Actor->SetRootComponent(Capture);
+		Capture->RegisterComponent();
+		return Capture;
+	}
+
+	/** One frame as the engine loop runs it: ticks, end of frame updates, then the deferred captures. */
+	void Tick(float DeltaTime)
+	{
+		World->Tick(LEVELTICK_All, DeltaTime);
+		UCineCameraCaptureComponent::UpdateDeferredCaptures(World->Scene);
+		++GFrameCounter;
+	}
+
+private:
+	UWorld* World;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureQueueContentionTest, "CineCamera.Capture.QueueContention", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Enqueues every capture several times a frame from parallel tasks, like parallel transform updates do, and drains the queue.
+ * The per-world queue is compared with the global multimap behind a critical section it replaced.
+ */
+bool FCineCaptureQueueContentionTest::RunTest(const FString& Parameters)
+{
+	FCineCaptureTestWorld TestWorld;
+	if (!TestWorld.CanCapture())
+	{
+		AddWarning(TEXT("The world has no scene, skipped."));
+		return true;
+	}
+
+	const int32 NumCaptures = 1000;
+	const int32 RequestsPerFrame = 4;
+	const int32 NumFrames = 60;
+	const float DeltaTime = 1.f / 60.f;
+
+	TArray<UCineCameraCaptureComponent*> Captures;
+	for (int32 Index = 0; Index < NumCaptures; ++Index)
+	{
+		Captures.Add(TestWorld.AddCapture(false, false));
+	}
+	UWorld* World = TestWorld.GetWorld();
+
+	// The path before the per-world queue: one lock and a linear AddUnique per request, MultiFind to drain
+	TMultiMap<TWeakObjectPtr<UWorld>, TWeakObjectPtr<UCineCameraCaptureComponent> > LegacyCaptures;
+	FCriticalSection LegacyLock;
+	double LegacyEnqueueSeconds = 0.0;
+	double LegacyDrainSeconds = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		double StartTime = FPlatformTime::Seconds();
+		ParallelFor(NumCaptures, [&](int32 Index)
+		{
+			for (int32 Request = 0; Request < RequestsPerFrame; ++Request)
+			{
+				FCineCaptureTestAccess::UpdateCameraLensCapture(Captures[Index], DeltaTime);
+				FScopeLock Lock(&LegacyLock);
+				LegacyCaptures.AddUnique(World, Captures[Index]);
+			}
+		});
+		LegacyEnqueueSeconds += FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		TArray<TWeakObjectPtr<UCineCameraCaptureComponent> > ToUpdate;
+		LegacyCaptures.MultiFind(World, ToUpdate);
+		LegacyCaptures.Remove(World);
+		LegacyDrainSeconds += FPlatformTime::Seconds() - StartTime;
+
+		TestEqual(TEXT("Legacy path queued every capture once"), ToUpdate.Num(), NumCaptures);
+		++GFrameCounter;
+	}
+
+	double QueueEnqueueSeconds = 0.0;
+	double QueueDrainSeconds = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		double StartTime = FPlatformTime::Seconds();
+		ParallelFor(NumCaptures, [&](int32 Index)
+		{
+			for (int32 Request = 0; Request < RequestsPerFrame; ++Request)
+			{
+				FCineCaptureTestAccess::CaptureSceneDeferred(Captures[Index]);
+			}
+		});
+		QueueEnqueueSeconds += FPlatformTime::Seconds() - StartTime;
+
+		const int32 NumQueued = Captures.FilterByPredicate([](const UCineCameraCaptureComponent* Capture) { return FCineCaptureTestAccess::IsQueuedForCapture(Capture); }).Num();
+		TestEqual(TEXT("Every capture is queued"), NumQueued, NumCaptures);
+
+		// Drains and dispatches, the captures have no target so the renderer returns right away
+		StartTime = FPlatformTime::Seconds();
+		UCineCameraCaptureComponent::UpdateDeferredCaptures(World->Scene);
+		QueueDrainSeconds += FPlatformTime::Seconds() - StartTime;
+
+		const bool bAnyQueued = Captures.ContainsByPredicate([](const UCineCameraCaptureComponent* Capture) { return FCineCaptureTestAccess::IsQueuedForCapture(Capture); });
+		TestFalse(TEXT("Draining clears every queued flag"), bAnyQueued);
+		++GFrameCounter;
+	}
+
+	const double MsPerFrame = 1000.0 / NumFrames;
+	AddInfo(FString::Printf(TEXT("%d captures x %d requests per frame, %d worker threads"), NumCaptures, RequestsPerFrame, FTaskGraphInterface::Get().GetNumWorkerThreads()));
+	AddInfo(FString::Printf(TEXT("Multimap + lock: enqueue %.3f ms/frame, drain %.3f ms/frame"), LegacyEnqueueSeconds * MsPerFrame, LegacyDrainSeconds * MsPerFrame));
+	AddInfo(FString::Printf(TEXT("Per-world queue: enqueue %.3f ms/frame, drain and dispatch %.3f ms/frame"), QueueEnqueueSeconds * MsPerFrame, QueueDrainSeconds * MsPerFrame));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureLensCacheTest, "CineCamera.Capture.LensCache", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Times the lens update of 500 captures with the cached lens post process against the uncached update it replaced,
+ * and checks the cache rebuilds when the post process is set, and with autodetect only when a value the renderer reads changes.
+ */
+bool FCineCaptureLensCacheTest::RunTest(const FString& Parameters)
+{
+	FCineCaptureTestWorld TestWorld;
+	if (!TestWorld.CanCapture())
+	{
+		AddWarning(TEXT("The world has no scene, skipped."));
+		return true;
+	}
+
+	const int32 NumCaptures = 500;
+	const int32 NumFrames = 120;
+	const float DeltaTime = 1.f / 60.f;
+
+	TArray<UCineCameraCaptureComponent*> Captures;
+	for (int32 Index = 0; Index < NumCaptures; ++Index)
+	{
+		UCineCameraCaptureComponent* Capture = TestWorld.AddCapture(false, false);
+		FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+		Captures.Add(Capture);
+	}
+	++GFrameCounter;
+
+	auto RunFrames = [&](bool bCached)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (UCineCameraCaptureComponent* Capture : Captures)
+			{
+				if (bCached)
+				{
+					FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+				}
+				else
+				{
+					FCineCaptureTestAccess::UpdateCameraLensCaptureUncached(Capture, DeltaTime);
+				}
+			}
+			++GFrameCounter;
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumFrames;
+	};
+
+	const uint32 VersionBefore = Captures[0]->LensPostProcessVersion;
+	const double CachedMs = RunFrames(true);
+	TestEqual(TEXT("Unchanged settings do not rebuild the lens post process"), Captures[0]->LensPostProcessVersion, VersionBefore);
+	const double UncachedMs = RunFrames(false);
+
+	AddInfo(FString::Printf(TEXT("%d captures: cached %.3f ms/frame, uncached %.3f ms/frame"), NumCaptures, CachedMs, UncachedMs));
+
+	// The uncached update wrote the lens post process behind the cache's back
+	UCineCameraCaptureComponent* Capture = Captures[0];
+	Capture->MarkLensPostProcessDirty();
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+
+	uint32 Version = Capture->LensPostProcessVersion;
+	FPostProcessSettings Settings = Capture->PostProcessSettings;
+	Settings.bOverride_BloomIntensity = true;
+	Settings.BloomIntensity += 1.f;
+	Capture->SetPostProcessSettings(Settings);
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+	TestNotEqual(TEXT("Setting the post process rebuilds the lens post process"), Capture->LensPostProcessVersion, Version);
+	TestEqual(TEXT("The lens post process holds the new settings"), Capture->CameraLensPostProcessSettings.BloomIntensity, Settings.BloomIntensity);
+
+	// Autodetect catches edits made in place, but values behind a disabled override are not blended and must not rebuild anything
+	IConsoleVariable* AutoDetectVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.CineCapture.LensCacheAutoDetect"));
+	const int32 PreviousAutoDetect = AutoDetectVar->GetInt();
+	AutoDetectVar->Set(1, ECVF_SetByCode);
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+
+	Version = Capture->LensPostProcessVersion;
+	Capture->PostProcessSettings.bOverride_BloomIntensity = false;
+	Capture->PostProcessSettings.BloomIntensity += 1.f;
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+	TestEqual(TEXT("Editing a disabled override keeps the cache"), Capture->LensPostProcessVersion, Version);
+
+	Capture->PostProcessSettings.bOverride_BloomIntensity = true;
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+	TestNotEqual(TEXT("Enabling an override rebuilds the lens post process"), Capture->LensPostProcessVersion, Version);
+
+	Version = Capture->LensPostProcessVersion;
+	Capture->PostProcessSettings.BloomIntensity += 1.f;
+	FCineCaptureTestAccess::UpdateCameraLensCapture(Capture, DeltaTime);
+	++GFrameCounter;
+	TestNotEqual(TEXT("Editing an enabled override rebuilds the lens post process"), Capture->LensPostProcessVersion, Version);
+
+	AutoDetectVar->Set(PreviousAutoDetect, ECVF_SetByCode);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureSchedulingBenchmarkTest, "CineCamera.Capture.SchedulingBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Runs 10, 100 and 1000 captures with mixed capture modes for a few hundred frames, moving all of them every frame, and records the game thread time
+ * of CaptureSceneDeferred, UpdateCameraLensCapture and UpdateDeferredCaptures with r.CineCapture.Timings.
+ * New positions are computed on parallel tasks, and the end of frame updates push the render transforms, and with them the movement captures, from parallel tasks too.
+ * Runs under -nullrhi. The results are written as JSON to Saved/Automation/CineCameraCaptureSchedulingBenchmark.json.
+ */
+bool FCineCaptureSchedulingBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 CaptureCounts[] = { 10, 100, 1000 };
+	const int32 NumWarmupFrames = 10;
+	const int32 NumFrames = 300;
+	const float DeltaTime = 1.f / 60.f;
+
+	TArray<FString> Runs;
+	for (const int32 NumCaptures : CaptureCounts)
+	{
+		FCineCaptureTestWorld TestWorld;
+		if (!TestWorld.CanCapture())
+		{
+			AddWarning(TEXT("The world has no scene, skipped."));
+			return true;
+		}
+
+		// Every frame, on movement, and both
+		TArray<UCineCameraCaptureComponent*> Captures;
+		for (int32 Index = 0; Index < NumCaptures; ++Index)
+		{
+			Captures.Add(TestWorld.AddCapture(Index % 3 != 1, Index % 3 != 0));
+		}
+
+		TArray<FVector> Locations;
+		Locations.SetNumUninitialized(NumCaptures);
+		auto TickFrame = [&](int32 Frame)
+		{
+			ParallelFor(NumCaptures, [&Locations, Frame](int32 Index)
+			{
+				const float Angle = (Frame + Index) * 0.01f;
+				Locations[Index] = FVector(Index * 100.f, FMath::Cos(Angle) * 500.f, FMath::Sin(Angle) * 500.f);
+			});
+			for (int32 Index = 0; Index < NumCaptures; ++Index)
+			{
+				Captures[Index]->SetWorldLocation(Locations[Index]);
+			}
+			TestWorld.Tick(DeltaTime);
+		};
+
+		for (int32 Frame = 0; Frame < NumWarmupFrames; ++Frame)
+		{
+			TickFrame(Frame);
+		}
+
+		FCineCaptureScopedTiming::StartRecording();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			TickFrame(NumWarmupFrames + Frame);
+		}
+		FString Run = FCineCaptureScopedTiming::StopRecording();
+		Run.TrimEndInline();
+		Runs.Add(Run.Replace(TEXT("\n"), TEXT("\n\t\t")));
+
+		AddInfo(FString::Printf(TEXT("%d captures:\n%s"), NumCaptures, *Run));
+	}
+
+	const FString Json = FString::Printf(TEXT("{\n\t\"benchmark\": \"CineCamera.Capture.SchedulingBenchmark\",\n\t\"runs\": [\n\t\t%s\n\t]\n}\n"), *FString::Join(Runs, TEXT(",\n\t\t")));
+	const FString Filename = FPaths::ConvertRelativePathToFull(FPaths::AutomationDir() / TEXT("CineCameraCaptureSchedulingBenchmark.json"));
+	TestTrue(TEXT("Wrote the benchmark results"), FFileHelper::SaveStringToFile(Json, *Filename));
+	AddInfo(FString::Printf(TEXT("Results written to %s"), *Filename));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCapturePrepareScalingTest, "CineCamera.Capture.PrepareScaling", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Times UpdateDeferredCaptures() for 256 captures whose focal length changes every frame, so every lens post process is rebuilt,
+ * once with the prepare phase on the game thread only (r.CineCapture.ParallelPrepareMinCaptures 0) and once spread over the workers.
+ * Runs under -nullrhi, where dispatching a capture without a render target costs next to nothing.
+ */
+bool FCineCapturePrepareScalingTest::RunTest(const FString& Parameters)
+{
+	FCineCaptureTestWorld TestWorld;
+	if (!TestWorld.CanCapture())
+	{
+		AddWarning(TEXT("The world has no scene, skipped."));
+		return true;
+	}
+
+	const int32 NumCaptures = 256;
+	const int32 NumFrames = 120;
+	const float DeltaTime = 1.f / 60.f;
+	UWorld* World = TestWorld.GetWorld();
+
+	TArray<UCineCameraCaptureComponent*> Captures;
+	for (int32 Index = 0; Index < NumCaptures; ++Index)
+	{
+		Captures.Add(TestWorld.AddCapture(true, false));
+	}
+
+	IConsoleVariable* MinCaptures = IConsoleManager::Get().FindConsoleVariable(TEXT("r.CineCapture.ParallelPrepareMinCaptures"));
+	if (!TestNotNull(TEXT("r.CineCapture.ParallelPrepareMinCaptures exists"), MinCaptures))
+	{
+		return false;
+	}
+	const int32 OwnMinCaptures = MinCaptures->GetInt();
+
+	auto RunFrames = [&](int32 InMinCaptures)
+	{
+		MinCaptures->Set(InMinCaptures, ECVF_SetByCode);
+		double Seconds = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 Index = 0; Index < NumCaptures; ++Index)
+			{
+				Captures[Index]->CurrentFocalLength = 35.f + FMath::Sin((Frame + Index) * 0.1f) * 10.f;
+			}
+			World->Tick(LEVELTICK_All, DeltaTime);
+
+			const double StartTime = FPlatformTime::Seconds();
+			UCineCameraCaptureComponent::UpdateDeferredCaptures(World->Scene);
+			Seconds += FPlatformTime::Seconds() - StartTime;
+			++GFrameCounter;
+		}
+		return Seconds * 1000.0 / NumFrames;
+	};
+
+	RunFrames(0);
+	const double SerialMs = RunFrames(0);
+	const double ParallelMs = RunFrames(1);
+	MinCaptures->Set(OwnMinCaptures, ECVF_SetByCode);
+
+	AddInfo(FString::Printf(TEXT("%d captures: game thread only %.3f ms/frame, %d workers %.3f ms/frame (%.2fx)"),
+		NumCaptures, SerialMs, FTaskGraphInterface::Get().GetNumWorkerThreads(), ParallelMs, ParallelMs > 0.0 ? SerialMs / ParallelMs : 0.0));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureProfileTimingTest, "CineCamera.Capture.ProfileTiming", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Renders a 1920x1080 capture of a lit grid of cubes with every ECineCaptureProfile, each with the capture source its output uses,
+ * and reports the render thread and GPU time of a capture measured with r.CineCapture.TrackCaptureTimes.
+ * Needs a real RHI. The results are written as JSON to Saved/Automation/CineCameraCaptureProfileTiming.json.
+ */
+bool FCineCaptureProfileTimingTest::RunTest(const FString& Parameters)
+{
+	if (!FApp::CanEverRender() || GUsingNullRHI)
+	{
+		AddWarning(TEXT("No RHI to time captures on, skipped."));
+		return true;
+	}
+
+	FCineCaptureTestWorld TestWorld;
+	if (!TestWorld.CanCapture())
+	{
+		AddWarning(TEXT("The world has no scene, skipped."));
+		return true;
+	}
+
+	const int32 NumWarmupFrames = 30;
+	const int32 NumFrames = 120;
+	const float DeltaTime = 1.f / 60.f;
+	UWorld* World = TestWorld.GetWorld();
+
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!TestNotNull(TEXT("Engine cube mesh"), Cube))
+	{
+		return false;
+	}
+	for (int32 Index = 0; Index < 400; ++Index)
+	{
+		const FVector Location(1000.f + (Index / 20) * 150.f, ((Index % 20) - 10) * 150.f, (Index % 7) * 40.f);
+		AStaticMeshActor* Actor = World->SpawnActor<AStaticMeshActor>(Location, FRotator(0.f, Index * 17.f, 0.f));
+		Actor->GetStaticMeshComponent()->SetStaticMesh(Cube);
+	}
+	World->SpawnActor<ADirectionalLight>(FVector::ZeroVector, FRotator(-45.f, 30.f, 0.f));
+
+	UCineCameraCaptureComponent* Capture = TestWorld.AddCapture(true, false);
+	UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(Capture);
+	Target->InitCustomFormat(1920, 1080, PF_FloatRGBA, false);
+	Capture->TextureTarget = Target;
+
+	IConsoleVariable* TrackCaptureTimes = IConsoleManager::Get().FindConsoleVariable(TEXT("r.CineCapture.TrackCaptureTimes"));
+	if (!TestNotNull(TEXT("r.CineCapture.TrackCaptureTimes exists"), TrackCaptureTimes))
+	{
+		return false;
+	}
+	const int32 OwnTrackCaptureTimes = TrackCaptureTimes->GetInt();
+	TrackCaptureTimes->Set(1, ECVF_SetByCode);
+
+	const UEnum* ProfileEnum = StaticEnum<ECineCaptureProfile>();
+	TArray<FString> Runs;
+	for (int32 ProfileIndex = 0; ProfileIndex < ProfileEnum->NumEnums() - 1; ++ProfileIndex)
+	{
+		const ECineCaptureProfile Profile = (ECineCaptureProfile)ProfileEnum->GetValueByIndex(ProfileIndex);
+		Capture->SetCaptureProfile(Profile);
+		Capture->CaptureSource = Profile == ECineCaptureProfile::DepthOnly ? SCS_SceneDepth : Profile == ECineCaptureProfile::Normals ? SCS_Normal : SCS_FinalColorLDR;
+
+		// The timer smooths over recent captures, so let the previous profile's times wash out before reading
+		for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+		{
+			TestWorld.Tick(DeltaTime);
+			FlushRenderingCommands();
+		}
+
+		const FCineCaptureTimer* Timer = Capture->GetCaptureTimer();
+		if (!TestNotNull(TEXT("The capture is timed"), Timer))
+		{
+			break;
+		}
+		const FString ProfileName = ProfileEnum->GetNameStringByIndex(ProfileIndex);
+		AddInfo(FString::Printf(TEXT("%-12s render thread %6.2f ms, GPU %6.2f ms"), *ProfileName, Timer->GetRenderThreadMs(), Timer->GetGPUMs()));
+		Runs.Add(FString::Printf(TEXT("{ \"profile\": \"%s\", \"render_thread_ms\": %.3f, \"gpu_ms\": %.3f }"), *ProfileName, Timer->GetRenderThreadMs(), Timer->GetGPUMs()));
+	}
+
+	TrackCaptureTimes->Set(OwnTrackCaptureTimes, ECVF_SetByCode);
+
+	const FString Json = FString::Printf(TEXT("{\n\t\"benchmark\": \"CineCamera.Capture.ProfileTiming\",\n\t\"resolution\": [1920, 1080],\n\t\"profiles\": [\n\t\t%s\n\t]\n}\n"), *FString::Join(Runs, TEXT(",\n\t\t")));
+	const FString Filename = FPaths::ConvertRelativePathToFull(FPaths::AutomationDir() / TEXT("CineCameraCaptureProfileTiming.json"));
+	TestTrue(TEXT("Wrote the benchmark results"), FFileHelper::SaveStringToFile(Json, *Filename));
+	AddInfo(FString::Printf(TEXT("Results written to %s"), *Filename));
+	return true;
+}
+
+#if WITH_EDITOR
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineCaptureSegmentationIdsTest, "CineCamera.Capture.SegmentationIds", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * Renders three cubes with segmentation ids 5, 300 and 700 out of 800, so two id bits above the stencil digit are in use,
+ * and checks the ids decoded from the stencil and depth renders at the cubes' centers and the background.
+ * Needs a real RHI, and the editor to compile the stencil post process material.
+ */
+bool FCineCaptureSegmentationIdsTest::RunTest(const FString& Parameters)
+{
+	if (!FApp::CanEverRender() || GUsingNullRHI)
+	{
+		AddWarning(TEXT("No RHI to render segmentation on, skipped."));
+		return true;
+	}
+
+	FCineCaptureTestWorld TestWorld;
+	if (!TestWorld.CanCapture())
+	{
+		AddWarning(TEXT("The world has no scene, skipped."));
+		return true;
+	}
+
+	UWorld* World = TestWorld.GetWorld();
+	UCineSegmentationSubsystem* Segmentation = World->GetSubsystem<UCineSegmentationSubsystem>();
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!TestNotNull(TEXT("Segmentation subsystem"), Segmentation) || !TestNotNull(TEXT("Engine cube mesh"), Cube))
+	{
+		return false;
+	}
+
+	// CustomStencil / 255 in place of the tonemapper, as SegmentationMaterial documents
+	UMaterial* Material = NewObject<UMaterial>(GetTransientPackage());
+	Material->MaterialDomain = MD_PostProcess;
+	Material->BlendableLocation = BL_ReplacingTonemapper;
+	UMaterialExpressionSceneTexture* Stencil = NewObject<UMaterialExpressionSceneTexture>(Material);
+	Stencil->SceneTextureId = PPI_CustomStencil;
+	UMaterialExpressionDivide* Divide = NewObject<UMaterialExpressionDivide>(Material);
+	Divide->A.Expression = Stencil;
+	Divide->ConstB = 255.f;
+	Material->Expressions.Add(Stencil);
+	Material->Expressions.Add(Divide);
+	Material->EmissiveColor.Expression = Divide;
+	Material->PostEditChange();
+	if (GShaderCompilingManager)
+	{
+		GShaderCompilingManager->FinishAllCompilation();
+	}
+
+	IConsoleVariable* CustomDepth = IConsoleManager::Get().FindConsoleVariable(TEXT("r.CustomDepth"));
+	const int32 OwnCustomDepth = CustomDepth->GetInt();
+	CustomDepth->Set(3, ECVF_SetByCode);
+
+	// Cubes 200 units wide, 1000 in front of the capture and 250 apart; the rest of the ids go to components never placed in the world
+	const int32 NumIds = 800;
+	const uint32 CubeIds[] = { 5, 300, 700 };
+	const float CubeOffsets[] = { -250.f, 0.f, 250.f };
+	TArray<TStrongObjectPtr<UPrimitiveComponent> > Unplaced;
+	int32 NextCube = 0;
+	for (uint32 Id = 1; Id <= NumIds; ++Id)
+	{
+		if (NextCube < (int32)ARRAY_COUNT(CubeIds) && Id == CubeIds[NextCube])
+		{
+			AStaticMeshActor* Actor = World->SpawnActor<AStaticMeshActor>(FVector(1000.f, CubeOffsets[NextCube], 0.f), FRotator::ZeroRotator);
+			Actor->GetStaticMeshComponent()->SetStaticMesh(Cube);
+			Actor->SetActorScale3D(FVector(2.f));
+			TestEqual(TEXT("Cube id"), (uint32)Segmentation->RegisterActor(Actor, TEXT("Cube")), Id);
+			++NextCube;
+		}
+		else
+		{
+			UPrimitiveComponent* Component = NewObject<UStaticMeshComponent>(GetTransientPackage());
+			Segmentation->RegisterComponent(Component, TEXT("Unplaced"));
+			Unplaced.Emplace(Component);
+		}
+	}
+	TestEqual(TEXT("Id bits above the stencil digit"), Segmentation->GetNumIdBits(), 2);
+
+	const FIntPoint Resolution(384, 216);
+	UCineCameraCaptureComponent* Capture = TestWorld.AddCapture(true, false);
+	UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(Capture);
+	Target->InitCustomFormat(Resolution.X, Resolution.Y, PF_B8G8R8A8, true);
+	FCineCaptureOutputTarget Output;
+	Output.Output = ECineCaptureOutput::Segmentation;
+	Output.Target = Target;
+	Capture->Outputs.Add(Output);
+	Capture->SegmentationMaterial = Material;
+
+	TArray<uint32> Ids;
+	Capture->OnCaptureOutputReady.AddLambda([&Ids](ECineCaptureOutput InOutput, const FCineCaptureFrame& Frame)
+	{
+		if (InOutput == ECineCaptureOutput::Segmentation && Frame.PixelFormat == PF_R32_UINT)
+		{
+			Ids.SetNumUninitialized(Frame.Width * Frame.Height);
+			for (int32 Row = 0; Row < Frame.Height; ++Row)
+			{
+				FMemory::Memcpy(&Ids[Row * Frame.Width], Frame.Data->GetData() + Row * Frame.Stride, Frame.Width * sizeof(uint32));
+			}
+		}
+	});
+
+	// A few frames for the first captures to be read back
+	for (int32 Frame = 0; Frame < 60 && Ids.Num() == 0; ++Frame)
+	{
+		TestWorld.Tick(1.f / 60.f);
+		FlushRenderingCommands();
+	}
+	CustomDepth->Set(OwnCustomDepth, ECVF_SetByCode);
+
+	if (!TestEqual(TEXT("A segmentation frame was read back"), Ids.Num(), Resolution.X * Resolution.Y))
+	{
+		return false;
+	}
+
+	const FCineCameraIntrinsics Intrinsics = FCineCaptureTestAccess::GetCaptureIntrinsics(Capture, Resolution);
+	for (int32 Index = 0; Index < (int32)ARRAY_COUNT(CubeIds); ++Index)
+	{
+		// The cube's front face center, X forward and Y right of the capture
+		const int32 Column = FMath::RoundToInt(Intrinsics.PrincipalPointX + Intrinsics.FocalLengthX * CubeOffsets[Index] / 900.f);
+		const int32 Row = FMath::RoundToInt(Intrinsics.PrincipalPointY);
+		TestEqual(FString::Printf(TEXT("Id of the cube at pixel %d, %d"), Column, Row), Ids[Row * Resolution.X + Column], CubeIds[Index]);
+	}
+	TestEqual(TEXT("Background id"), Ids[0], 0u);
+	return true;
+}
+
+#endif // WITH_EDITOR
+
+#endif // WITH_DEV_AUTOMATION_TESTS
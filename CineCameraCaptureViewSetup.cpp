@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraCaptureViewSetup.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarCineCaptureParallelPrepareMinCaptures(
+	TEXT("r.CineCapture.ParallelPrepareMinCaptures"),
+	4,
+	TEXT("Captures are prepared on worker threads once at least this many are dispatched in a frame. 0 prepares everything on the game thread."),
+	ECVF_Default);
+
+bool FCineCaptureViewSetup::ShouldBuildInParallel(int32 NumSetups)
+{
+	const int32 MinCaptures = CVarCineCaptureParallelPrepareMinCaptures.GetValueOnGameThread();
+	return MinCaptures > 0 && NumSetups >= MinCaptures;
+}
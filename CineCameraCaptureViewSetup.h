@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CineCameraPrimitiveSet.h"
+#include "CineCameraSharedMemoryExport.h"
+
+struct FPostProcessSettings;
+
+/**
+ * What a capture needs from its component to be set up as a view of a capture rig's family, gathered before the family is rendered.
+ * Setups of different components are built in parallel (see UCineCameraCaptureComponent::BuildViewSetup()) and the views are added one by one afterwards,
+ * so the per-camera math runs on every core instead of only on the game thread.
+ * Single captures can't use them: FSceneInterface::UpdateSceneCaptureContents() builds its view from the component and takes no prebuilt one.
+ */
+struct FCineCaptureViewSetup
+{
+	FVector ViewLocation = FVector::ZeroVector;
+	/** World to view rotation, already swizzled to the axes the renderer expects. */
+	FMatrix ViewRotationMatrix = FMatrix::Identity;
+	FMatrix ProjectionMatrix = FMatrix::Identity;
+	/** World to camera in engine axes (X forward, Y right, Z up), without the swizzle. */
+	FMatrix WorldToCamera = FMatrix::Identity;
+	FIntRect ViewRect;
+	float FieldOfView = 90.f;
+	bool bCameraCut = false;
+	FCineCameraIntrinsics Intrinsics;
+	FCinePrimitiveIdSetPtr HiddenPrimitiveIds;
+	/** Null unless the component renders its show-only list. */
+	FCinePrimitiveIdSetPtr ShowOnlyPrimitiveIds;
+	/** The component's lens post process. Lens updates happen before the setups are built, so it does not change until the setup is submitted. */
+	const FPostProcessSettings* LensPostProcess = nullptr;
+	float PostProcessBlendWeight = 1.f;
+
+	/** Whether NumSetups setups are worth spreading over worker threads, see r.CineCapture.ParallelPrepareMinCaptures. */
+	static bool ShouldBuildInParallel(int32 NumSetups);
+};
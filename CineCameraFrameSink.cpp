@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraFrameSink.h"
+#include "CineCameraPixelConversion.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/FileManager.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineFrameSink, Log, All);
+
+FCineCameraFrameSink::FCineCameraFrameSink(const FString& InDirectory, const FString& InBaseName, ECineFrameSinkFormat InFormat, int32 InMaxQueuedFrames, ECineFrameSinkBackpressure InBackpressure)
+	: Directory(InDirectory)
+	, BaseName(InBaseName)
+	, Format(InFormat)
+	, MaxQueuedFrames(FMath::Max(InMaxQueuedFrames, 1))
+	, Backpressure(InBackpressure)
+	, ImageWrapperModule(nullptr)
+	, NextSequenceToWrite(0)
+	, NextSequence(0)
+	, WriterThread(nullptr)
+	, WorkEvent(FPlatformProcess::GetSynchEventFromPool(false))
+	, SpaceAvailableEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+	if (Format != ECineFrameSinkFormat::Raw)
+	{
+		// Modules can only be loaded on the game thread, the wrappers themselves are created on the encoding threads
+		ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	}
+	IFileManager::Get().MakeDirectory(*Directory, true);
+}
+
+FCineCameraFrameSink::~FCineCameraFrameSink()
+{
+	check(WriterThread == nullptr);
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	FPlatformProcess::ReturnSynchEventToPool(SpaceAvailableEvent);
+}
+
+void FCineCameraFrameSink::Start()
+{
+	check(!WriterThread);
+	WriterThread = FRunnableThread::Create(this, TEXT("CineFrameSinkWriter"), 0, TPri_BelowNormal);
+}
+
+void FCineCameraFrameSink::Shutdown()
+{
+	if (bShutdown.AtomicSet(true))
+	{
+		return;
+	}
+
+	// Let every frame that is still encoding reach the writer first
+	while (NumQueued.GetValue() > 0 && WriterThread)
+	{
+		WorkEvent->Trigger();
+		SpaceAvailableEvent->Wait(10);
+	}
+
+	if (WriterThread)
+	{
+		WriterThread->Kill(true);
+		delete WriterThread;
+		WriterThread = nullptr;
+	}
+}
+
+bool FCineCameraFrameSink::IsCompatible(const FString& InDirectory, const FString& InBaseName, ECineFrameSinkFormat InFormat, int32 InMaxQueuedFrames, ECineFrameSinkBackpressure InBackpressure) const
+{
+	return Directory == InDirectory && BaseName == InBaseName && Format == InFormat && MaxQueuedFrames == FMath::Max(InMaxQueuedFrames, 1) && Backpressure == InBackpressure;
+}
+
+bool FCineCameraFrameSink::SubmitFrame(const FCineCaptureFrame& Frame)
+{
+	if (bShutdown || !Frame.Data.IsValid())
+	{
+		return false;
+	}
+
+	while (NumQueued.GetValue() >= MaxQueuedFrames)
+	{
+		if (Backpressure == ECineFrameSinkBackpressure::DropFrame)
+		{
+			NumDropped.Increment();
+			return false;
+		}
+		SpaceAvailableEvent->Wait(1);
+	}
+	NumQueued.Increment();
+
+	const int64 Sequence = NextSequence++;
+	TSharedRef<FCineCameraFrameSink, ESPMode::ThreadSafe> This = AsShared();
+	Async(EAsyncExecution::ThreadPool, [This, Frame, Sequence]()
+	{
+		FEncodedFrame Encoded;
+		Encoded.Sequence = Sequence;
+		This->EncodeFrame(Frame, Encoded);
+		This->EncodedFrames.Enqueue(MoveTemp(Encoded));
+		This->WorkEvent->Trigger();
+	});
+	return true;
+}
+
+void FCineCameraFrameSink::EncodeFrame(const FCineCaptureFrame& Frame, FEncodedFrame& OutEncoded) const
+{
+	const TCHAR* Extension = TEXT("raw");
+	if (Format == ECineFrameSinkFormat::Raw)
+	{
+		FCineRawFrameHeader Header;
+		Header.FrameNumber = Frame.FrameNumber;
+		Header.Width = Frame.Width;
+		Header.Height = Frame.Height;
+		Header.Stride = Frame.Stride;
+		Header.PixelFormat = (int32)Frame.PixelFormat;
+
+		OutEncoded.Bytes.SetNumUninitialized(sizeof(Header));
+		FMemory::Memcpy(OutEncoded.Bytes.GetData(), &Header, sizeof(Header));
+		OutEncoded.RawPixels = Frame.Data;
+	}
+	else
+	{
+		const bool bPNG = Format == ECineFrameSinkFormat::PNG;
+		Extension = bPNG ? TEXT("png") : TEXT("exr");
+
+		const uint8* RawData = Frame.Data->GetData();
+		int32 RawSize = Frame.Data->Num();
+		ERGBFormat RGBFormat = ERGBFormat::Invalid;
+		int32 BitDepth = 8;
+		TArray<uint8> Converted;
+
+		switch (Frame.PixelFormat)
+		{
+		case PF_B8G8R8A8:
+			RGBFormat = ERGBFormat::BGRA;
+			break;
+		case PF_R8G8B8A8:
+			RGBFormat = ERGBFormat::RGBA;
+			break;
+		case PF_FloatRGBA:
+		case PF_A32B32G32R32F:
+			if (bPNG)
+			{
+				if (FCinePixelConversion::ConvertFrame(Frame, ECineReadbackFormat::SRGB8, Converted))
+				{
+					RawData = Converted.GetData();
+					RawSize = Converted.Num();
+					RGBFormat = ERGBFormat::BGRA;
+				}
+			}
+			else
+			{
+				RGBFormat = ERGBFormat::RGBA;
+				BitDepth = Frame.PixelFormat == PF_FloatRGBA ? 16 : 32;
+			}
+			break;
+		default:
+			break;
+		}
+
+		TSharedPtr<IImageWrapper> ImageWrapper = RGBFormat != ERGBFormat::Invalid ? ImageWrapperModule->CreateImageWrapper(bPNG ? EImageFormat::PNG : EImageFormat::EXR) : nullptr;
+		if (ImageWrapper.IsValid() && ImageWrapper->SetRaw(RawData, RawSize, Frame.Width, Frame.Height, RGBFormat, BitDepth))
+		{
+			OutEncoded.Bytes = ImageWrapper->GetCompressed();
+		}
+		else
+		{
+			UE_LOG(LogCineFrameSink, Warning, TEXT("Can't encode frame %llu with pixel format %s as %s, skipped."), Frame.FrameNumber, GPixelFormats[Frame.PixelFormat].Name, Extension);
+		}
+	}
+
+	OutEncoded.Filename = FPaths::Combine(Directory, FString::Printf(TEXT("%s_%06lld.%s"), *BaseName, OutEncoded.Sequence, Extension));
+}
+
+uint32 FCineCameraFrameSink::Run()
+{
+	while (!bStopping)
+	{
+		WorkEvent->Wait();
+		WriteReadyFrames();
+	}
+	WriteReadyFrames();
+	return 0;
+}
+
+void FCineCameraFrameSink::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+void FCineCameraFrameSink::WriteReadyFrames()
+{
+	FEncodedFrame Encoded;
+	while (EncodedFrames.Dequeue(Encoded))
+	{
+		OutOfOrderFrames.Add(Encoded.Sequence, MoveTemp(Encoded));
+	}
+
+	// Encoding finishes in any order, writes happen strictly in sequence
+	while (FEncodedFrame* ReadyFrame = OutOfOrderFrames.Find(NextSequenceToWrite))
+	{
+		WriteFrame(*ReadyFrame);
+		OutOfOrderFrames.Remove(NextSequenceToWrite);
+
+		++NextSequenceToWrite;
+		NumQueued.Decrement();
+		SpaceAvailableEvent->Trigger();
+	}
+}
+
+void FCineCameraFrameSink::WriteFrame(const FEncodedFrame& Frame)
+{
+	if (Frame.Bytes.Num() == 0)
+	{
+		return;
+	}
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Frame.Filename));
+	if (!Writer)
+	{
+		UE_LOG(LogCineFrameSink, Error, TEXT("Failed to open %s for writing."), *Frame.Filename);
+		return;
+	}
+
+	Writer->Serialize(const_cast<uint8*>(Frame.Bytes.GetData()), Frame.Bytes.Num());
+	if (Frame.RawPixels.IsValid())
+	{
+		Writer->Serialize(Frame.RawPixels->GetData(), Frame.RawPixels->Num());
+	}
+	Writer->Close();
+	NumWritten.Increment();
+}
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/Queue.h"
+#include "CineCameraCaptureReadback.h"
+#include "CineCameraFrameSink.generated.h"
+
+class FRunnableThread;
+class FEvent;
+class IImageWrapperModule;
+
+/** File format written by the frame sink. */
+UENUM(BlueprintType)
+enum class ECineFrameSinkFormat : uint8
+{
+	/** The read back pixels behind a small FCineRawFrameHeader, no encoding cost. */
+	Raw,
+	/** 8 bit PNG, HDR captures are converted to sRGB. */
+	PNG,
+	/** Half or full float OpenEXR, keeps HDR captures linear. */
+	EXR,
+};
+
+/** What the frame sink does when its queue is full. */
+UENUM(BlueprintType)
+enum class ECineFrameSinkBackpressure : uint8
+{
+	/** Drop the new frame, the game thread never waits. */
+	DropFrame,
+	/** Block the game thread until the writer caught up, no frame is lost. */
+	Block,
+};
+
+/** Header in front of the pixels of a Raw frame file. */
+struct FCineRawFrameHeader
+{
+	/** 'CCRF' */
+	uint32 Magic = 0x46524343;
+	uint32 Version = 1;
+	uint64 FrameNumber = 0;
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Stride = 0;
+	/** EPixelFormat of the pixels. */
+	int32 PixelFormat = 0;
+};
+
+/**
+ * Streams read back frames to disk without blocking the game thread.
+ * Frames are encoded on the thread pool and written in submission order by a dedicated writer thread.
+ * At most MaxQueuedFrames frames are encoded or waiting to be written at any time, beyond that the backpressure policy applies.
+ */
+class CINEMATICCAMERA_API FCineCameraFrameSink : public FRunnable, public TSharedFromThis<FCineCameraFrameSink, ESPMode::ThreadSafe>
+{
+public:
+	FCineCameraFrameSink(const FString& InDirectory, const FString& InBaseName, ECineFrameSinkFormat InFormat, int32 InMaxQueuedFrames, ECineFrameSinkBackpressure InBackpressure);
+	virtual ~FCineCameraFrameSink();
+
+	/** Starts the writer thread. */
+	void Start();
+
+	/** Writes every queued frame and stops the writer thread. No frames can be submitted afterwards. */
+	void Shutdown();
+
+	/** Game thread. Queues a frame for encoding and writing. Returns false if it was dropped. */
+	bool SubmitFrame(const FCineCaptureFrame& Frame);
+
+	bool IsCompatible(const FString& InDirectory, const FString& InBaseName, ECineFrameSinkFormat InFormat, int32 InMaxQueuedFrames, ECineFrameSinkBackpressure InBackpressure) const;
+
+	/** Frames encoding or waiting to be written. */
+	int32 GetNumQueuedFrames() const { return NumQueued.GetValue(); }
+	int32 GetNumWrittenFrames() const { return NumWritten.GetValue(); }
+	int32 GetNumDroppedFrames() const { return NumDropped.GetValue(); }
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	struct FEncodedFrame
+	{
+		int64 Sequence = 0;
+		FString Filename;
+		/** Encoded file, or just the header of a Raw frame. */
+		TArray<uint8> Bytes;
+		/** Pixels of a Raw frame, written straight from the readback buffer after Bytes. */
+		FCineCaptureBufferPtr RawPixels;
+	};
+
+	/** Thread pool. Encodes a frame in the sink's format, or leaves Bytes empty if the format can't hold the frame's pixels. */
+	void EncodeFrame(const FCineCaptureFrame& Frame, FEncodedFrame& OutEncoded) const;
+
+	/** Writer thread. Writes every encoded frame that is next in sequence. */
+	void WriteReadyFrames();
+
+	const FString Directory;
+	const FString BaseName;
+	const ECineFrameSinkFormat Format;
+	const int32 MaxQueuedFrames;
+	const ECineFrameSinkBackpressure Backpressure;
+
+	IImageWrapperModule* ImageWrapperModule;
+
+	/** Writer thread. Writes one frame to its file. */
+	void WriteFrame(const FEncodedFrame& Frame);
+
+	/** Encoded frames, in completion order. */
+	TQueue<FEncodedFrame, EQueueMode::Mpsc> EncodedFrames;
+	/** Writer thread only, frames that finished encoding before their predecessors. */
+	TMap<int64, FEncodedFrame> OutOfOrderFrames;
+	int64 NextSequenceToWrite;
+	/** Game thread only. */
+	int64 NextSequence;
+
+	FRunnableThread* WriterThread;
+	FEvent* WorkEvent;
+	FEvent* SpaceAvailableEvent;
+	FThreadSafeBool bStopping;
+	FThreadSafeBool bShutdown;
+
+	FThreadSafeCounter NumQueued;
+	FThreadSafeCounter NumWritten;
+	FThreadSafeCounter NumDropped;
+};
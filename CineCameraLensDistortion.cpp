@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraLensDistortion.h"
+#include "Engine/Texture2D.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineLensDistortion, Log, All);
+
+/** Fixed point iterations of the undistortion, as in OpenCV's undistortPoints. Converges well below a texel for realistic lenses. */
+static const int32 UndistortIterations = 8;
+
+const FName FCineLensDistortion::LUTParameterName(TEXT("DistortionLUT"));
+
+TMap<FCineLensDistortion::FLUTKey, TWeakObjectPtr<UTexture2D> > FCineLensDistortion::LUTCache;
+TMap<FCineLensDistortion::FLUTKey, FCineLensDistortion::FPendingLUT> FCineLensDistortion::PendingLUTs;
+
+UTexture2D* FCineLensDistortion::FindOrRequestLUT(const FCineLensDistortionModel& Model, float FocalLength, float SensorWidth, const FIntPoint& Resolution, bool bWait)
+{
+	check(IsInGameThread());
+
+	if (Resolution.X <= 0 || Resolution.Y <= 0 || SensorWidth <= 0.f)
+	{
+		return nullptr;
+	}
+
+	FLUTKey Key;
+	Key.Model = Model;
+	Key.FocalLength = FMath::Max(FMath::GridSnap(FocalLength, FocalLengthStep), FocalLengthStep);
+	Key.SensorWidth = SensorWidth;
+	Key.Resolution = Resolution;
+
+	if (const TWeakObjectPtr<UTexture2D>* Cached = LUTCache.Find(Key))
+	{
+		if (UTexture2D* Texture = Cached->Get())
+		{
+			return Texture;
+		}
+	}
+
+	FPendingLUT* Pending = PendingLUTs.Find(Key);
+	if (!Pending && (bWait || PendingLUTs.Num() < MaxPendingLUTs))
+	{
+		// Same aspect as the output, at most MaxLUTSize on the long side
+		const float LUTScale = FMath::Min(1.0f, (float)MaxLUTSize / FMath::Max(Resolution.X, Resolution.Y));
+		const FIntPoint LUTSize(FMath::Max(FMath::RoundToInt(Resolution.X * LUTScale), 1), FMath::Max(FMath::RoundToInt(Resolution.Y * LUTScale), 1));
+		const float FocalLengthX = Key.FocalLength / SensorWidth * Resolution.X;
+
+		Pending = &PendingLUTs.Add(Key);
+		Pending->Result = Async(EAsyncExecution::ThreadPool, [Model, FocalLengthX, Resolution, LUTSize]()
+		{
+			FComputedLUT LUT;
+			LUT.Size = LUTSize;
+			LUT.Overscan = ComputeLUT(Model, FocalLengthX, Resolution, LUTSize, LUT.Displacement);
+			return LUT;
+		});
+	}
+
+	UTexture2D* Texture = nullptr;
+	if (Pending)
+	{
+		Pending->LastRequestFrame = GFrameCounter;
+		if (bWait || Pending->Result.IsReady())
+		{
+			Texture = CreateLUTTexture(Key, Pending->Result.Get());
+			PendingLUTs.Remove(Key);
+		}
+	}
+
+	// Finished LUTs of focal lengths zoomed past are not worth a texture
+	for (auto It = PendingLUTs.CreateIterator(); It; ++It)
+	{
+		if (It.Value().LastRequestFrame + 1 < GFrameCounter && It.Value().Result.IsReady())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	return Texture;
+}
+
+UTexture2D* FCineLensDistortion::CreateLUTTexture(const FLUTKey& Key, const FComputedLUT& LUT)
+{
+	if (LUT.Overscan > 1.0f)
+	{
+		UE_LOG(LogCineLensDistortion, Log, TEXT("Lens distortion at %.1f mm samples up to %.1f%% outside the %dx%d render, those samples are clamped to its border"),
+			Key.FocalLength, (LUT.Overscan - 1.0f) * 100.0f, Key.Resolution.X, Key.Resolution.Y);
+	}
+
+	UTexture2D* Texture = UTexture2D::CreateTransient(LUT.Size.X, LUT.Size.Y, PF_G16R16F);
+	if (!Texture)
+	{
+		return nullptr;
+	}
+	Texture->SRGB = false;
+	Texture->Filter = TF_Bilinear;
+	Texture->AddressX = TA_Clamp;
+	Texture->AddressY = TA_Clamp;
+
+	FTexture2DMipMap& Mip = Texture->PlatformData->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(MipData, LUT.Displacement.GetData(), LUT.Displacement.Num() * sizeof(FFloat16));
+	Mip.BulkData.Unlock();
+	Texture->UpdateResource();
+
+	// Drop entries whose texture nobody references anymore while we are at it
+	for (auto It = LUTCache.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	LUTCache.Add(Key, Texture);
+	return Texture;
+}
+
+float FCineLensDistortion::ComputeLUT(const FCineLensDistortionModel& Model, float FocalLengthX, const FIntPoint& Resolution, const FIntPoint& LUTSize, TArray<FFloat16>& OutDisplacement)
+{
+	OutDisplacement.SetNumUninitialized(LUTSize.X * LUTSize.Y * 2);
+	TArray<float> RowOverscan;
+	RowOverscan.SetNumZeroed(LUTSize.Y);
+
+	// Square pixels, the render's principal point is the image center
+	const float Fx = FocalLengthX;
+	const float Fy = FocalLengthX;
+	const float Cx = Resolution.X * (0.5f + Model.PrincipalPointOffset.X);
+	const float Cy = Resolution.Y * (0.5f + Model.PrincipalPointOffset.Y);
+	const float RenderCx = Resolution.X * 0.5f;
+	const float RenderCy = Resolution.Y * 0.5f;
+
+	FFloat16* Displacement = OutDisplacement.GetData();
+	ParallelFor(LUTSize.Y, [&](int32 Row)
+	{
+		const float V = (Row + 0.5f) / LUTSize.Y;
+		FFloat16* Dest = Displacement + Row * LUTSize.X * 2;
+
+		for (int32 Column = 0; Column < LUTSize.X; ++Column)
+		{
+			const float U = (Column + 0.5f) / LUTSize.X;
+
+			// Normalized distorted coordinates of this output pixel
+			const float Xd = (U * Resolution.X - Cx) / Fx;
+			const float Yd = (V * Resolution.Y - Cy) / Fy;
+
+			// Invert the distortion to find the ideal ray the pixel sees
+			float X = Xd;
+			float Y = Yd;
+			for (int32 Iteration = 0; Iteration < UndistortIterations; ++Iteration)
+			{
+				const float R2 = X * X + Y * Y;
+				// Strong barrel coefficients fold over far from the center, keep those rays finite
+				const float Radial = FMath::Max(1.0f + R2 * (Model.K1 + R2 * (Model.K2 + R2 * Model.K3)), KINDA_SMALL_NUMBER);
+				const float DeltaX = 2.0f * Model.P1 * X * Y + Model.P2 * (R2 + 2.0f * X * X);
+				const float DeltaY = Model.P1 * (R2 + 2.0f * Y * Y) + 2.0f * Model.P2 * X * Y;
+				X = (Xd - DeltaX) / Radial;
+				Y = (Yd - DeltaY) / Radial;
+			}
+
+			const float SourceU = (X * Fx + RenderCx) / Resolution.X;
+			const float SourceV = (Y * Fy + RenderCy) / Resolution.Y;
+			Dest[Column * 2 + 0] = FFloat16(SourceU - U);
+			Dest[Column * 2 + 1] = FFloat16(SourceV - V);
+			RowOverscan[Row] = FMath::Max3(RowOverscan[Row], FMath::Abs(SourceU - 0.5f) * 2.0f, FMath::Abs(SourceV - 0.5f) * 2.0f);
+		}
+	});
+
+	float Overscan = 0.0f;
+	for (const float Value : RowOverscan)
+	{
+		Overscan = FMath::Max(Overscan, Value);
+	}
+	return Overscan;
+}
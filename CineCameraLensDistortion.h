@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "Async/Future.h"
+#include "CineCameraLensDistortion.generated.h"
+
+class UTexture2D;
+
+/** Brown-Conrady lens distortion, with the radial (k1, k2, k3) and tangential (p1, p2) coefficients of an OpenCV calibration. */
+USTRUCT(BlueprintType)
+struct CINEMATICCAMERA_API FCineLensDistortionModel
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		float K1 = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		float K2 = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		float K3 = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		float P1 = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		float P2 = 0.f;
+
+	/** Offset of the distortion center from the image center, as a fraction of the image size. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LensDistortion)
+		FVector2D PrincipalPointOffset = FVector2D::ZeroVector;
+
+	bool IsIdentity() const
+	{
+		return K1 == 0.f && K2 == 0.f && K3 == 0.f && P1 == 0.f && P2 == 0.f;
+	}
+};
+
+/**
+ * UV displacement lookup tables for FCineLensDistortionModel.
+ * A LUT maps every pixel of the distorted output to the UV to sample in the undistorted (pinhole) render, stored as the UV offset in a G16R16F texture.
+ * LUTs are shared: cameras with the same model, focal length, sensor width and resolution get the same texture, which lives as long as one of them references it.
+ * LUTs are computed on worker threads, so changing the focal length never stalls the game thread, and focal lengths are rounded to FocalLengthStep
+ * so a zoom doesn't compute a LUT per frame.
+ *
+ * The render is not overscanned: barrel distortion samples outside the pinhole render near the corners, and those samples are clamped to its border.
+ * The overscan a LUT would need is logged when it is computed.
+ * Game thread only.
+ */
+class CINEMATICCAMERA_API FCineLensDistortion
+{
+public:
+	/** Texture parameter of the distortion post process material the LUT is bound to. */
+	static const FName LUTParameterName;
+
+	/** Longest side of a LUT. Displacement is smooth, so larger outputs sample it bilinearly. */
+	static const int32 MaxLUTSize = 1024;
+
+	/** Focal lengths are rounded to this many millimeters, well below a pixel of displacement difference for realistic lenses. */
+	static constexpr float FocalLengthStep = 0.1f;
+
+	/** LUTs computed at the same time at most. Requests over it are retried by the next call. */
+	static const int32 MaxPendingLUTs = 2;
+
+	/**
+	* Returns the cached LUT for the inputs. If there is none yet, starts computing it on a worker thread and returns nullptr,
+	* keep using the previous LUT until a later call returns the new one. bWait blocks until the LUT is computed instead.
+	*/
+	static UTexture2D* FindOrRequestLUT(const FCineLensDistortionModel& Model, float FocalLength, float SensorWidth, const FIntPoint& Resolution, bool bWait = false);
+
+	/**
+	* Computes the UV displacement (RG interleaved) of an output of Resolution into LUTSize texels, rows in parallel.
+	* FocalLengthX is the focal length in output pixels.
+	* Returns how far the farthest sample lies from the render center, relative to the render's half size. Over 1 samples outside the render.
+	*/
+	static float ComputeLUT(const FCineLensDistortionModel& Model, float FocalLengthX, const FIntPoint& Resolution, const FIntPoint& LUTSize, TArray<FFloat16>& OutDisplacement);
+
+private:
+	struct FLUTKey
+	{
+		FCineLensDistortionModel Model;
+		float FocalLength;
+		float SensorWidth;
+		FIntPoint Resolution;
+
+		bool operator==(const FLUTKey& Other) const
+		{
+			return Model.K1 == Other.Model.K1 && Model.K2 == Other.Model.K2 && Model.K3 == Other.Model.K3
+				&& Model.P1 == Other.Model.P1 && Model.P2 == Other.Model.P2
+				&& Model.PrincipalPointOffset == Other.Model.PrincipalPointOffset
+				&& FocalLength == Other.FocalLength && SensorWidth == Other.SensorWidth && Resolution == Other.Resolution;
+		}
+
+		friend uint32 GetTypeHash(const FLUTKey& Key)
+		{
+			const float Values[] = { Key.Model.K1, Key.Model.K2, Key.Model.K3, Key.Model.P1, Key.Model.P2, Key.Model.PrincipalPointOffset.X, Key.Model.PrincipalPointOffset.Y, Key.FocalLength, Key.SensorWidth };
+			return HashCombine(FCrc::MemCrc32(Values, sizeof(Values)), GetTypeHash(Key.Resolution));
+		}
+	};
+
+	struct FComputedLUT
+	{
+		FIntPoint Size;
+		TArray<FFloat16> Displacement;
+		float Overscan = 1.f;
+	};
+
+	struct FPendingLUT
+	{
+		TFuture<FComputedLUT> Result;
+		/** GFrameCounter of the last request, results nobody asked for lately are thrown away. */
+		uint64 LastRequestFrame = 0;
+	};
+
+	static UTexture2D* CreateLUTTexture(const FLUTKey& Key, const FComputedLUT& LUT);
+
+	static TMap<FLUTKey, TWeakObjectPtr<UTexture2D> > LUTCache;
+	static TMap<FLUTKey, FPendingLUT> PendingLUTs;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraLensDistortion.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineLensDistortionLUTTest, "CineCamera.LensDistortion.LUT", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * An identity lens must not displace anything. For a Brown-Conrady lens with an offset principal point, the ideal ray the LUT picks for
+ * an output pixel must land back on that pixel when distorted forward the way OpenCV's projectPoints does.
+ */
+bool FCineLensDistortionLUTTest::RunTest(const FString& Parameters)
+{
+	// One LUT texel per pixel, so texel centers are pixel centers
+	const FIntPoint Resolution(256, 144);
+	const float FocalLengthX = 200.f;
+	TArray<FFloat16> Displacement;
+
+	FCineLensDistortionModel Identity;
+	TestTrue(TEXT("A default model is the identity"), Identity.IsIdentity());
+	FCineLensDistortion::ComputeLUT(Identity, FocalLengthX, Resolution, Resolution, Displacement);
+	float MaxDisplacement = 0.f;
+	for (const FFloat16& Value : Displacement)
+	{
+		MaxDisplacement = FMath::Max(MaxDisplacement, FMath::Abs(Value.GetFloat()));
+	}
+	TestEqual(TEXT("An identity lens displaces nothing"), MaxDisplacement, 0.f);
+
+	FCineLensDistortionModel Model;
+	Model.K1 = 0.1f;
+	Model.P1 = 0.01f;
+	Model.PrincipalPointOffset = FVector2D(0.02f, -0.01f);
+	const float Overscan = FCineLensDistortion::ComputeLUT(Model, FocalLengthX, Resolution, Resolution, Displacement);
+
+	// The overscan is how far past the render's edges the LUT reaches
+	float MaxReach = 0.f;
+	for (int32 Row = 0; Row < Resolution.Y; ++Row)
+	{
+		for (int32 Column = 0; Column < Resolution.X; ++Column)
+		{
+			const int32 Texel = (Row * Resolution.X + Column) * 2;
+			const float SourceU = (Column + 0.5f) / Resolution.X + Displacement[Texel + 0].GetFloat();
+			const float SourceV = (Row + 0.5f) / Resolution.Y + Displacement[Texel + 1].GetFloat();
+			MaxReach = FMath::Max3(MaxReach, FMath::Abs(SourceU - 0.5f) * 2.f, FMath::Abs(SourceV - 0.5f) * 2.f);
+		}
+	}
+	TestEqual(TEXT("The overscan covers the farthest source"), Overscan, MaxReach, 1e-3f);
+
+	// The lens' principal point is offset, the render's stays at the image center
+	const float Cx = Resolution.X * (0.5f + Model.PrincipalPointOffset.X);
+	const float Cy = Resolution.Y * (0.5f + Model.PrincipalPointOffset.Y);
+	const FIntPoint Pixels[] = { FIntPoint(128, 72), FIntPoint(5, 5), FIntPoint(250, 10), FIntPoint(40, 130), FIntPoint(200, 100) };
+	for (const FIntPoint& Pixel : Pixels)
+	{
+		const int32 Texel = (Pixel.Y * Resolution.X + Pixel.X) * 2;
+		const float U = (Pixel.X + 0.5f) / Resolution.X;
+		const float V = (Pixel.Y + 0.5f) / Resolution.Y;
+		const float SourceU = U + Displacement[Texel + 0].GetFloat();
+		const float SourceV = V + Displacement[Texel + 1].GetFloat();
+
+		// Ideal normalized coordinates of the source, distorted forward as OpenCV does
+		const float X = (SourceU * Resolution.X - Resolution.X * 0.5f) / FocalLengthX;
+		const float Y = (SourceV * Resolution.Y - Resolution.Y * 0.5f) / FocalLengthX;
+		const float R2 = X * X + Y * Y;
+		const float Radial = 1.f + Model.K1 * R2 + Model.K2 * R2 * R2 + Model.K3 * R2 * R2 * R2;
+		const float Xd = X * Radial + 2.f * Model.P1 * X * Y + Model.P2 * (R2 + 2.f * X * X);
+		const float Yd = Y * Radial + Model.P1 * (R2 + 2.f * Y * Y) + 2.f * Model.P2 * X * Y;
+		const FVector2D Distorted(FocalLengthX * Xd + Cx, FocalLengthX * Yd + Cy);
+
+		// Half float displacements hold about a hundredth of a pixel at this size
+		const FVector2D Expected(Pixel.X + 0.5f, Pixel.Y + 0.5f);
+		TestTrue(FString::Printf(TEXT("Pixel %d, %d distorts back to itself, got %.3f, %.3f"), Pixel.X, Pixel.Y, Distorted.X, Distorted.Y),
+			FVector2D::Distance(Distorted, Expected) < 0.05f);
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
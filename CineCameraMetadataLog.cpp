@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraMetadataLog.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+#define CINE_META_SUPPORTED (PLATFORM_LINUX || PLATFORM_MAC)
+
+#if CINE_META_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineMetadataLog, Log, All);
+
+static TMap<FString, TWeakPtr<FCineMetadataLog, ESPMode::ThreadSafe> > OpenMetadataLogs;
+
+FCineMetadataLog::FCineMetadataLog(const FString& InPath, int64 InCapacity)
+	: Path(InPath)
+	, Capacity(FMath::Max<int64>(InCapacity, 1))
+	, Mapping(nullptr)
+	, MappingSize(sizeof(FCineMetaLogHeader) + sizeof(FCineMetaRecord) * Capacity)
+{
+#if CINE_META_SUPPORTED
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+
+	const auto AnsiPath = StringCast<ANSICHAR>(*Path);
+	const int Descriptor = open(AnsiPath.Get(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+	if (Descriptor < 0)
+	{
+		UE_LOG(LogCineMetadataLog, Warning, TEXT("Failed to create metadata log %s (errno %d)"), *Path, errno);
+		return;
+	}
+
+	// Sparse, only the pages records were written to take disk space
+	void* Mapped = MAP_FAILED;
+	if (ftruncate(Descriptor, (off_t)MappingSize) == 0)
+	{
+		Mapped = mmap(nullptr, (size_t)MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+	}
+	close(Descriptor);
+
+	if (Mapped == MAP_FAILED)
+	{
+		UE_LOG(LogCineMetadataLog, Warning, TEXT("Failed to map %lld bytes of metadata log %s (errno %d)"), MappingSize, *Path, errno);
+		return;
+	}
+
+	// ftruncate zero fills, so no record starts out committed
+	Mapping = (uint8*)Mapped;
+	FCineMetaLogHeader* Header = GetHeader();
+	Header->Magic = CINE_META_MAGIC;
+	Header->Version = CINE_META_VERSION;
+	Header->RecordSize = sizeof(FCineMetaRecord);
+	Header->Closed = 0;
+	Header->Capacity = (uint64_t)Capacity;
+	Header->NumReserved = 0;
+	Header->NumCommitted = 0;
+	Header->NumDropped = 0;
+	FPlatformMisc::MemoryBarrier();
+#else
+	UE_LOG(LogCineMetadataLog, Warning, TEXT("Metadata log %s is only supported on Linux and Mac"), *Path);
+#endif
+}
+
+FCineMetadataLog::~FCineMetadataLog()
+{
+#if CINE_META_SUPPORTED
+	if (Mapping)
+	{
+		FCineMetaLogHeader* Header = GetHeader();
+		const int64 NumCommitted = (int64)Header->NumCommitted;
+		FPlatformMisc::MemoryBarrier();
+		Header->Closed = 1;
+		munmap(Mapping, (size_t)MappingSize);
+
+		// Readers never look past NumCommitted, so they keep working on the shorter file
+		if (truncate(StringCast<ANSICHAR>(*Path).Get(), (off_t)(sizeof(FCineMetaLogHeader) + sizeof(FCineMetaRecord) * NumCommitted)) != 0)
+		{
+			UE_LOG(LogCineMetadataLog, Warning, TEXT("Failed to truncate metadata log %s (errno %d)"), *Path, errno);
+		}
+	}
+#endif
+
+	TWeakPtr<FCineMetadataLog, ESPMode::ThreadSafe>* Registered = OpenMetadataLogs.Find(Path);
+	if (Registered && !Registered->IsValid())
+	{
+		OpenMetadataLogs.Remove(Path);
+	}
+}
+
+TSharedPtr<FCineMetadataLog, ESPMode::ThreadSafe> FCineMetadataLog::FindOrCreate(const FString& Path, int64 Capacity)
+{
+	check(IsInGameThread());
+
+	const FString FullPath = FPaths::ConvertRelativePathToFull(Path);
+	TWeakPtr<FCineMetadataLog, ESPMode::ThreadSafe>& Registered = OpenMetadataLogs.FindOrAdd(FullPath);
+	TSharedPtr<FCineMetadataLog, ESPMode::ThreadSafe> Log = Registered.Pin();
+	if (!Log.IsValid())
+	{
+		Log = MakeShared<FCineMetadataLog, ESPMode::ThreadSafe>(FullPath, Capacity);
+		Registered = Log;
+	}
+	return Log;
+}
+
+FString FCineMetadataLog::MakePath(const FString& BaseName)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CineCapture"), BaseName + TEXT(".cinemeta"));
+}
+
+uint64 FCineMetadataLog::GetTimestampNs()
+{
+#if CINE_META_SUPPORTED
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint64)Now.tv_sec * 1000000000ull + (uint64)Now.tv_nsec;
+#else
+	return 0;
+#endif
+}
+
+bool FCineMetadataLog::Append(const FCineMetaRecord& Record)
+{
+	if (!Mapping)
+	{
+		return false;
+	}
+
+	FCineMetaLogHeader* Header = GetHeader();
+	const int64 Index = FPlatformAtomics::InterlockedIncrement((volatile int64*)&Header->NumReserved) - 1;
+	if (Index >= Capacity)
+	{
+		FPlatformAtomics::InterlockedIncrement((volatile int64*)&Header->NumDropped);
+		return false;
+	}
+
+	FCineMetaRecord* Slot = GetRecord(Index);
+	// Everything but the commit flag, which has to come last
+	const int32 PayloadOffset = STRUCT_OFFSET(FCineMetaRecord, CameraId);
+	FMemory::Memcpy((uint8*)Slot + PayloadOffset, (const uint8*)&Record + PayloadOffset, sizeof(FCineMetaRecord) - PayloadOffset);
+	FPlatformMisc::MemoryBarrier();
+	Slot->Committed = 1;
+	FPlatformMisc::MemoryBarrier();
+
+	// Extend the committed prefix over every record that is done, including ones of writers that finished before us
+	int64 NumCommitted = FPlatformAtomics::AtomicRead((volatile int64*)&Header->NumCommitted);
+	while (NumCommitted < Capacity && GetRecord(NumCommitted)->Committed != 0)
+	{
+		const int64 Previous = FPlatformAtomics::InterlockedCompareExchange((volatile int64*)&Header->NumCommitted, NumCommitted + 1, NumCommitted);
+		NumCommitted = Previous == NumCommitted ? NumCommitted + 1 : Previous;
+	}
+	return true;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CineCameraMetadataLogLayout.h"
+
+/**
+ * Append-only log of per capture camera metadata in a memory mapped file, see CineCameraMetadataLogLayout.h for the format
+ * and CineCameraMetadataLogReader.h for a reader. Only available on Linux and Mac, IsValid() is false elsewhere.
+ * Appending is lock free and may happen on any thread, opening and closing is game thread only.
+ */
+class CINEMATICCAMERA_API FCineMetadataLog
+{
+public:
+	/** Creates the file at Path (replacing an existing one) with room for Capacity records. */
+	FCineMetadataLog(const FString& InPath, int64 InCapacity);
+
+	/** Marks the log closed for readers and truncates the file to the records written. */
+	~FCineMetadataLog();
+
+	/** Returns the open log at Path, creating it if nobody has it open, so cameras can share one log. Game thread only. */
+	static TSharedPtr<FCineMetadataLog, ESPMode::ThreadSafe> FindOrCreate(const FString& Path, int64 Capacity);
+
+	/** Log of a component, "<Saved>/CineCapture/<Owner>_<Component>.cinemeta". */
+	static FString MakePath(const FString& BaseName);
+
+	/** CLOCK_MONOTONIC in nanoseconds, 0 where that is not available. */
+	static uint64 GetTimestampNs();
+
+	bool IsValid() const { return Mapping != nullptr; }
+
+	const FString& GetPath() const { return Path; }
+
+	/** Copies Record into the next free record and commits it. Returns false if the log is full. Thread safe. */
+	bool Append(const FCineMetaRecord& Record);
+
+private:
+	FCineMetaLogHeader* GetHeader() const { return (FCineMetaLogHeader*)Mapping; }
+	FCineMetaRecord* GetRecord(int64 Index) const { return (FCineMetaRecord*)(Mapping + sizeof(FCineMetaLogHeader)) + Index; }
+
+	FString Path;
+	int64 Capacity;
+
+	uint8* Mapping;
+	int64 MappingSize;
+};
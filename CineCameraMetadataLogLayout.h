@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Layout of the per capture metadata log written by FCineMetadataLog.
+ * Plain C++ without engine dependencies, so offline tools can include it (see CineCameraMetadataLogReader.h).
+ *
+ * The file starts with an FCineMetaLogHeader, followed by Capacity records of RecordSize bytes each.
+ * Record N (counting from 0) is the N-th capture appended, captures are appended in dispatch order so FrameNumber never decreases.
+ *
+ * Appending protocol:
+ * - A writer reserves record N by atomically incrementing NumReserved. Reservations past Capacity are dropped and counted in NumDropped.
+ * - It fills the record, then sets its Committed to 1.
+ * - NumCommitted is the length of the fully committed prefix. Any writer that finds the record at NumCommitted committed moves it forward,
+ *   so a slow writer never holds up the others.
+ * - A reader only looks at records below NumCommitted.
+ */
+
+#include <stdint.h>
+
+#define CINE_META_MAGIC 0x474C4D43u
+#define CINE_META_VERSION 1u
+#define CINE_META_ANY_CAMERA 0xFFFFFFFFu
+
+struct alignas(64) FCineMetaLogHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	/** sizeof(FCineMetaRecord) of the writer. */
+	uint32_t RecordSize;
+	/** Set to 1 once the writer is done, the file is then truncated to NumCommitted records. */
+	volatile uint32_t Closed;
+	/** Number of records the file has room for. */
+	uint64_t Capacity;
+	/** Records handed out to writers so far, may exceed Capacity. */
+	volatile uint64_t NumReserved;
+	/** Records 0 to NumCommitted - 1 are complete. */
+	volatile uint64_t NumCommitted;
+	/** Captures that did not fit into the file. */
+	volatile uint64_t NumDropped;
+};
+
+/** Camera state of one capture, as it was rendered. */
+struct alignas(64) FCineMetaRecord
+{
+	/** Set last, 0 while the record is written. */
+	volatile uint32_t Committed;
+	/** Identifies the camera when several share a log. */
+	uint32_t CameraId;
+	/** Engine frame number the capture was rendered on, the same as in read back frames. */
+	uint64_t FrameNumber;
+	/** CLOCK_MONOTONIC time of the capture, in nanoseconds, the clock of the shared memory ring. */
+	uint64_t TimestampNs;
+	/** World time of the capture in seconds, advances by the fixed step in offline capture. */
+	double GameTimeSeconds;
+	uint32_t Width;
+	uint32_t Height;
+	/** Row major pinhole camera matrix in pixels, [fx 0 cx, 0 fy cy, 0 0 1]. */
+	float Intrinsics[9];
+	/** Row major 3x4 world to camera transform in engine units (cm) and axes (X forward, Y right, Z up). */
+	float WorldToCamera[12];
+	/** Millimeters. */
+	float FocalLength;
+	/** F-stop. */
+	float Aperture;
+	/** Centimeters. */
+	float FocusDistance;
+	/** Filmback, in millimeters. */
+	float SensorWidth;
+	float SensorHeight;
+	uint8_t Reserved[48];
+};
+
+static_assert(sizeof(FCineMetaLogHeader) == 64, "FCineMetaLogHeader is part of the metadata log format");
+static_assert(sizeof(FCineMetaRecord) == 192, "FCineMetaRecord is part of the metadata log format");
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Reference reader of the metadata log written by UCineCameraCaptureComponent::bEnableMetadataLog.
+ * Header only, POSIX only, no engine dependencies. Copy it next to CineCameraMetadataLogLayout.h into the consumer.
+ *
+ *	FCineMetaLogReader Reader;
+ *	if (Reader.Open("Saved/CineCapture/MyCamera.cinemeta"))
+ *	{
+ *		if (const FCineMetaRecord* Record = Reader.FindFrame(Frame.FrameNumber))
+ *		{
+ *			Undistort(Frame, Record->Intrinsics);
+ *		}
+ *	}
+ *
+ * The log may still be appended to while it is read, new records show up without reopening.
+ * Lookups are a binary search over the mapped records, there is no copy and no system call.
+ */
+
+#include "CineCameraMetadataLogLayout.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class FCineMetaLogReader
+{
+public:
+	~FCineMetaLogReader()
+	{
+		Close();
+	}
+
+	bool Open(const char* Path)
+	{
+		Close();
+
+		const int Descriptor = open(Path, O_RDONLY);
+		if (Descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat Stat;
+		if (fstat(Descriptor, &Stat) == 0 && Stat.st_size >= (off_t)sizeof(FCineMetaLogHeader))
+		{
+			void* Mapped = mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, Descriptor, 0);
+			if (Mapped != MAP_FAILED)
+			{
+				Mapping = (const uint8_t*)Mapped;
+				MappingSize = (size_t)Stat.st_size;
+			}
+		}
+		close(Descriptor);
+
+		const FCineMetaLogHeader* Header = GetHeader();
+		if (!Header || Header->Magic != CINE_META_MAGIC || Header->Version != CINE_META_VERSION || Header->RecordSize != sizeof(FCineMetaRecord))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		if (Mapping)
+		{
+			munmap((void*)Mapping, MappingSize);
+			Mapping = nullptr;
+			MappingSize = 0;
+		}
+	}
+
+	bool IsOpen() const
+	{
+		return Mapping != nullptr;
+	}
+
+	/** True once the writer is done, no more records will be appended. */
+	bool IsClosedByWriter() const
+	{
+		return Mapping && __atomic_load_n(&GetHeader()->Closed, __ATOMIC_ACQUIRE) != 0;
+	}
+
+	/** Number of complete records. Grows while the writer appends. */
+	uint64_t GetNumRecords() const
+	{
+		if (!Mapping)
+		{
+			return 0;
+		}
+
+		// A closed log may have been truncated below the size that was mapped, and never past it
+		const uint64_t NumCommitted = __atomic_load_n(&GetHeader()->NumCommitted, __ATOMIC_ACQUIRE);
+		const uint64_t NumMapped = (MappingSize - sizeof(FCineMetaLogHeader)) / sizeof(FCineMetaRecord);
+		return NumCommitted < NumMapped ? NumCommitted : NumMapped;
+	}
+
+	/** Captures the writer had to drop because the log was full. */
+	uint64_t GetNumDropped() const
+	{
+		return Mapping ? __atomic_load_n(&GetHeader()->NumDropped, __ATOMIC_RELAXED) : 0;
+	}
+
+	const FCineMetaRecord* GetRecord(uint64_t Index) const
+	{
+		return Index < GetNumRecords() ? GetRecords() + Index : nullptr;
+	}
+
+	/** First record of FrameNumber, of the given camera unless CameraId is CINE_META_ANY_CAMERA. Null if that frame was not captured. */
+	const FCineMetaRecord* FindFrame(uint64_t FrameNumber, uint32_t CameraId = CINE_META_ANY_CAMERA) const
+	{
+		const FCineMetaRecord* Records = GetRecords();
+
+		// Lower bound, FrameNumber never decreases along the log
+		uint64_t First = 0;
+		uint64_t Count = GetNumRecords();
+		while (Count > 0)
+		{
+			const uint64_t Step = Count / 2;
+			if (Records[First + Step].FrameNumber < FrameNumber)
+			{
+				First += Step + 1;
+				Count -= Step + 1;
+			}
+			else
+			{
+				Count = Step;
+			}
+		}
+
+		// Several cameras may share a frame
+		const uint64_t NumRecords = GetNumRecords();
+		for (uint64_t Index = First; Index < NumRecords && Records[Index].FrameNumber == FrameNumber; ++Index)
+		{
+			if (CameraId == CINE_META_ANY_CAMERA || Records[Index].CameraId == CameraId)
+			{
+				return Records + Index;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	const FCineMetaLogHeader* GetHeader() const
+	{
+		return (const FCineMetaLogHeader*)Mapping;
+	}
+
+	const FCineMetaRecord* GetRecords() const
+	{
+		return (const FCineMetaRecord*)(Mapping + sizeof(FCineMetaLogHeader));
+	}
+
+	const uint8_t* Mapping = nullptr;
+	size_t MappingSize = 0;
+};
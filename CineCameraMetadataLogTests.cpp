@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraMetadataLog.h"
+#include "Misc/AutomationTest.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && (PLATFORM_LINUX || PLATFORM_MAC)
+
+#include "CineCameraMetadataLogReader.h"
+
+/** A record whose focal length encodes its frame and camera, so a reader can tell misplaced records. */
+static FCineMetaRecord MakeTestRecord(uint64 FrameNumber, uint32 CameraId)
+{
+	FCineMetaRecord Record;
+	FMemory::Memzero(Record);
+	Record.CameraId = CameraId;
+	Record.FrameNumber = FrameNumber;
+	Record.Width = 1920;
+	Record.Height = 1080;
+	Record.FocalLength = (float)FrameNumber + (float)CameraId / 16.f;
+	return Record;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineMetadataLogRoundTripTest, "CineCamera.MetadataLog.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * Appends the records of several cameras per frame from parallel tasks, as captures prepared on workers would, and reads them back
+ * in place with the reference reader while the log is open, then again after the writer closed and truncated it.
+ */
+bool FCineMetadataLogRoundTripTest::RunTest(const FString& Parameters)
+{
+	const int32 NumCameras = 8;
+	const int32 NumFrames = 200;
+	const int64 NumRecords = (int64)NumCameras * NumFrames;
+	const FString Path = FCineMetadataLog::MakePath(FString::Printf(TEXT("Test_RoundTrip_%u"), FPlatformProcess::GetCurrentProcessId()));
+
+	TSharedPtr<FCineMetadataLog, ESPMode::ThreadSafe> Log = FCineMetadataLog::FindOrCreate(Path, NumRecords);
+	if (!TestTrue(TEXT("The log is created"), Log.IsValid() && Log->IsValid()))
+	{
+		return false;
+	}
+	TestTrue(TEXT("Cameras logging to the same path share the log"), FCineMetadataLog::FindOrCreate(Path, NumRecords) == Log);
+
+	FCineMetaLogReader Reader;
+	if (!TestTrue(TEXT("Reader opens the log"), Reader.Open(TCHAR_TO_ANSI(*Log->GetPath()))))
+	{
+		return false;
+	}
+	TestEqual(TEXT("Nothing to read before the first append"), Reader.GetNumRecords(), (uint64_t)0);
+
+	// Frames one after another, the cameras of a frame all at once, so FrameNumber never decreases along the log
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		ParallelFor(NumCameras, [&Log, Frame](int32 Camera)
+		{
+			Log->Append(MakeTestRecord((uint64)Frame, (uint32)Camera));
+		});
+	}
+
+	TestEqual(TEXT("Every record is read"), Reader.GetNumRecords(), (uint64_t)NumRecords);
+	int32 NumMismatches = 0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (int32 Camera = 0; Camera < NumCameras; ++Camera)
+		{
+			const FCineMetaRecord* Record = Reader.FindFrame((uint64_t)Frame, (uint32_t)Camera);
+			const FCineMetaRecord Expected = MakeTestRecord((uint64)Frame, (uint32)Camera);
+			const bool bMatches = Record && Record->Committed == 1 && Record->FrameNumber == Expected.FrameNumber
+				&& Record->CameraId == Expected.CameraId && Record->FocalLength == Expected.FocalLength && Record->Width == Expected.Width;
+			NumMismatches += bMatches ? 0 : 1;
+		}
+	}
+	TestEqual(TEXT("Every camera's record is found in its frame"), NumMismatches, 0);
+
+	const FCineMetaRecord* AnyCamera = Reader.FindFrame(NumFrames / 2);
+	TestTrue(TEXT("Any camera finds a record of the frame"), AnyCamera && AnyCamera->FrameNumber == (uint64_t)(NumFrames / 2));
+	TestNull(TEXT("A frame that was not captured is not found"), Reader.FindFrame(NumFrames + 1));
+	TestNull(TEXT("A camera that did not log the frame is not found"), Reader.FindFrame(0, NumCameras));
+
+	TestFalse(TEXT("A full log drops the record"), Log->Append(MakeTestRecord(NumFrames, 0)));
+	TestEqual(TEXT("The dropped record is counted"), Reader.GetNumDropped(), (uint64_t)1);
+	TestEqual(TEXT("The dropped record is not read"), Reader.GetNumRecords(), (uint64_t)NumRecords);
+
+	// The last reference closes the log and truncates it to the records written
+	const FString FullPath = Log->GetPath();
+	TestFalse(TEXT("The writer has not closed the log yet"), Reader.IsClosedByWriter());
+	Log.Reset();
+	TestTrue(TEXT("The reader sees the log closed"), Reader.IsClosedByWriter());
+	TestEqual(TEXT("The file is truncated to the records written"), IFileManager::Get().FileSize(*FullPath), (int64)(sizeof(FCineMetaLogHeader) + sizeof(FCineMetaRecord) * NumRecords));
+	TestEqual(TEXT("The open reader still reads every record"), Reader.GetNumRecords(), (uint64_t)NumRecords);
+
+	FCineMetaLogReader ClosedReader;
+	if (TestTrue(TEXT("The closed log opens"), ClosedReader.Open(TCHAR_TO_ANSI(*FullPath))))
+	{
+		TestEqual(TEXT("The closed log has every record"), ClosedReader.GetNumRecords(), (uint64_t)NumRecords);
+		const FCineMetaRecord* Last = ClosedReader.FindFrame(NumFrames - 1, NumCameras - 1);
+		TestTrue(TEXT("The last record is found in the closed log"), Last && Last->FocalLength == MakeTestRecord(NumFrames - 1, NumCameras - 1).FocalLength);
+	}
+
+	Reader.Close();
+	ClosedReader.Close();
+	IFileManager::Get().Delete(*FullPath);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS && (PLATFORM_LINUX || PLATFORM_MAC)
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraOfflineCapture.h"
+#include "Misc/App.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineOfflineCapture, Log, All);
+
+bool FCineCaptureOfflineMode::bActive = false;
+float FCineCaptureOfflineMode::FixedDeltaTime = 1.0f / 30.0f;
+bool FCineCaptureOfflineMode::bSavedUseFixedTimeStep = false;
+double FCineCaptureOfflineMode::SavedFixedDeltaTime = 1.0 / 30.0;
+bool FCineCaptureOfflineMode::bSavedSmoothFrameRate = false;
+bool FCineCaptureOfflineMode::bSavedUseFixedFrameRate = false;
+float FCineCaptureOfflineMode::SavedMaxFPS = 0.0f;
+int32 FCineCaptureOfflineMode::SavedVSync = 0;
+
+/**
+ * Sets a console variable from code at no lower priority than it was last set with, otherwise a value from the console,
+ * the command line or an ini file would win over ours. Warns if the value still didn't take.
+ */
+static void SetConsoleVariableOverriding(const TCHAR* Name, const FString& Value)
+{
+	IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+	if (!Variable)
+	{
+		return;
+	}
+
+	const uint32 SetBy = FMath::Max<uint32>(Variable->GetFlags() & ECVF_SetByMask, ECVF_SetByCode);
+	Variable->Set(*Value, (EConsoleVariableFlags)SetBy);
+	if (Variable->GetFloat() != FCString::Atof(*Value))
+	{
+		UE_LOG(LogCineOfflineCapture, Warning, TEXT("Could not set %s to %s, it stays %s"), Name, *Value, *Variable->GetString());
+	}
+}
+
+void FCineCaptureOfflineMode::Start(float FramesPerSecond)
+{
+	check(IsInGameThread());
+
+	if (!bActive)
+	{
+		bSavedUseFixedTimeStep = FApp::UseFixedTimeStep();
+		SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+		if (GEngine)
+		{
+			bSavedSmoothFrameRate = GEngine->bSmoothFrameRate;
+			bSavedUseFixedFrameRate = GEngine->bUseFixedFrameRate;
+		}
+
+		IConsoleVariable* MaxFPS = IConsoleManager::Get().FindConsoleVariable(TEXT("t.MaxFPS"));
+		IConsoleVariable* VSync = IConsoleManager::Get().FindConsoleVariable(TEXT("r.VSync"));
+		SavedMaxFPS = MaxFPS ? MaxFPS->GetFloat() : 0.0f;
+		SavedVSync = VSync ? VSync->GetInt() : 0;
+	}
+
+	bActive = true;
+	FixedDeltaTime = 1.0f / FMath::Max(FramesPerSecond, 1.0f);
+
+	// With a fixed time step the engine neither measures nor waits for real time
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(FixedDeltaTime);
+	if (GEngine)
+	{
+		GEngine->bSmoothFrameRate = false;
+		GEngine->bUseFixedFrameRate = false;
+	}
+	SetConsoleVariableOverriding(TEXT("t.MaxFPS"), TEXT("0"));
+	SetConsoleVariableOverriding(TEXT("r.VSync"), TEXT("0"));
+
+	UE_LOG(LogCineOfflineCapture, Log, TEXT("Offline capture started at %.3f frames per simulated second"), 1.0f / FixedDeltaTime);
+}
+
+void FCineCaptureOfflineMode::Stop()
+{
+	check(IsInGameThread());
+
+	if (!bActive)
+	{
+		return;
+	}
+	bActive = false;
+
+	FApp::SetUseFixedTimeStep(bSavedUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+	if (GEngine)
+	{
+		GEngine->bSmoothFrameRate = bSavedSmoothFrameRate;
+		GEngine->bUseFixedFrameRate = bSavedUseFixedFrameRate;
+	}
+	SetConsoleVariableOverriding(TEXT("t.MaxFPS"), FString::SanitizeFloat(SavedMaxFPS));
+	SetConsoleVariableOverriding(TEXT("r.VSync"), FString::FromInt(SavedVSync));
+
+	UE_LOG(LogCineOfflineCapture, Log, TEXT("Offline capture stopped"));
+}
+
+static void StartOfflineCapture(const TArray<FString>& Args)
+{
+	FCineCaptureOfflineMode::Start(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 30.0f);
+}
+
+static void StopOfflineCapture(const TArray<FString>& Args)
+{
+	FCineCaptureOfflineMode::Stop();
+}
+
+static FAutoConsoleCommand StartOfflineCaptureCommand(
+	TEXT("r.CineCapture.Offline.Start"),
+	TEXT("Starts deterministic offline capture, stepping the given number of frames (default 30) per simulated second as fast as possible."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StartOfflineCapture));
+
+static FAutoConsoleCommand StopOfflineCaptureCommand(
+	TEXT("r.CineCapture.Offline.Stop"),
+	TEXT("Stops offline capture and restores the previous frame timing settings."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StopOfflineCapture));
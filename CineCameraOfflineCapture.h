@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Deterministic offline capture for dataset generation.
+ * While active the engine advances a fixed step every frame and runs as fast as it can (no frame rate smoothing, max FPS or vsync),
+ * and capture components derive everything time dependent (focus smoothing, CaptureRateHz) from that step instead of measured time.
+ * Readback and the frame sink wait rather than drop frames, batched focus queries resolve immediately and adaptive quality is suspended,
+ * so the same inputs produce the same lens state and the same frames on every run.
+ * Also available as r.CineCapture.Offline.Start [FramesPerSecond] and r.CineCapture.Offline.Stop.
+ */
+class CINEMATICCAMERA_API FCineCaptureOfflineMode
+{
+public:
+	/** Starts stepping FramesPerSecond frames per simulated second. Settings changed here are restored by Stop(). */
+	static void Start(float FramesPerSecond);
+
+	static void Stop();
+
+	static bool IsActive() { return bActive; }
+
+	/** Simulated seconds per frame while active. */
+	static float GetFixedDeltaTime() { return FixedDeltaTime; }
+
+private:
+	static bool bActive;
+	static float FixedDeltaTime;
+
+	/** Engine settings as they were before Start(). */
+	static bool bSavedUseFixedTimeStep;
+	static double SavedFixedDeltaTime;
+	static bool bSavedSmoothFrameRate;
+	static bool bSavedUseFixedFrameRate;
+	static float SavedMaxFPS;
+	static int32 SavedVSync;
+};
@@ -0,0 +1,459 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraPixelConversion.h"
+#include "Async/ParallelFor.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	#define CINE_PIXEL_NEON 1
+	#include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	#define CINE_PIXEL_SSE 1
+	#include <emmintrin.h>
+	#if defined(__F16C__) || defined(__AVX2__)
+		#define CINE_PIXEL_F16C 1
+		#include <immintrin.h>
+	#endif
+#endif
+
+#ifndef CINE_PIXEL_NEON
+	#define CINE_PIXEL_NEON 0
+#endif
+#ifndef CINE_PIXEL_SSE
+	#define CINE_PIXEL_SSE 0
+#endif
+#ifndef CINE_PIXEL_F16C
+	#define CINE_PIXEL_F16C 0
+#endif
+
+/** Rows handed to each ParallelFor task. */
+static const int32 RowsPerTask = 32;
+
+/** Number of entries of the linear to sRGB table, indexed by the linear value quantized to 12 bits. */
+static const int32 SRGBTableSize = 4096;
+
+static const uint8* GetLinearToSRGBTable()
+{
+	struct FLinearToSRGBTable
+	{
+		uint8 Entries[SRGBTableSize];
+
+		FLinearToSRGBTable()
+		{
+			for (int32 Index = 0; Index < SRGBTableSize; ++Index)
+			{
+				const float Linear = (float)Index / (SRGBTableSize - 1);
+				const float SRGB = Linear <= 0.0031308f ? Linear * 12.92f : 1.055f * FMath::Pow(Linear, 1.0f / 2.4f) - 0.055f;
+				Entries[Index] = (uint8)FMath::Clamp(FMath::RoundToInt(SRGB * 255.0f), 0, 255);
+			}
+		}
+	};
+	static const FLinearToSRGBTable Table;
+	return Table.Entries;
+}
+
+static FORCEINLINE float TonemapScalar(float Value, ECineTonemapCurve Tonemap)
+{
+	switch (Tonemap)
+	{
+	case ECineTonemapCurve::Reinhard:
+		return Value / (1.0f + Value);
+	case ECineTonemapCurve::ACES:
+		return (Value * (2.51f * Value + 0.03f)) / (Value * (2.43f * Value + 0.59f) + 0.14f);
+	default:
+		return Value;
+	}
+}
+
+#if CINE_PIXEL_SSE
+/** Converts four halves, zero extended to 32 bits, to floats. Handles denormals, infinities and NaNs. */
+static FORCEINLINE __m128 HalfToFloat4_SSE2(__m128i Halves)
+{
+	const __m128i MaskNoSign = _mm_set1_epi32(0x7fff);
+	const __m128 Magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+	const __m128i WasInfNan = _mm_set1_epi32(0x7bff);
+	const __m128 ExpInfNan = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+	const __m128i ExpMantissa = _mm_and_si128(MaskNoSign, Halves);
+	const __m128i JustSign = _mm_xor_si128(Halves, ExpMantissa);
+	const __m128 Scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(ExpMantissa, 13)), Magic);
+	const __m128 InfNanExp = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(ExpMantissa, WasInfNan)), ExpInfNan);
+	const __m128 SignInf = _mm_or_ps(_mm_castsi128_ps(_mm_slli_epi32(JustSign, 16)), InfNanExp);
+	return _mm_or_ps(Scaled, SignInf);
+}
+
+static FORCEINLINE __m128 Tonemap_SSE(__m128 Value, ECineTonemapCurve Tonemap)
+{
+	const __m128 One = _mm_set1_ps(1.0f);
+	switch (Tonemap)
+	{
+	case ECineTonemapCurve::Reinhard:
+		return _mm_div_ps(Value, _mm_add_ps(One, Value));
+	case ECineTonemapCurve::ACES:
+	{
+		const __m128 Numerator = _mm_mul_ps(Value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), Value), _mm_set1_ps(0.03f)));
+		const __m128 Denominator = _mm_add_ps(_mm_mul_ps(Value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), Value), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+		return _mm_div_ps(Numerator, Denominator);
+	}
+	default:
+		return Value;
+	}
+}
+#endif
+
+#if CINE_PIXEL_NEON
+static FORCEINLINE float32x4_t Divide_NEON(float32x4_t Numerator, float32x4_t Denominator)
+{
+	// Reciprocal estimate refined twice, vdivq_f32 only exists on AArch64
+	float32x4_t Reciprocal = vrecpeq_f32(Denominator);
+	Reciprocal = vmulq_f32(vrecpsq_f32(Denominator, Reciprocal), Reciprocal);
+	Reciprocal = vmulq_f32(vrecpsq_f32(Denominator, Reciprocal), Reciprocal);
+	return vmulq_f32(Numerator, Reciprocal);
+}
+
+static FORCEINLINE float32x4_t Tonemap_NEON(float32x4_t Value, ECineTonemapCurve Tonemap)
+{
+	switch (Tonemap)
+	{
+	case ECineTonemapCurve::Reinhard:
+		return Divide_NEON(Value, vaddq_f32(vdupq_n_f32(1.0f), Value));
+	case ECineTonemapCurve::ACES:
+	{
+		const float32x4_t Numerator = vmulq_f32(Value, vmlaq_f32(vdupq_n_f32(0.03f), vdupq_n_f32(2.51f), Value));
+		const float32x4_t Denominator = vmlaq_f32(vdupq_n_f32(0.14f), Value, vmlaq_f32(vdupq_n_f32(0.59f), vdupq_n_f32(2.43f), Value));
+		return Divide_NEON(Numerator, Denominator);
+	}
+	default:
+		return Value;
+	}
+}
+#endif
+
+void FCinePixelConversion::HalfToFloat(const FFloat16* Src, float* Dest, int32 Count)
+{
+	int32 Index = 0;
+#if CINE_PIXEL_F16C
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		_mm256_storeu_ps(Dest + Index, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + Index))));
+	}
+#elif CINE_PIXEL_SSE
+	const __m128i Zero = _mm_setzero_si128();
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		const __m128i Halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + Index));
+		_mm_storeu_ps(Dest + Index, HalfToFloat4_SSE2(_mm_unpacklo_epi16(Halves, Zero)));
+		_mm_storeu_ps(Dest + Index + 4, HalfToFloat4_SSE2(_mm_unpackhi_epi16(Halves, Zero)));
+	}
+#elif CINE_PIXEL_NEON
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const float16x4_t Halves = vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const uint16*>(Src + Index)));
+		vst1q_f32(Dest + Index, vcvt_f32_f16(Halves));
+	}
+#endif
+	for (; Index < Count; ++Index)
+	{
+		Dest[Index] = Src[Index].GetFloat();
+	}
+}
+
+void FCinePixelConversion::LinearToSRGB8(const FLinearColor* Src, FColor* Dest, int32 NumPixels, const FCinePixelConversionOptions& Options)
+{
+	const uint8* SRGBTable = GetLinearToSRGBTable();
+
+#if CINE_PIXEL_SSE
+	// Exposure and the tone curve only apply to color, alpha stays linear and is quantized to 8 bits directly
+	const __m128 Exposure = _mm_setr_ps(Options.Exposure, Options.Exposure, Options.Exposure, 1.0f);
+	const __m128 ColorMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 Scale = _mm_setr_ps(SRGBTableSize - 1, SRGBTableSize - 1, SRGBTableSize - 1, 255.0f);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps(1.0f);
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		__m128 Color = _mm_mul_ps(_mm_loadu_ps(&Src[Index].R), Exposure);
+		if (Options.Tonemap != ECineTonemapCurve::None)
+		{
+			const __m128 Mapped = Tonemap_SSE(Color, Options.Tonemap);
+			Color = _mm_or_ps(_mm_and_ps(ColorMask, Mapped), _mm_andnot_ps(ColorMask, Color));
+		}
+		// max() first so NaNs end up as 0
+		Color = _mm_min_ps(_mm_max_ps(Color, Zero), One);
+
+		MS_ALIGN(16) int32 Quantized[4] GCC_ALIGN(16);
+		_mm_store_si128(reinterpret_cast<__m128i*>(Quantized), _mm_cvtps_epi32(_mm_mul_ps(Color, Scale)));
+		Dest[Index] = FColor(SRGBTable[Quantized[0]], SRGBTable[Quantized[1]], SRGBTable[Quantized[2]], (uint8)Quantized[3]);
+	}
+#elif CINE_PIXEL_NEON
+	const float ExposureValues[4] = { Options.Exposure, Options.Exposure, Options.Exposure, 1.0f };
+	const uint32 ColorMaskValues[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0 };
+	const float ScaleValues[4] = { SRGBTableSize - 1, SRGBTableSize - 1, SRGBTableSize - 1, 255.0f };
+	const float32x4_t Exposure = vld1q_f32(ExposureValues);
+	const uint32x4_t ColorMask = vld1q_u32(ColorMaskValues);
+	const float32x4_t Scale = vld1q_f32(ScaleValues);
+	const float32x4_t Zero = vdupq_n_f32(0.0f);
+	const float32x4_t One = vdupq_n_f32(1.0f);
+	const float32x4_t Half = vdupq_n_f32(0.5f);
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		float32x4_t Color = vmulq_f32(vld1q_f32(&Src[Index].R), Exposure);
+		if (Options.Tonemap != ECineTonemapCurve::None)
+		{
+			Color = vbslq_f32(ColorMask, Tonemap_NEON(Color, Options.Tonemap), Color);
+		}
+		Color = vminq_f32(vmaxq_f32(Color, Zero), One);
+
+		int32 Quantized[4];
+		vst1q_s32(Quantized, vcvtq_s32_f32(vmlaq_f32(Half, Color, Scale)));
+		Dest[Index] = FColor(SRGBTable[Quantized[0]], SRGBTable[Quantized[1]], SRGBTable[Quantized[2]], (uint8)Quantized[3]);
+	}
+#else
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		const FLinearColor& Color = Src[Index];
+		uint8 Channels[3];
+		const float Linear[3] = { Color.R, Color.G, Color.B };
+		for (int32 Channel = 0; Channel < 3; ++Channel)
+		{
+			const float Mapped = FMath::Clamp(TonemapScalar(Linear[Channel] * Options.Exposure, Options.Tonemap), 0.0f, 1.0f);
+			Channels[Channel] = SRGBTable[FMath::RoundToInt(Mapped * (SRGBTableSize - 1))];
+		}
+		Dest[Index] = FColor(Channels[0], Channels[1], Channels[2], (uint8)FMath::RoundToInt(FMath::Clamp(Color.A, 0.0f, 1.0f) * 255.0f));
+	}
+#endif
+}
+
+void FCinePixelConversion::HalfToSRGB8(const FFloat16Color* Src, FColor* Dest, int32 NumPixels, const FCinePixelConversionOptions& Options)
+{
+	// Widen in small batches that stay in L1
+	const int32 BatchSize = 64;
+	FLinearColor Batch[BatchSize];
+	for (int32 Start = 0; Start < NumPixels; Start += BatchSize)
+	{
+		const int32 Count = FMath::Min(BatchSize, NumPixels - Start);
+		HalfToFloat(&Src[Start].R, &Batch[0].R, Count * 4);
+		LinearToSRGB8(Batch, Dest + Start, Count, Options);
+	}
+}
+
+void FCinePixelConversion::DepthToUInt16(const float* Src, uint16* Dest, int32 Count, float Scale)
+{
+	int32 Index = 0;
+#if CINE_PIXEL_SSE
+	const __m128 ScaleV = _mm_set1_ps(Scale);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 Max = _mm_set1_ps(65535.0f);
+	const __m128i Bias = _mm_set1_epi32(32768);
+	const __m128i SignFlip = _mm_set1_epi16((int16)0x8000);
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const __m128 Scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(Src + Index), ScaleV), Zero), Max);
+		// SSE2 only packs with signed saturation, so pack around 0 and flip the sign bit back
+		const __m128i Biased = _mm_sub_epi32(_mm_cvtps_epi32(Scaled), Bias);
+		const __m128i Packed = _mm_xor_si128(_mm_packs_epi32(Biased, Biased), SignFlip);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(Dest + Index), Packed);
+	}
+#elif CINE_PIXEL_NEON
+	const float32x4_t ScaleV = vdupq_n_f32(Scale);
+	const float32x4_t Zero = vdupq_n_f32(0.0f);
+	const float32x4_t Max = vdupq_n_f32(65535.0f);
+	const float32x4_t Half = vdupq_n_f32(0.5f);
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const float32x4_t Scaled = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(Src + Index), ScaleV), Zero), Max);
+		vst1_u16(Dest + Index, vmovn_u32(vcvtq_u32_f32(vaddq_f32(Scaled, Half))));
+	}
+#endif
+	for (; Index < Count; ++Index)
+	{
+		const float Scaled = Src[Index] * Scale;
+		// Written so NaN ends up as 0
+		Dest[Index] = Scaled > 0.0f ? (uint16)FMath::Min(FMath::RoundToInt(Scaled), 65535) : 0;
+	}
+}
+
+void FCinePixelConversion::SwizzleRB8(const uint32* Src, uint32* Dest, int32 Count)
+{
+	int32 Index = 0;
+#if CINE_PIXEL_SSE
+	const __m128i MaskAG = _mm_set1_epi32(0xff00ff00);
+	const __m128i MaskLow = _mm_set1_epi32(0x000000ff);
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const __m128i Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + Index));
+		const __m128i AG = _mm_and_si128(Pixels, MaskAG);
+		const __m128i Low = _mm_slli_epi32(_mm_and_si128(Pixels, MaskLow), 16);
+		const __m128i High = _mm_and_si128(_mm_srli_epi32(Pixels, 16), MaskLow);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + Index), _mm_or_si128(AG, _mm_or_si128(Low, High)));
+	}
+#elif CINE_PIXEL_NEON
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		uint8x8x4_t Pixels = vld4_u8(reinterpret_cast<const uint8*>(Src + Index));
+		const uint8x8_t First = Pixels.val[0];
+		Pixels.val[0] = Pixels.val[2];
+		Pixels.val[2] = First;
+		vst4_u8(reinterpret_cast<uint8*>(Dest + Index), Pixels);
+	}
+#endif
+	for (; Index < Count; ++Index)
+	{
+		const uint32 Pixel = Src[Index];
+		Dest[Index] = (Pixel & 0xff00ff00) | ((Pixel & 0xff) << 16) | ((Pixel >> 16) & 0xff);
+	}
+}
+
+FCinePixelConversionOptions FCinePixelConversion::GetOptionsForSource(ESceneCaptureSource Source)
+{
+	FCinePixelConversionOptions Options;
+	// SceneColorSceneDepth stores depth in alpha, the depth sources in red
+	Options.DepthChannel = Source == SCS_SceneColorSceneDepth ? 3 : 0;
+	return Options;
+}
+
+bool FCinePixelConversion::IsSupported(ESceneCaptureSource Source, ECineReadbackFormat OutputFormat)
+{
+	switch (OutputFormat)
+	{
+	case ECineReadbackFormat::DepthFloat:
+		return Source == SCS_SceneDepth || Source == SCS_DeviceDepth || Source == SCS_SceneColorSceneDepth;
+	case ECineReadbackFormat::DepthUInt16:
+		// Device depth is non linear, it has no metric meaning
+		return Source == SCS_SceneDepth || Source == SCS_SceneColorSceneDepth;
+	default:
+		return Source != SCS_SceneDepth && Source != SCS_DeviceDepth;
+	}
+}
+
+int32 FCinePixelConversion::GetBytesPerPixel(ECineReadbackFormat OutputFormat)
+{
+	switch (OutputFormat)
+	{
+	case ECineReadbackFormat::SRGB8:
+		return sizeof(FColor);
+	case ECineReadbackFormat::LinearFloat:
+		return sizeof(FLinearColor);
+	case ECineReadbackFormat::DepthFloat:
+		return sizeof(float);
+	case ECineReadbackFormat::DepthUInt16:
+		return sizeof(uint16);
+	default:
+		return 0;
+	}
+}
+
+bool FCinePixelConversion::ConvertFrame(const FCineCaptureFrame& Frame, ECineReadbackFormat OutputFormat, TArray<uint8>& OutPixels, const FCinePixelConversionOptions& Options)
+{
+	if (!Frame.Data.IsValid() || Frame.Width <= 0 || Frame.Height <= 0)
+	{
+		return false;
+	}
+
+	const EPixelFormat Format = Frame.PixelFormat;
+	const bool bHalf = Format == PF_FloatRGBA || Format == PF_R16F;
+	const bool bFloat = Format == PF_A32B32G32R32F || Format == PF_R32_FLOAT;
+	const bool bRGBA8 = Format == PF_R8G8B8A8;
+	const bool bBGRA8 = Format == PF_B8G8R8A8;
+	const bool bDepthOutput = OutputFormat == ECineReadbackFormat::DepthFloat || OutputFormat == ECineReadbackFormat::DepthUInt16;
+
+	const int32 NumChannels = (Format == PF_R16F || Format == PF_R32_FLOAT) ? 1 : 4;
+	if (bDepthOutput ? (!(bHalf || bFloat) || Options.DepthChannel >= NumChannels)
+		: (NumChannels != 4 || (OutputFormat == ECineReadbackFormat::LinearFloat && !(bHalf || bFloat)) || !(bHalf || bFloat || bRGBA8 || bBGRA8)))
+	{
+		return false;
+	}
+
+	const int32 Width = Frame.Width;
+	const int32 OutStride = Width * GetBytesPerPixel(OutputFormat);
+	OutPixels.SetNumUninitialized(OutStride * Frame.Height);
+
+	const uint8* SrcData = Frame.Data->GetData();
+	uint8* DestData = OutPixels.GetData();
+	const int32 SrcStride = Frame.Stride;
+	const int32 NumTasks = FMath::DivideAndRoundUp(Frame.Height, RowsPerTask);
+
+	ParallelFor(NumTasks, [&](int32 TaskIndex)
+	{
+		const int32 FirstRow = TaskIndex * RowsPerTask;
+		const int32 LastRow = FMath::Min(FirstRow + RowsPerTask, Frame.Height);
+
+		// Widened source row, only needed for depth and half to float
+		TArray<float> FloatRow;
+
+		for (int32 Row = FirstRow; Row < LastRow; ++Row)
+		{
+			const uint8* Src = SrcData + Row * SrcStride;
+			uint8* Dest = DestData + Row * OutStride;
+
+			switch (OutputFormat)
+			{
+			case ECineReadbackFormat::SRGB8:
+				if (bHalf)
+				{
+					HalfToSRGB8(reinterpret_cast<const FFloat16Color*>(Src), reinterpret_cast<FColor*>(Dest), Width, Options);
+				}
+				else if (bFloat)
+				{
+					LinearToSRGB8(reinterpret_cast<const FLinearColor*>(Src), reinterpret_cast<FColor*>(Dest), Width, Options);
+				}
+				else if (bRGBA8)
+				{
+					SwizzleRB8(reinterpret_cast<const uint32*>(Src), reinterpret_cast<uint32*>(Dest), Width);
+				}
+				else
+				{
+					FMemory::Memcpy(Dest, Src, OutStride);
+				}
+				break;
+
+			case ECineReadbackFormat::LinearFloat:
+				if (bHalf)
+				{
+					HalfToFloat(reinterpret_cast<const FFloat16*>(Src), reinterpret_cast<float*>(Dest), Width * 4);
+				}
+				else
+				{
+					FMemory::Memcpy(Dest, Src, OutStride);
+				}
+				break;
+
+			default:
+			{
+				// Widen the row if needed, then pick the depth channel
+				const float* Floats = reinterpret_cast<const float*>(Src);
+				if (bHalf)
+				{
+					FloatRow.SetNumUninitialized(Width * NumChannels, false);
+					HalfToFloat(reinterpret_cast<const FFloat16*>(Src), FloatRow.GetData(), Width * NumChannels);
+					Floats = FloatRow.GetData();
+				}
+
+				if (OutputFormat == ECineReadbackFormat::DepthFloat)
+				{
+					float* Depth = reinterpret_cast<float*>(Dest);
+					for (int32 Pixel = 0; Pixel < Width; ++Pixel)
+					{
+						Depth[Pixel] = Floats[Pixel * NumChannels + Options.DepthChannel];
+					}
+				}
+				else
+				{
+					if (NumChannels > 1)
+					{
+						// Compact into the scratch row, reading ahead of the write index so it also works in place
+						FloatRow.SetNumUninitialized(FMath::Max(FloatRow.Num(), Width), false);
+						for (int32 Pixel = 0; Pixel < Width; ++Pixel)
+						{
+							FloatRow[Pixel] = Floats[Pixel * NumChannels + Options.DepthChannel];
+						}
+						Floats = FloatRow.GetData();
+					}
+					DepthToUInt16(Floats, reinterpret_cast<uint16*>(Dest), Width, Options.DepthScale);
+				}
+				break;
+			}
+			}
+		}
+	}, NumTasks == 1);
+
+	return true;
+}
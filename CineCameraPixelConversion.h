@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "CineCameraCaptureReadback.h"
+
+/** CPU side formats a read back frame can be converted to. */
+enum class ECineReadbackFormat : uint8
+{
+	/** FColor (BGRA8), sRGB encoded color with linear alpha. */
+	SRGB8,
+	/** Linear float RGBA. */
+	LinearFloat,
+	/** One float per pixel, scene depth in world units. */
+	DepthFloat,
+	/** One uint16 per pixel, scene depth multiplied by DepthScale (millimeters by default). */
+	DepthUInt16,
+};
+
+/** Tone curve applied to HDR color before sRGB encoding. */
+enum class ECineTonemapCurve : uint8
+{
+	/** Clamp to [0, 1]. */
+	None,
+	/** x / (1 + x) */
+	Reinhard,
+	/** Narkowicz' fit of the ACES filmic curve. */
+	ACES,
+};
+
+struct FCinePixelConversionOptions
+{
+	/** Linear color multiplier applied before the tone curve. */
+	float Exposure = 1.0f;
+	ECineTonemapCurve Tonemap = ECineTonemapCurve::None;
+	/** Channel of the source that holds depth: 0 for depth captures, 3 for SCS_SceneColorSceneDepth. */
+	int32 DepthChannel = 0;
+	/** Multiplier from world units to the uint16 depth unit, the default converts centimeters to millimeters. */
+	float DepthScale = 10.0f;
+};
+
+/**
+ * Converts read back capture frames to the formats consumers want.
+ * Row kernels are vectorized (F16C/AVX, SSE2 or NEON, depending on the target, with a scalar fallback) and frames are split across rows with ParallelFor.
+ */
+struct CINEMATICCAMERA_API FCinePixelConversion
+{
+	/** Options matching what the capture source writes, e.g. which channel holds depth. */
+	static FCinePixelConversionOptions GetOptionsForSource(ESceneCaptureSource Source);
+
+	/** Whether frames of the given capture source can be converted to OutputFormat. */
+	static bool IsSupported(ESceneCaptureSource Source, ECineReadbackFormat OutputFormat);
+
+	/**
+	 * Converts a whole frame, rows are processed in parallel. OutPixels is tightly packed.
+	 * Returns false if the frame's pixel format can't be converted to OutputFormat.
+	 */
+	static bool ConvertFrame(const FCineCaptureFrame& Frame, ECineReadbackFormat OutputFormat, TArray<uint8>& OutPixels, const FCinePixelConversionOptions& Options = FCinePixelConversionOptions());
+
+	/** Bytes per pixel of OutputFormat. */
+	static int32 GetBytesPerPixel(ECineReadbackFormat OutputFormat);
+
+	// Row kernels, usable on their own. Source and destination must not overlap.
+
+	static void HalfToFloat(const FFloat16* Src, float* Dest, int32 Count);
+	static void LinearToSRGB8(const FLinearColor* Src, FColor* Dest, int32 NumPixels, const FCinePixelConversionOptions& Options);
+	static void HalfToSRGB8(const FFloat16Color* Src, FColor* Dest, int32 NumPixels, const FCinePixelConversionOptions& Options);
+	static void DepthToUInt16(const float* Src, uint16* Dest, int32 Count, float Scale);
+	/** Swaps the R and B channels of 8 bit RGBA pixels, RGBA <-> BGRA. */
+	static void SwizzleRB8(const uint32* Src, uint32* Dest, int32 Count);
+};
@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraPixelConversion.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Plain per pixel conversions, the way they'd be written without the kernels
+
+static void HalfToFloatScalar(const FFloat16* Src, float* Dest, int32 Count)
+{
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		Dest[Index] = Src[Index].GetFloat();
+	}
+}
+
+static float TonemapReference(float Value, ECineTonemapCurve Tonemap)
+{
+	switch (Tonemap)
+	{
+	case ECineTonemapCurve::Reinhard:
+		return Value / (1.0f + Value);
+	case ECineTonemapCurve::ACES:
+		return (Value * (2.51f * Value + 0.03f)) / (Value * (2.43f * Value + 0.59f) + 0.14f);
+	default:
+		return Value;
+	}
+}
+
+/** Exact sRGB curve, rounded to nearest. */
+static uint8 EncodeSRGBReference(float Linear, const FCinePixelConversionOptions& Options)
+{
+	const float Mapped = FMath::Clamp(TonemapReference(Linear * Options.Exposure, Options.Tonemap), 0.0f, 1.0f);
+	const float SRGB = Mapped <= 0.0031308f ? Mapped * 12.92f : 1.055f * FMath::Pow(Mapped, 1.0f / 2.4f) - 0.055f;
+	return (uint8)FMath::Clamp(FMath::RoundToInt(SRGB * 255.0f), 0, 255);
+}
+
+static void HalfToSRGB8Scalar(const FFloat16Color* Src, FColor* Dest, int32 NumPixels, const FCinePixelConversionOptions& Options)
+{
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		const FLinearColor Color(Src[Index]);
+		Dest[Index] = FColor(
+			EncodeSRGBReference(Color.R, Options),
+			EncodeSRGBReference(Color.G, Options),
+			EncodeSRGBReference(Color.B, Options),
+			(uint8)FMath::RoundToInt(FMath::Clamp(Color.A, 0.0f, 1.0f) * 255.0f));
+	}
+}
+
+static void DepthToUInt16Scalar(const float* Src, uint16* Dest, int32 Count, float Scale)
+{
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		Dest[Index] = (uint16)FMath::Clamp(FMath::RoundToInt(Src[Index] * Scale), 0, 65535);
+	}
+}
+
+static void SwizzleRB8Scalar(const uint32* Src, uint32* Dest, int32 Count)
+{
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FColor Pixel = reinterpret_cast<const FColor*>(Src)[Index];
+		reinterpret_cast<FColor*>(Dest)[Index] = FColor(Pixel.B, Pixel.G, Pixel.R, Pixel.A);
+	}
+}
+
+/** Milliseconds for running Kernel over every row of a frame on the calling thread. */
+template<typename KernelType>
+static double TimeRows(int32 Height, int32 NumRepeats, KernelType Kernel)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		for (int32 Row = 0; Row < Height; ++Row)
+		{
+			Kernel(Row);
+		}
+	}
+	return (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumRepeats;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCinePixelConversionBenchmarkTest, "CineCamera.PixelConversion.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Runs every row kernel over a 1920x1080 frame on one thread against its scalar equivalent, checks they agree,
+ * and times ConvertFrame() which also spreads the rows over worker threads.
+ */
+bool FCinePixelConversionBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 Width = 1920;
+	const int32 Height = 1080;
+	const int32 NumPixels = Width * Height;
+	const int32 NumRepeats = 10;
+
+	// HDR color with some values over 1, so the tone curves have something to do
+	FRandomStream Random(Width);
+	TArray<FFloat16Color> HalfColors;
+	TArray<float> Depths;
+	TArray<uint32> Colors8;
+	HalfColors.SetNumUninitialized(NumPixels);
+	Depths.SetNumUninitialized(NumPixels);
+	Colors8.SetNumUninitialized(NumPixels);
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		HalfColors[Index] = FFloat16Color(FLinearColor(Random.FRand() * 4.0f, Random.FRand() * 2.0f, Random.FRand(), Random.FRand()));
+		Depths[Index] = Random.FRandRange(0.0f, 10000.0f);
+		Colors8[Index] = Random.GetUnsignedInt();
+	}
+
+	TArray<float> Floats[2];
+	TArray<FColor> SRGB[2];
+	TArray<uint16> DepthsUInt16[2];
+	TArray<uint32> Swizzled[2];
+	for (int32 Variant = 0; Variant < 2; ++Variant)
+	{
+		Floats[Variant].SetNumUninitialized(NumPixels * 4);
+		SRGB[Variant].SetNumUninitialized(NumPixels);
+		DepthsUInt16[Variant].SetNumUninitialized(NumPixels);
+		Swizzled[Variant].SetNumUninitialized(NumPixels);
+	}
+
+	FCinePixelConversionOptions Options;
+	Options.Tonemap = ECineTonemapCurve::ACES;
+
+	struct FKernelTiming
+	{
+		const TCHAR* Name;
+		double ScalarMs;
+		double KernelMs;
+	};
+	TArray<FKernelTiming> Timings;
+
+	Timings.Add({ TEXT("half -> float"),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { HalfToFloatScalar(&HalfColors[Row * Width].R, &Floats[0][Row * Width * 4], Width * 4); }),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { FCinePixelConversion::HalfToFloat(&HalfColors[Row * Width].R, &Floats[1][Row * Width * 4], Width * 4); }) });
+	Timings.Add({ TEXT("half -> sRGB8 (ACES)"),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { HalfToSRGB8Scalar(&HalfColors[Row * Width], &SRGB[0][Row * Width], Width, Options); }),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { FCinePixelConversion::HalfToSRGB8(&HalfColors[Row * Width], &SRGB[1][Row * Width], Width, Options); }) });
+	Timings.Add({ TEXT("depth -> uint16"),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { DepthToUInt16Scalar(&Depths[Row * Width], &DepthsUInt16[0][Row * Width], Width, Options.DepthScale); }),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { FCinePixelConversion::DepthToUInt16(&Depths[Row * Width], &DepthsUInt16[1][Row * Width], Width, Options.DepthScale); }) });
+	Timings.Add({ TEXT("RGBA8 <-> BGRA8"),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { SwizzleRB8Scalar(&Colors8[Row * Width], &Swizzled[0][Row * Width], Width); }),
+		TimeRows(Height, NumRepeats, [&](int32 Row) { FCinePixelConversion::SwizzleRB8(&Colors8[Row * Width], &Swizzled[1][Row * Width], Width); }) });
+
+	// Half denormals are the only values the engine's scalar conversion may treat differently
+	float MaxFloatError = 0.0f;
+	for (int32 Index = 0; Index < Floats[0].Num(); ++Index)
+	{
+		MaxFloatError = FMath::Max(MaxFloatError, FMath::Abs(Floats[0][Index] - Floats[1][Index]));
+	}
+	TestTrue(FString::Printf(TEXT("half -> float matches (max error %g)"), MaxFloatError), MaxFloatError <= 6.2e-5f);
+	TestTrue(TEXT("RGBA8 <-> BGRA8 matches"), FMemory::Memcmp(Swizzled[0].GetData(), Swizzled[1].GetData(), Swizzled[0].Num() * sizeof(uint32)) == 0);
+
+	// The kernels round through a 12 bit sRGB table and may differ from the exact curve by one step
+	int32 MaxColorError = 0;
+	int32 MaxDepthError = 0;
+	for (int32 Index = 0; Index < NumPixels; ++Index)
+	{
+		const FColor& Expected = SRGB[0][Index];
+		const FColor& Actual = SRGB[1][Index];
+		MaxColorError = FMath::Max(MaxColorError, FMath::Abs(Expected.R - Actual.R));
+		MaxColorError = FMath::Max(MaxColorError, FMath::Abs(Expected.G - Actual.G));
+		MaxColorError = FMath::Max(MaxColorError, FMath::Abs(Expected.B - Actual.B));
+		MaxColorError = FMath::Max(MaxColorError, FMath::Abs(Expected.A - Actual.A));
+		MaxDepthError = FMath::Max(MaxDepthError, FMath::Abs((int32)DepthsUInt16[0][Index] - (int32)DepthsUInt16[1][Index]));
+	}
+	TestTrue(FString::Printf(TEXT("half -> sRGB8 is within one step of the exact curve (max error %d)"), MaxColorError), MaxColorError <= 1);
+	TestTrue(FString::Printf(TEXT("depth -> uint16 is within rounding (max error %d)"), MaxDepthError), MaxDepthError <= 1);
+
+	for (const FKernelTiming& Timing : Timings)
+	{
+		AddInfo(FString::Printf(TEXT("%-22s scalar %7.2f ms, kernel %7.2f ms, %.1fx"), Timing.Name, Timing.ScalarMs, Timing.KernelMs, Timing.KernelMs > 0.0 ? Timing.ScalarMs / Timing.KernelMs : 0.0));
+	}
+
+	FCineCaptureFrame Frame;
+	Frame.Width = Width;
+	Frame.Height = Height;
+	Frame.Stride = Width * sizeof(FFloat16Color);
+	Frame.PixelFormat = PF_FloatRGBA;
+	Frame.Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	Frame.Data->Append(reinterpret_cast<const uint8*>(HalfColors.GetData()), HalfColors.Num() * sizeof(FFloat16Color));
+
+	TArray<uint8> Converted;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		TestTrue(TEXT("ConvertFrame succeeds"), FCinePixelConversion::ConvertFrame(Frame, ECineReadbackFormat::SRGB8, Converted, Options));
+	}
+	const double ConvertMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumRepeats;
+	TestTrue(TEXT("ConvertFrame matches the row kernel"), Converted.Num() == SRGB[1].Num() * (int32)sizeof(FColor) && FMemory::Memcmp(Converted.GetData(), SRGB[1].GetData(), Converted.Num()) == 0);
+	AddInfo(FString::Printf(TEXT("ConvertFrame half -> sRGB8 %dx%d on %d worker threads: %.2f ms"), Width, Height, FTaskGraphInterface::Get().GetNumWorkerThreads(), ConvertMs));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraPrimitiveSet.h"
+#include "Components/PrimitiveComponent.h"
+#include "CoreGlobals.h"
+
+/** Hash of a component at an array index. Summed over the array to detect edits that keep its size. */
+static uint64 HashSlot(int32 ArrayIndex, const TWeakObjectPtr<UPrimitiveComponent>& Component)
+{
+	return ((uint64)GetTypeHash(Component) << 32 | (uint32)ArrayIndex) * 0x9E3779B97F4A7C15ull;
+}
+
+bool FCinePrimitiveSet::IsEntryCurrent(const TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, const TWeakObjectPtr<UPrimitiveComponent>& Component, const FEntry& Entry)
+{
+	return Array.IsValidIndex(Entry.ArrayIndex) && Array[Entry.ArrayIndex] == Component;
+}
+
+const FCinePrimitiveSet::FEntry* FCinePrimitiveSet::FindEntry(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component)
+{
+	const FEntry* Entry = Component ? Entries.Find(Component) : nullptr;
+	if (Entry && !IsEntryCurrent(Array, Component, *Entry))
+	{
+		// The array was edited in place behind our back
+		Rebuild(Array);
+		Entry = Entries.Find(Component);
+	}
+	return Entry;
+}
+
+bool FCinePrimitiveSet::Add(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component)
+{
+	Validate(Array);
+
+	if (!Component || FindEntry(Array, Component))
+	{
+		return false;
+	}
+
+	FEntry Entry;
+	Entry.ArrayIndex = Array.Add(Component);
+	Entry.PrimitiveId = Component->ComponentId;
+	Entries.Add(Component, Entry);
+	PrimitiveIds.Add(Entry.PrimitiveId);
+	ContentHash += HashSlot(Entry.ArrayIndex, Component);
+	++Version;
+	return true;
+}
+
+bool FCinePrimitiveSet::Remove(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component)
+{
+	Validate(Array);
+
+	const FEntry* FoundEntry = FindEntry(Array, Component);
+	if (!FoundEntry)
+	{
+		return false;
+	}
+	const FEntry Entry = *FoundEntry;
+	Entries.Remove(Component);
+	PrimitiveIds.Remove(Entry.PrimitiveId);
+
+	const int32 LastIndex = Array.Num() - 1;
+	ContentHash -= HashSlot(Entry.ArrayIndex, Array[Entry.ArrayIndex]);
+	if (Entry.ArrayIndex != LastIndex)
+	{
+		ContentHash -= HashSlot(LastIndex, Array[LastIndex]);
+		ContentHash += HashSlot(Entry.ArrayIndex, Array[LastIndex]);
+	}
+	Array.RemoveAtSwap(Entry.ArrayIndex, 1, false);
+	++Version;
+
+	if (Array.IsValidIndex(Entry.ArrayIndex))
+	{
+		// The last element moved into the hole
+		FEntry* MovedEntry = Entries.Find(Array[Entry.ArrayIndex]);
+		if (MovedEntry && MovedEntry->ArrayIndex == LastIndex)
+		{
+			MovedEntry->ArrayIndex = Entry.ArrayIndex;
+		}
+		else
+		{
+			Rebuild(Array);
+		}
+	}
+	return true;
+}
+
+void FCinePrimitiveSet::Reset(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array)
+{
+	Array.Reset();
+	Entries.Reset();
+	PrimitiveIds.Reset();
+	ContentHash = 0;
+	++Version;
+}
+
+bool FCinePrimitiveSet::Contains(const TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component)
+{
+	TArray<TWeakObjectPtr<UPrimitiveComponent> >& MutableArray = const_cast<TArray<TWeakObjectPtr<UPrimitiveComponent> >&>(Array);
+	Validate(MutableArray);
+	return FindEntry(MutableArray, Component) != nullptr;
+}
+
+void FCinePrimitiveSet::Rebuild(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array)
+{
+	Entries.Reset();
+	PrimitiveIds.Reset();
+	ContentHash = 0;
+
+	int32 WriteIndex = 0;
+	for (int32 ReadIndex = 0; ReadIndex < Array.Num(); ++ReadIndex)
+	{
+		const TWeakObjectPtr<UPrimitiveComponent> Component = Array[ReadIndex];
+		if (Entries.Contains(Component))
+		{
+			continue;
+		}
+
+		FEntry Entry;
+		Entry.ArrayIndex = WriteIndex;
+		Entry.PrimitiveId = Component.IsValid() ? Component->ComponentId : FPrimitiveComponentId();
+		Entries.Add(Component, Entry);
+		if (Component.IsValid())
+		{
+			PrimitiveIds.Add(Entry.PrimitiveId);
+		}
+		ContentHash += HashSlot(WriteIndex, Component);
+		Array[WriteIndex++] = Component;
+	}
+	Array.SetNum(WriteIndex, false);
+	++Version;
+}
+
+void FCinePrimitiveSet::Validate(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array)
+{
+	if (Entries.Num() != Array.Num())
+	{
+		Rebuild(Array);
+	}
+}
+
+void FCinePrimitiveSet::ValidateContents(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array)
+{
+	Validate(Array);
+
+	// Catches in-place replacements the entry checks haven't run into yet, at most once per frame since it reads the whole array
+	if (ContentsValidatedFrame == GFrameCounter)
+	{
+		return;
+	}
+	ContentsValidatedFrame = GFrameCounter;
+
+	uint64 ArrayHash = 0;
+	for (int32 ArrayIndex = 0; ArrayIndex < Array.Num(); ++ArrayIndex)
+	{
+		ArrayHash += HashSlot(ArrayIndex, Array[ArrayIndex]);
+	}
+	if (ArrayHash != ContentHash)
+	{
+		Rebuild(Array);
+	}
+}
+
+FCinePrimitiveIdSetPtr FCinePrimitiveSet::GetPrimitiveIds(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array)
+{
+	ValidateContents(Array);
+
+	if (!PrimitiveIdSnapshot.IsValid() || SnapshotVersion != Version)
+	{
+		PrimitiveIdSnapshot = MakeShared<const TSet<FPrimitiveComponentId>, ESPMode::ThreadSafe>(PrimitiveIds);
+		SnapshotVersion = Version;
+	}
+	return PrimitiveIdSnapshot;
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "SceneTypes.h"
+
+class UPrimitiveComponent;
+
+typedef TSharedPtr<const TSet<FPrimitiveComponentId>, ESPMode::ThreadSafe> FCinePrimitiveIdSetPtr;
+
+/**
+ * Hash index over a TArray of weak primitive components (the hidden and show-only lists), giving O(1) add, remove and lookup.
+ * The array stays the serialized, renderer visible storage; removal swaps with the last element so order is not preserved.
+ * Also keeps the primitive component ids of the array up to date incrementally, so nothing has to resolve weak pointers per capture.
+ */
+class CINEMATICCAMERA_API FCinePrimitiveSet
+{
+public:
+	/** Adds Component to Array unless already there. Returns true if it was added. */
+	bool Add(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component);
+
+	/** Removes Component from Array. Returns true if it was there. */
+	bool Remove(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component);
+
+	void Reset(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array);
+
+	bool Contains(const TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component);
+
+	/** Rebuilds the index from Array, e.g. after it was loaded. Duplicates in Array are removed. */
+	void Rebuild(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array);
+
+	/**
+	 * Immutable snapshot of the primitive ids in the set, safe to hand to the render thread.
+	 * A new snapshot is only built when the set changed since the last call.
+	 */
+	FCinePrimitiveIdSetPtr GetPrimitiveIds(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array);
+
+	/** Incremented on every change, usable to detect changes without looking at the contents. */
+	uint32 GetVersion() const { return Version; }
+
+private:
+	struct FEntry
+	{
+		int32 ArrayIndex;
+		FPrimitiveComponentId PrimitiveId;
+	};
+
+	/** Rebuilds if Array changed size behind our back (serialization, direct edits). */
+	void Validate(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array);
+
+	/** Also rebuilds if elements of Array were replaced in place. Reads the whole array, so it only runs once per frame. */
+	void ValidateContents(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array);
+
+	/** Whether Entry still points at Component in Array. */
+	static bool IsEntryCurrent(const TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, const TWeakObjectPtr<UPrimitiveComponent>& Component, const FEntry& Entry);
+
+	/** Finds the entry of Component, rebuilding first if the array slot it points at holds something else. */
+	const FEntry* FindEntry(TArray<TWeakObjectPtr<UPrimitiveComponent> >& Array, UPrimitiveComponent* Component);
+
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, FEntry> Entries;
+	TSet<FPrimitiveComponentId> PrimitiveIds;
+	FCinePrimitiveIdSetPtr PrimitiveIdSnapshot;
+	uint32 Version = 0;
+	uint32 SnapshotVersion = 0;
+	/** Sum of the slot hashes of the array as this set last left it. */
+	uint64 ContentHash = 0;
+	uint64 ContentsValidatedFrame = MAX_uint64;
+};
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraPrimitiveSet.h"
+#include "Misc/AutomationTest.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Components that are never registered, enough for the set which only reads their ComponentId. */
+static void CreateTestPrimitives(int32 Num, TArray<TStrongObjectPtr<UPrimitiveComponent> >& OutPrimitives)
+{
+	OutPrimitives.Reserve(OutPrimitives.Num() + Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		OutPrimitives.Emplace(NewObject<UStaticMeshComponent>(GetTransientPackage()));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCinePrimitiveSetBenchmarkTest, "CineCamera.PrimitiveSet.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Adds 50k components, snapshots the ids as a capture does, then removes them, in random order.
+ * Compared with the linear TArray AddUnique/Remove and the per capture weak pointer resolve the set replaced.
+ */
+bool FCinePrimitiveSetBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 NumPrimitives = 50000;
+	const int32 NumCaptures = 60;
+
+	TArray<TStrongObjectPtr<UPrimitiveComponent> > Primitives;
+	CreateTestPrimitives(NumPrimitives, Primitives);
+
+	FRandomStream Random(NumPrimitives);
+	TArray<UPrimitiveComponent*> RemoveOrder;
+	for (const TStrongObjectPtr<UPrimitiveComponent>& Primitive : Primitives)
+	{
+		RemoveOrder.Add(Primitive.Get());
+	}
+	for (int32 Index = RemoveOrder.Num() - 1; Index > 0; --Index)
+	{
+		RemoveOrder.Swap(Index, Random.RandRange(0, Index));
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	TArray<TWeakObjectPtr<UPrimitiveComponent> > LegacyArray;
+	for (const TStrongObjectPtr<UPrimitiveComponent>& Primitive : Primitives)
+	{
+		LegacyArray.AddUnique(Primitive.Get());
+	}
+	const double LegacyAddMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Capture = 0; Capture < NumCaptures; ++Capture)
+	{
+		TSet<FPrimitiveComponentId> Ids;
+		for (const TWeakObjectPtr<UPrimitiveComponent>& Component : LegacyArray)
+		{
+			if (Component.IsValid())
+			{
+				Ids.Add(Component->ComponentId);
+			}
+		}
+	}
+	const double LegacyCaptureMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumCaptures;
+
+	StartTime = FPlatformTime::Seconds();
+	for (UPrimitiveComponent* Primitive : RemoveOrder)
+	{
+		LegacyArray.Remove(Primitive);
+	}
+	const double LegacyRemoveMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	FCinePrimitiveSet Set;
+	TArray<TWeakObjectPtr<UPrimitiveComponent> > Array;
+	StartTime = FPlatformTime::Seconds();
+	for (const TStrongObjectPtr<UPrimitiveComponent>& Primitive : Primitives)
+	{
+		Set.Add(Array, Primitive.Get());
+	}
+	const double SetAddMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// One capture per frame, the first one builds the snapshot and every frame validates the contents once
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Capture = 0; Capture < NumCaptures; ++Capture)
+	{
+		FCinePrimitiveIdSetPtr Ids = Set.GetPrimitiveIds(Array);
+		TestEqual(TEXT("Snapshot holds every primitive"), Ids->Num(), NumPrimitives);
+		++GFrameCounter;
+	}
+	const double SetCaptureMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumCaptures;
+
+	StartTime = FPlatformTime::Seconds();
+	for (UPrimitiveComponent* Primitive : RemoveOrder)
+	{
+		Set.Remove(Array, Primitive);
+	}
+	const double SetRemoveMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TestEqual(TEXT("Every primitive was removed"), Array.Num(), 0);
+
+	AddInfo(FString::Printf(TEXT("%d primitives, TArray: add %.2f ms, capture %.3f ms, remove %.2f ms"), NumPrimitives, LegacyAddMs, LegacyCaptureMs, LegacyRemoveMs));
+	AddInfo(FString::Printf(TEXT("%d primitives, FCinePrimitiveSet: add %.2f ms, capture %.3f ms, remove %.2f ms"), NumPrimitives, SetAddMs, SetCaptureMs, SetRemoveMs));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCinePrimitiveSetInPlaceEditTest, "CineCamera.PrimitiveSet.InPlaceEdit", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** Replacing an element of the array directly, like the details panel does, must not leave the set pointing at the old component. */
+bool FCinePrimitiveSetInPlaceEditTest::RunTest(const FString& Parameters)
+{
+	TArray<TStrongObjectPtr<UPrimitiveComponent> > Primitives;
+	CreateTestPrimitives(5, Primitives);
+	UPrimitiveComponent* Replaced = Primitives[0].Get();
+	UPrimitiveComponent* Replacement = Primitives[3].Get();
+
+	FCinePrimitiveSet Set;
+	TArray<TWeakObjectPtr<UPrimitiveComponent> > Array;
+	for (int32 Index = 0; Index < 3; ++Index)
+	{
+		Set.Add(Array, Primitives[Index].Get());
+	}
+	FCinePrimitiveIdSetPtr Ids = Set.GetPrimitiveIds(Array);
+
+	Array[0] = Replacement;
+	++GFrameCounter;
+
+	Ids = Set.GetPrimitiveIds(Array);
+	TestTrue(TEXT("Snapshot picks up the replacement"), Ids->Contains(Replacement->ComponentId));
+	TestFalse(TEXT("Snapshot drops the replaced component"), Ids->Contains(Replaced->ComponentId));
+
+	// Same edit again, without a snapshot in between, so only the entry checks can catch it
+	Array[0] = Primitives[4].Get();
+	TestTrue(TEXT("Removing an untouched component works"), Set.Remove(Array, Primitives[1].Get()));
+	TestFalse(TEXT("The replaced component is gone"), Set.Contains(Array, Replacement));
+	TestTrue(TEXT("The new component is found"), Set.Contains(Array, Primitives[4].Get()));
+	TestTrue(TEXT("Removing the new component works"), Set.Remove(Array, Primitives[4].Get()));
+	TestEqual(TEXT("One component is left"), Array.Num(), 1);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,292 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraSegmentation.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+
+/** Slots SweepStaleIds() looks at whenever an id is handed out, so stale ids are reclaimed at least as fast as new ones are needed. */
+static const int32 SweepSlotsPerAllocation = 4;
+
+void UCineSegmentationSubsystem::Deinitialize()
+{
+	for (const FSlot& Slot : Slots)
+	{
+		for (const TWeakObjectPtr<UPrimitiveComponent>& Component : Slot.Components)
+		{
+			if (Component.IsValid())
+			{
+				Component->SetRenderCustomDepth(false);
+			}
+		}
+		if (Slot.Actor.IsValid())
+		{
+			Slot.Actor->OnEndPlay.RemoveDynamic(this, &UCineSegmentationSubsystem::HandleActorEndPlay);
+		}
+	}
+	Slots.Reset();
+	FreeIds.Reset();
+	OwnerIds.Reset();
+	NumInstances = 0;
+	SweepIndex = 1;
+	StaleBits = 0;
+	for (int32 Bit = 0; Bit < MaxIdBits; ++Bit)
+	{
+		BitComponentSets[Bit].Reset(BitComponents[Bit]);
+	}
+	Table.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UCineSegmentationSubsystem::RegisterActor(AActor* Actor, FName ClassName)
+{
+	return Actor ? (int32)AllocateId(Actor, Actor, nullptr, ClassName) : 0;
+}
+
+int32 UCineSegmentationSubsystem::RegisterComponent(UPrimitiveComponent* Component, FName ClassName)
+{
+	return Component ? (int32)AllocateId(Component, Component->GetOwner(), Component, ClassName) : 0;
+}
+
+uint32 UCineSegmentationSubsystem::AllocateId(UObject* Owner, AActor* Actor, UPrimitiveComponent* Component, FName ClassName)
+{
+	if (const uint32* Existing = OwnerIds.Find(Owner))
+	{
+		return *Existing;
+	}
+
+	SweepStaleIds(SweepSlotsPerAllocation);
+
+	uint32 Id = 0;
+	if (FreeIds.Num() > 0)
+	{
+		Id = FreeIds.Pop(false);
+	}
+	else
+	{
+		if (Slots.Num() == 0)
+		{
+			// Id 0 is the background
+			Slots.AddDefaulted();
+		}
+		const int32 MaxIds = 255 << MaxIdBits;
+		if (Slots.Num() > MaxIds)
+		{
+			return 0;
+		}
+		Id = (uint32)Slots.Num();
+		Slots.AddDefaulted();
+	}
+
+	FSlot& Slot = Slots[Id];
+	Slot.Owner = Owner;
+	Slot.Actor = Actor;
+	Slot.RegisteredComponent = Component;
+	Slot.ClassId = (uint32)GetOrAddClassId(ClassName);
+	Slot.Components.Reset();
+	if (Component)
+	{
+		Slot.Components.Add(Component);
+	}
+	else if (Actor)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
+		Actor->GetComponents(PrimitiveComponents);
+		Slot.Components.Append(PrimitiveComponents);
+	}
+
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Primitive : Slot.Components)
+	{
+		ApplyStencil(Primitive.Get(), Id);
+	}
+	UpdateBitComponents(Id, true);
+
+	if (Actor)
+	{
+		Actor->OnEndPlay.AddUniqueDynamic(this, &UCineSegmentationSubsystem::HandleActorEndPlay);
+	}
+
+	OwnerIds.Add(Owner, Id);
+	++NumInstances;
+	++Version;
+	return Id;
+}
+
+void UCineSegmentationSubsystem::Unregister(UObject* ActorOrComponent)
+{
+	if (const uint32* Id = OwnerIds.Find(ActorOrComponent))
+	{
+		ReleaseId(*Id);
+	}
+}
+
+void UCineSegmentationSubsystem::ReleaseId(uint32 Id)
+{
+	FSlot& Slot = Slots[Id];
+	OwnerIds.Remove(Slot.Owner);
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Component : Slot.Components)
+	{
+		if (Component.IsValid())
+		{
+			Component->SetRenderCustomDepth(false);
+		}
+	}
+	UpdateBitComponents(Id, false);
+	Slot = FSlot();
+
+	FreeIds.Add(Id);
+	--NumInstances;
+	++Version;
+}
+
+void UCineSegmentationSubsystem::HandleActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	Unregister(Actor);
+
+	TInlineComponentArray<UPrimitiveComponent*> PrimitiveComponents;
+	Actor->GetComponents(PrimitiveComponents);
+	for (UPrimitiveComponent* Component : PrimitiveComponents)
+	{
+		Unregister(Component);
+	}
+}
+
+void UCineSegmentationSubsystem::SweepStaleIds(int32 MaxSlots)
+{
+	for (int32 Count = FMath::Min(MaxSlots, Slots.Num() - 1); Count > 0; --Count)
+	{
+		if (SweepIndex >= Slots.Num())
+		{
+			SweepIndex = 1;
+		}
+
+		// Free slots have a null owner, used ones whose owner was destroyed without unregistering a stale one
+		const FSlot& Slot = Slots[SweepIndex];
+		if (!Slot.Owner.IsExplicitlyNull() && !Slot.Owner.IsValid())
+		{
+			ReleaseId((uint32)SweepIndex);
+		}
+		++SweepIndex;
+	}
+}
+
+void UCineSegmentationSubsystem::UpdateBitComponents(uint32 Id, bool bAdd)
+{
+	const uint32 IdBits = GetIdBits(Id);
+	const FSlot& Slot = Slots[Id];
+	for (int32 Bit = 0; Bit < MaxIdBits; ++Bit)
+	{
+		if ((IdBits & (1u << Bit)) == 0)
+		{
+			continue;
+		}
+
+		bool bHasStale = false;
+		for (const TWeakObjectPtr<UPrimitiveComponent>& Component : Slot.Components)
+		{
+			if (!Component.IsValid())
+			{
+				bHasStale = true;
+			}
+			else if (bAdd)
+			{
+				BitComponentSets[Bit].Add(BitComponents[Bit], Component.Get());
+			}
+			else
+			{
+				BitComponentSets[Bit].Remove(BitComponents[Bit], Component.Get());
+			}
+		}
+
+		// Destroyed components can't be looked up anymore, their entries are dropped all at once by the next GetBitComponents()
+		if (!bAdd && bHasStale)
+		{
+			StaleBits |= 1u << Bit;
+		}
+	}
+}
+
+int32 UCineSegmentationSubsystem::GetInstanceId(const UObject* ActorOrComponent) const
+{
+	const uint32* Id = OwnerIds.Find(const_cast<UObject*>(ActorOrComponent));
+	return Id ? (int32)*Id : 0;
+}
+
+int32 UCineSegmentationSubsystem::GetOrAddClassId(FName ClassName)
+{
+	if (ClassNames.Num() == 0)
+	{
+		ClassNames.Add(NAME_None);
+		ClassIds.Add(NAME_None, 0);
+	}
+
+	if (const uint32* Existing = ClassIds.Find(ClassName))
+	{
+		return (int32)*Existing;
+	}
+
+	const uint32 ClassId = (uint32)ClassNames.Add(ClassName);
+	ClassIds.Add(ClassName, ClassId);
+	++Version;
+	return (int32)ClassId;
+}
+
+int32 UCineSegmentationSubsystem::GetNumIdBits() const
+{
+	// Ids are never higher than the number of slots ever used, the free list keeps that small
+	const uint32 HighestIdBits = Slots.Num() > 0 ? GetIdBits((uint32)Slots.Num() - 1) : 0;
+	return HighestIdBits > 0 ? (int32)FMath::FloorLog2(HighestIdBits) + 1 : 0;
+}
+
+TArray<TWeakObjectPtr<UPrimitiveComponent> >& UCineSegmentationSubsystem::GetBitComponents(int32 Bit)
+{
+	check(Bit >= 0 && Bit < MaxIdBits);
+	if (StaleBits & (1u << Bit))
+	{
+		StaleBits &= ~(1u << Bit);
+		BitComponents[Bit].RemoveAllSwap([](const TWeakObjectPtr<UPrimitiveComponent>& Component) { return !Component.IsValid(); });
+		BitComponentSets[Bit].Rebuild(BitComponents[Bit]);
+	}
+	return BitComponents[Bit];
+}
+
+FCinePrimitiveIdSetPtr UCineSegmentationSubsystem::GetBitPrimitiveIds(int32 Bit)
+{
+	return BitComponentSets[Bit].GetPrimitiveIds(GetBitComponents(Bit));
+}
+
+uint8 UCineSegmentationSubsystem::GetStencilDigit(uint32 Id)
+{
+	return Id > 0 ? (uint8)((Id - 1) % 255 + 1) : 0;
+}
+
+void UCineSegmentationSubsystem::ApplyStencil(UPrimitiveComponent* Component, uint32 Id)
+{
+	if (Component)
+	{
+		Component->SetRenderCustomDepth(true);
+		Component->SetCustomDepthStencilValue(GetStencilDigit(Id));
+	}
+}
+
+FCineSegmentationTablePtr UCineSegmentationSubsystem::GetTable()
+{
+	if (Table.IsValid() && Table->Version == Version)
+	{
+		return Table;
+	}
+
+	TSharedRef<FCineSegmentationTable, ESPMode::ThreadSafe> NewTable = MakeShared<FCineSegmentationTable, ESPMode::ThreadSafe>();
+	NewTable->Version = Version;
+	NewTable->ClassNames = ClassNames;
+	NewTable->Instances.SetNum(Slots.Num());
+	for (int32 Id = 1; Id < Slots.Num(); ++Id)
+	{
+		FCineSegmentationEntry& Entry = NewTable->Instances[Id];
+		Entry.Actor = Slots[Id].Actor;
+		Entry.Component = Slots[Id].RegisteredComponent;
+		Entry.ClassId = Slots[Id].ClassId;
+	}
+	Table = NewTable;
+	return Table;
+}
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineTypes.h"
+#include "CineCameraPrimitiveSet.h"
+#include "CineCameraSegmentation.generated.h"
+
+class AActor;
+class UPrimitiveComponent;
+
+/** What a segmentation instance id stands for. */
+struct FCineSegmentationEntry
+{
+	TWeakObjectPtr<AActor> Actor;
+	/** The registered component, null if the whole actor was registered. */
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	/** Index into FCineSegmentationTable::ClassNames, 0 for free ids. */
+	uint32 ClassId = 0;
+};
+
+/** Immutable snapshot of the instance and class ids, handed out with every segmentation frame so ids released later still resolve. */
+struct FCineSegmentationTable
+{
+	/** Increases with every change of the allocator. */
+	uint64 Version = 0;
+	/** Indexed by instance id, entry 0 is the background. */
+	TArray<FCineSegmentationEntry> Instances;
+	/** Indexed by class id, entry 0 is NAME_None. */
+	TArray<FName> ClassNames;
+};
+
+typedef TSharedPtr<const FCineSegmentationTable, ESPMode::ThreadSafe> FCineSegmentationTablePtr;
+
+/**
+ * Instance and class ids for segmentation captures of one world.
+ * Ids come from a free list, so registering and unregistering is O(1) and ids stay compact as actors stream in and out.
+ *
+ * Custom stencil only holds 8 bits, so the stencil carries the low base 255 digit of an id, (N - 1) % 255 + 1 with 0 the background,
+ * and is set once when the id is handed out. The rest of the id, (N - 1) / 255, is rendered as bit planes without touching the primitives:
+ * bit k's show only list holds the primitives whose id has that bit, and a pixel has the bit where a depth render of that list matches the
+ * depth of the full scene. Up to 255 ids segmentation is a single render; beyond that it costs one depth render of the scene plus one per bit.
+ * Registered actors are released when they end play, components destroyed while registered are swept up as ids are handed out.
+ */
+UCLASS()
+class CINEMATICCAMERA_API UCineSegmentationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Bits of an id above its stencil digit, for up to 255 * 2^16 ids. */
+	static const int32 MaxIdBits = 16;
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/** Gives every primitive component of Actor the same new instance id. Returns the id, or the existing one if Actor is registered already. */
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		int32 RegisterActor(AActor* Actor, FName ClassName);
+
+	/** Gives Component an instance id of its own. */
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		int32 RegisterComponent(UPrimitiveComponent* Component, FName ClassName);
+
+	/** Releases the id of an actor or component registered before, and stops it from rendering custom stencil. */
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		void Unregister(UObject* ActorOrComponent);
+
+	/** Instance id of a registered actor or component, 0 if it has none. */
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		int32 GetInstanceId(const UObject* ActorOrComponent) const;
+
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		int32 GetOrAddClassId(FName ClassName);
+
+	UFUNCTION(BlueprintCallable, Category = Segmentation)
+		int32 GetNumInstances() const { return NumInstances; }
+
+	/** Bit planes needed above the stencil digit to render every id handed out so far, 0 up to 255 ids. */
+	int32 GetNumIdBits() const;
+
+	/** Components whose id has Bit set above the stencil digit. Captures swap the list into their ShowOnlyComponents to render the bit. */
+	TArray<TWeakObjectPtr<UPrimitiveComponent> >& GetBitComponents(int32 Bit);
+
+	/** Primitive ids of GetBitComponents(Bit). */
+	FCinePrimitiveIdSetPtr GetBitPrimitiveIds(int32 Bit);
+
+	/** Releases the ids of up to MaxSlots slots whose actor or component is gone, continuing where the last sweep stopped. */
+	void SweepStaleIds(int32 MaxSlots);
+
+	/** Snapshot of the current ids, rebuilt at most once per change. */
+	FCineSegmentationTablePtr GetTable();
+
+	/** Custom stencil value of Id. */
+	static uint8 GetStencilDigit(uint32 Id);
+
+	/** The part of Id above its stencil digit, rendered as bit planes. */
+	static uint32 GetIdBits(uint32 Id) { return Id > 0 ? (Id - 1) / 255 : 0; }
+
+	/** Id of a pixel from its stencil digit and the bits above it. */
+	static uint32 MakeId(uint8 StencilDigit, uint32 IdBits) { return StencilDigit > 0 ? IdBits * 255 + StencilDigit : 0; }
+
+private:
+	struct FSlot
+	{
+		TWeakObjectPtr<UObject> Owner;
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UPrimitiveComponent> RegisteredComponent;
+		TArray<TWeakObjectPtr<UPrimitiveComponent> > Components;
+		uint32 ClassId = 0;
+	};
+
+	uint32 AllocateId(UObject* Owner, AActor* Actor, UPrimitiveComponent* Component, FName ClassName);
+	void ReleaseId(uint32 Id);
+	void ApplyStencil(UPrimitiveComponent* Component, uint32 Id);
+
+	/** Adds or removes the components of slot Id to or from the show only lists of the bits of the id. */
+	void UpdateBitComponents(uint32 Id, bool bAdd);
+
+	/** Releases what Actor and its components registered. */
+	UFUNCTION()
+		void HandleActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+	/** Indexed by id, slot 0 is never used. */
+	TArray<FSlot> Slots;
+	/** Released ids, reused last in first out. */
+	TArray<uint32> FreeIds;
+	TMap<TWeakObjectPtr<UObject>, uint32> OwnerIds;
+	int32 NumInstances = 0;
+	/** Next slot SweepStaleIds() looks at. */
+	int32 SweepIndex = 1;
+
+	TMap<FName, uint32> ClassIds;
+	TArray<FName> ClassNames;
+
+	/** Show only lists of the id bits, indexed by bit. */
+	TArray<TWeakObjectPtr<UPrimitiveComponent> > BitComponents[MaxIdBits];
+	FCinePrimitiveSet BitComponentSets[MaxIdBits];
+	/** Bits whose list still holds components destroyed while registered. */
+	uint32 StaleBits = 0;
+
+	uint64 Version = 1;
+	FCineSegmentationTablePtr Table;
+};
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraSegmentation.h"
+#include "Misc/AutomationTest.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineSegmentationChurnBenchmarkTest, "CineCamera.Segmentation.ChurnBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Registers 50k components, then streams a tenth of them out and new ones in per round, as a level streaming in and out would.
+ * Checks ids stay compact and decode through the stencil digit and id bits, and that components destroyed without
+ * unregistering give their ids back. Reports the cost of registering, unregistering and the table snapshot.
+ */
+bool FCineSegmentationChurnBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 NumPrimitives = 50000;
+	const int32 NumRounds = 20;
+	const int32 ChurnPerRound = NumPrimitives / 10;
+
+	// Never registered with a world, the subsystem only needs the components' stencil setters and ids
+	TStrongObjectPtr<UCineSegmentationSubsystem> Segmentation(NewObject<UCineSegmentationSubsystem>(GetTransientPackage()));
+	const FName ClassName(TEXT("Churn"));
+
+	TArray<TStrongObjectPtr<UPrimitiveComponent> > Live;
+	Live.Reserve(NumPrimitives);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumPrimitives; ++Index)
+	{
+		UPrimitiveComponent* Component = NewObject<UStaticMeshComponent>(GetTransientPackage());
+		Segmentation->RegisterComponent(Component, ClassName);
+		Live.Emplace(Component);
+	}
+	const double InitialRegisterMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TestEqual(TEXT("Every component has an id"), Segmentation->GetNumInstances(), NumPrimitives);
+
+	FRandomStream Random(NumPrimitives);
+	double UnregisterMs = 0.0;
+	double RegisterMs = 0.0;
+	double TableMs = 0.0;
+	for (int32 Round = 0; Round < NumRounds; ++Round)
+	{
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Count = 0; Count < ChurnPerRound; ++Count)
+		{
+			const int32 Index = Random.RandRange(0, Live.Num() - 1);
+			Segmentation->Unregister(Live[Index].Get());
+			Live.RemoveAtSwap(Index, 1, false);
+		}
+		UnregisterMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Count = 0; Count < ChurnPerRound; ++Count)
+		{
+			UPrimitiveComponent* Component = NewObject<UStaticMeshComponent>(GetTransientPackage());
+			Segmentation->RegisterComponent(Component, ClassName);
+			Live.Emplace(Component);
+		}
+		RegisterMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		StartTime = FPlatformTime::Seconds();
+		FCineSegmentationTablePtr Table = Segmentation->GetTable();
+		TableMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		TestTrue(TEXT("Ids stay compact"), Table->Instances.Num() <= NumPrimitives + 1);
+	}
+	TestEqual(TEXT("Churn keeps the instance count"), Segmentation->GetNumInstances(), NumPrimitives);
+
+	// Every id round trips through its stencil digit and bits, and the bit lists hold exactly the primitives with the bit
+	int32 NumMismatches = 0;
+	const int32 NumIdBits = Segmentation->GetNumIdBits();
+	TArray<FCinePrimitiveIdSetPtr> BitIds;
+	for (int32 Bit = 0; Bit < NumIdBits; ++Bit)
+	{
+		BitIds.Add(Segmentation->GetBitPrimitiveIds(Bit));
+	}
+	for (const TStrongObjectPtr<UPrimitiveComponent>& Component : Live)
+	{
+		const uint32 Id = (uint32)Segmentation->GetInstanceId(Component.Get());
+		const uint32 IdBits = UCineSegmentationSubsystem::GetIdBits(Id);
+		bool bMatches = UCineSegmentationSubsystem::MakeId(UCineSegmentationSubsystem::GetStencilDigit(Id), IdBits) == Id;
+		for (int32 Bit = 0; Bit < NumIdBits; ++Bit)
+		{
+			bMatches &= BitIds[Bit]->Contains(Component->ComponentId) == ((IdBits & (1u << Bit)) != 0);
+		}
+		NumMismatches += bMatches ? 0 : 1;
+	}
+	TestEqual(TEXT("Ids decode from their stencil digit and bit lists"), NumMismatches, 0);
+
+	// Destroyed while registered, the sweep must hand their ids out again instead of growing the table
+	const int32 NumDestroyed = ChurnPerRound;
+	for (int32 Count = 0; Count < NumDestroyed; ++Count)
+	{
+		Live.Pop(false)->MarkPendingKill();
+	}
+	Segmentation->SweepStaleIds(NumPrimitives + 1);
+	TestEqual(TEXT("Destroyed components lose their ids"), Segmentation->GetNumInstances(), NumPrimitives - NumDestroyed);
+	const int32 TableSize = Segmentation->GetTable()->Instances.Num();
+	for (int32 Count = 0; Count < NumDestroyed; ++Count)
+	{
+		UPrimitiveComponent* Component = NewObject<UStaticMeshComponent>(GetTransientPackage());
+		Segmentation->RegisterComponent(Component, ClassName);
+		Live.Emplace(Component);
+	}
+	TestEqual(TEXT("Swept ids are reused"), Segmentation->GetTable()->Instances.Num(), TableSize);
+
+	const int32 NumOps = NumRounds * ChurnPerRound;
+	AddInfo(FString::Printf(TEXT("%d components registered in %.2f ms, %d id bits above the stencil"), NumPrimitives, InitialRegisterMs, NumIdBits));
+	AddInfo(FString::Printf(TEXT("Churn of %d per round: unregister %.3f us, register %.3f us per component, table snapshot %.3f ms per round"),
+		ChurnPerRound, UnregisterMs * 1000.0 / NumOps, RegisterMs * 1000.0 / NumOps, TableMs / NumRounds));
+
+	Segmentation->Deinitialize();
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraSharedMemoryExport.h"
+#include "CineCameraSharedMemoryLayout.h"
+
+#define CINE_SHM_SUPPORTED (PLATFORM_LINUX || PLATFORM_MAC)
+
+#if CINE_SHM_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineSharedMemory, Log, All);
+
+static ECineShmPixelFormat ToShmPixelFormat(EPixelFormat Format)
+{
+	switch (Format)
+	{
+	case PF_B8G8R8A8:
+		return CineShm_BGRA8;
+	case PF_R8G8B8A8:
+		return CineShm_RGBA8;
+	case PF_FloatRGBA:
+		return CineShm_RGBA16F;
+	case PF_A32B32G32R32F:
+		return CineShm_RGBA32F;
+	case PF_R16F:
+		return CineShm_R16F;
+	case PF_R32_FLOAT:
+		return CineShm_R32F;
+	default:
+		return CineShm_Unknown;
+	}
+}
+
+FCineSharedMemoryExporter::FCineSharedMemoryExporter(const FString& InName, int32 InNumSlots, int64 InSlotDataCapacity)
+	: Name(InName)
+	, NumSlots(FMath::Max(InNumSlots, 1))
+	, SlotDataCapacity(Align(FMath::Max<int64>(InSlotDataCapacity, 1), 64))
+	, SlotStride(sizeof(FCineShmSlotHeader) + SlotDataCapacity)
+	, Mapping(nullptr)
+	, MappingSize(sizeof(FCineShmRingHeader) + SlotStride * NumSlots)
+	, NumPublished(0)
+{
+#if CINE_SHM_SUPPORTED
+	const auto AnsiName = StringCast<ANSICHAR>(*Name);
+
+	// A crashed run may have left the name behind, readers of it see a fresh object after reopening
+	shm_unlink(AnsiName.Get());
+	const int Descriptor = shm_open(AnsiName.Get(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (Descriptor < 0)
+	{
+		UE_LOG(LogCineSharedMemory, Warning, TEXT("Failed to create shared memory %s (errno %d)"), *Name, errno);
+		return;
+	}
+
+	void* Mapped = MAP_FAILED;
+	if (ftruncate(Descriptor, (off_t)MappingSize) == 0)
+	{
+		Mapped = mmap(nullptr, (size_t)MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+	}
+	close(Descriptor);
+
+	if (Mapped == MAP_FAILED)
+	{
+		UE_LOG(LogCineSharedMemory, Warning, TEXT("Failed to map %lld bytes of shared memory %s (errno %d)"), MappingSize, *Name, errno);
+		shm_unlink(AnsiName.Get());
+		return;
+	}
+
+	// ftruncate zero fills, so every slot starts with an even sequence
+	Mapping = (uint8*)Mapped;
+	FCineShmRingHeader* Header = (FCineShmRingHeader*)Mapping;
+	Header->Magic = CINE_SHM_MAGIC;
+	Header->Version = CINE_SHM_VERSION;
+	Header->NumSlots = (uint32_t)NumSlots;
+	Header->Closed = 0;
+	Header->SlotStride = (uint64_t)SlotStride;
+	Header->SlotDataCapacity = (uint64_t)SlotDataCapacity;
+	Header->NumPublished = 0;
+	FPlatformMisc::MemoryBarrier();
+#else
+	UE_LOG(LogCineSharedMemory, Warning, TEXT("Shared memory export of %s is only supported on Linux and Mac"), *Name);
+#endif
+}
+
+FCineSharedMemoryExporter::~FCineSharedMemoryExporter()
+{
+#if CINE_SHM_SUPPORTED
+	if (Mapping)
+	{
+		FCineShmRingHeader* Header = (FCineShmRingHeader*)Mapping;
+		FPlatformMisc::MemoryBarrier();
+		Header->Closed = 1;
+		munmap(Mapping, (size_t)MappingSize);
+		shm_unlink(StringCast<ANSICHAR>(*Name).Get());
+	}
+#endif
+}
+
+bool FCineSharedMemoryExporter::IsCompatible(const FString& InName, int32 InNumSlots, int64 FrameBytes) const
+{
+	return Name == InName && NumSlots == FMath::Max(InNumSlots, 1) && FrameBytes <= SlotDataCapacity;
+}
+
+bool FCineSharedMemoryExporter::WriteFrame(const FCineCaptureFrame& Frame, const FCineCameraIntrinsics& Intrinsics)
+{
+	const int64 DataSize = (int64)Frame.Stride * Frame.Height;
+	const ECineShmPixelFormat PixelFormat = ToShmPixelFormat(Frame.PixelFormat);
+	if (!Mapping || !Frame.Data.IsValid() || DataSize > SlotDataCapacity || PixelFormat == CineShm_Unknown)
+	{
+		return false;
+	}
+
+	uint8* Slot = Mapping + sizeof(FCineShmRingHeader) + (NumPublished % NumSlots) * SlotStride;
+	FCineShmSlotHeader* SlotHeader = (FCineShmSlotHeader*)Slot;
+
+	// Odd while writing, so readers still holding this slot notice they were lapped
+	SlotHeader->Sequence = SlotHeader->Sequence + 1;
+	FPlatformMisc::MemoryBarrier();
+
+	uint64 TimestampNs = 0;
+#if CINE_SHM_SUPPORTED
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	TimestampNs = (uint64)Now.tv_sec * 1000000000ull + (uint64)Now.tv_nsec;
+#endif
+
+	SlotHeader->PublishIndex = NumPublished;
+	SlotHeader->FrameNumber = Frame.FrameNumber;
+	SlotHeader->TimestampNs = TimestampNs;
+	SlotHeader->Width = (uint32_t)Frame.Width;
+	SlotHeader->Height = (uint32_t)Frame.Height;
+	SlotHeader->Stride = (uint32_t)Frame.Stride;
+	SlotHeader->PixelFormat = PixelFormat;
+	SlotHeader->FocalLengthX = Intrinsics.FocalLengthX;
+	SlotHeader->FocalLengthY = Intrinsics.FocalLengthY;
+	SlotHeader->PrincipalPointX = Intrinsics.PrincipalPointX;
+	SlotHeader->PrincipalPointY = Intrinsics.PrincipalPointY;
+	FMemory::Memcpy(Slot + sizeof(FCineShmSlotHeader), Frame.Data->GetData(), DataSize);
+
+	FPlatformMisc::MemoryBarrier();
+	SlotHeader->Sequence = SlotHeader->Sequence + 1;
+	FPlatformMisc::MemoryBarrier();
+
+	++NumPublished;
+	((FCineShmRingHeader*)Mapping)->NumPublished = NumPublished;
+	return true;
+}
+
+FString FCineSharedMemoryExporter::MakeName(const FString& BaseName)
+{
+	// POSIX names are a single path component, keep them portable
+	FString Sanitized = BaseName;
+	for (TCHAR& Char : Sanitized.GetCharArray())
+	{
+		if (Char != 0 && !FChar::IsAlnum(Char) && Char != TEXT('_') && Char != TEXT('-'))
+		{
+			Char = TEXT('_');
+		}
+	}
+	return FString::Printf(TEXT("/CineCapture_%s"), *Sanitized);
+}
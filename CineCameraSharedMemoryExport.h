@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CineCameraCaptureReadback.h"
+
+/** Pinhole intrinsics of a capture, in pixels. */
+struct FCineCameraIntrinsics
+{
+	float FocalLengthX = 0.f;
+	float FocalLengthY = 0.f;
+	float PrincipalPointX = 0.f;
+	float PrincipalPointY = 0.f;
+};
+
+/**
+ * Publishes read back frames into a POSIX shared memory ring that other local processes map, see CineCameraSharedMemoryLayout.h for the layout
+ * and CineCameraSharedMemoryReader.h for a reader. Only available on Linux and Mac, IsValid() is false elsewhere.
+ * Game thread only.
+ */
+class CINEMATICCAMERA_API FCineSharedMemoryExporter
+{
+public:
+	/** Creates the shared memory object Name (replacing one left behind by a previous run) with NumSlots slots of SlotDataCapacity pixel bytes. */
+	FCineSharedMemoryExporter(const FString& InName, int32 InNumSlots, int64 InSlotDataCapacity);
+
+	/** Marks the ring closed for readers and unlinks the name. Readers that still have it mapped keep their mapping. */
+	~FCineSharedMemoryExporter();
+
+	bool IsValid() const { return Mapping != nullptr; }
+
+	/** Whether this exporter can take frames of FrameBytes for the given settings, otherwise it has to be recreated. */
+	bool IsCompatible(const FString& InName, int32 InNumSlots, int64 FrameBytes) const;
+
+	/** Copies Frame into the next slot and publishes it. Returns false if the frame is too large or its format can't be described. */
+	bool WriteFrame(const FCineCaptureFrame& Frame, const FCineCameraIntrinsics& Intrinsics);
+
+	/** Shared memory name of a component, "/CineCapture_<Owner>_<Component>" unless overridden. */
+	static FString MakeName(const FString& BaseName);
+
+private:
+	FString Name;
+	int32 NumSlots;
+	int64 SlotDataCapacity;
+	int64 SlotStride;
+
+	uint8* Mapping;
+	int64 MappingSize;
+	uint64 NumPublished;
+};
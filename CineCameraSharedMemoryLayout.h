@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Layout of the shared memory frame ring written by FCineSharedMemoryExporter.
+ * Plain C++ without engine dependencies, so out of process consumers can include it (see CineCameraSharedMemoryReader.h).
+ *
+ * The object starts with an FCineShmRingHeader, followed by NumSlots slots of SlotStride bytes each.
+ * A slot is an FCineShmSlotHeader followed by the pixels, Height rows Stride bytes apart, so Stride * Height bytes.
+ * Frame N (counting from 0) is written to slot N % NumSlots.
+ *
+ * Publishing protocol:
+ * - The writer makes the slot's Sequence odd, writes the slot header and pixels, makes Sequence even again, then sets NumPublished to N + 1.
+ * - A reader loads NumPublished, then the slot's Sequence, and uses the frame in place if Sequence is even.
+ * - When it is done, the reader checks that Sequence did not change. If it changed, the writer lapped the reader and the frame has to be discarded.
+ */
+
+#include <stdint.h>
+
+#define CINE_SHM_MAGIC 0x454E4943u
+#define CINE_SHM_VERSION 1u
+
+/** Pixel layout of a slot, independent of the engine's EPixelFormat. */
+enum ECineShmPixelFormat : uint32_t
+{
+	CineShm_Unknown = 0,
+	CineShm_BGRA8 = 1,
+	CineShm_RGBA8 = 2,
+	/** Half float RGBA. */
+	CineShm_RGBA16F = 3,
+	CineShm_RGBA32F = 4,
+	CineShm_R16F = 5,
+	CineShm_R32F = 6,
+};
+
+struct alignas(64) FCineShmRingHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t NumSlots;
+	/** Set to 1 when the writer goes away. Readers should unmap and open the name again, the writer may have recreated it. */
+	volatile uint32_t Closed;
+	/** Distance between slots, in bytes. */
+	uint64_t SlotStride;
+	/** Maximum pixel bytes per slot. */
+	uint64_t SlotDataCapacity;
+	/** Number of frames published so far. The newest frame is NumPublished - 1. */
+	volatile uint64_t NumPublished;
+};
+
+struct alignas(64) FCineShmSlotHeader
+{
+	/** Odd while the writer fills the slot. */
+	volatile uint64_t Sequence;
+	/** Index of this frame in the ring, NumPublished - 1 at the time it was published. */
+	uint64_t PublishIndex;
+	/** Engine frame number the capture was rendered on. */
+	uint64_t FrameNumber;
+	/** CLOCK_MONOTONIC time the capture was read back, in nanoseconds. */
+	uint64_t TimestampNs;
+	uint32_t Width;
+	uint32_t Height;
+	/** Bytes between rows. */
+	uint32_t Stride;
+	/** ECineShmPixelFormat */
+	uint32_t PixelFormat;
+	/** Pinhole intrinsics of the capture, in pixels. */
+	float FocalLengthX;
+	float FocalLengthY;
+	float PrincipalPointX;
+	float PrincipalPointY;
+};
+
+static_assert(sizeof(FCineShmRingHeader) == 64, "FCineShmRingHeader is part of the shared memory ABI");
+static_assert(sizeof(FCineShmSlotHeader) == 64, "FCineShmSlotHeader is part of the shared memory ABI");
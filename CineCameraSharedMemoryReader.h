@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Reference reader of the frame ring exported by UCineCameraCaptureComponent::bEnableSharedMemoryExport.
+ * Header only, POSIX only, no engine dependencies. Copy it next to CineCameraSharedMemoryLayout.h into the consumer.
+ *
+ *	FCineShmReader Reader;
+ *	if (Reader.Open("/CineCapture_MyCamera"))
+ *	{
+ *		FCineShmFrameView Frame;
+ *		if (Reader.AcquireLatest(Frame))
+ *		{
+ *			Consume(Frame.Header->Width, Frame.Header->Height, Frame.Pixels);
+ *			if (!Reader.IsStillValid(Frame)) { discard the result, the writer overwrote the slot meanwhile }
+ *		}
+ *	}
+ *
+ * Acquiring a frame is a couple of loads, there is no copy and no system call per frame.
+ */
+
+#include "CineCameraSharedMemoryLayout.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** A frame in place in the ring, only valid as long as IsStillValid() says so. */
+struct FCineShmFrameView
+{
+	const FCineShmSlotHeader* Header = nullptr;
+	const uint8_t* Pixels = nullptr;
+	uint64_t Sequence = 0;
+};
+
+class FCineShmReader
+{
+public:
+	~FCineShmReader()
+	{
+		Close();
+	}
+
+	bool Open(const char* Name)
+	{
+		Close();
+
+		const int Descriptor = shm_open(Name, O_RDONLY, 0);
+		if (Descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat Stat;
+		if (fstat(Descriptor, &Stat) == 0 && Stat.st_size >= (off_t)sizeof(FCineShmRingHeader))
+		{
+			void* Mapped = mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, Descriptor, 0);
+			if (Mapped != MAP_FAILED)
+			{
+				Mapping = (const uint8_t*)Mapped;
+				MappingSize = (size_t)Stat.st_size;
+			}
+		}
+		close(Descriptor);
+
+		const FCineShmRingHeader* Header = GetRingHeader();
+		if (!Header || Header->Magic != CINE_SHM_MAGIC || Header->Version != CINE_SHM_VERSION
+			|| sizeof(FCineShmRingHeader) + Header->NumSlots * Header->SlotStride > MappingSize)
+		{
+			Close();
+			return false;
+		}
+
+		LastPublishIndex = UINT64_MAX;
+		return true;
+	}
+
+	void Close()
+	{
+		if (Mapping)
+		{
+			munmap((void*)Mapping, MappingSize);
+			Mapping = nullptr;
+			MappingSize = 0;
+		}
+	}
+
+	bool IsOpen() const
+	{
+		return Mapping != nullptr;
+	}
+
+	/** True once the writer closed the ring, Open() it again to pick up a recreated one. */
+	bool IsClosedByWriter() const
+	{
+		return Mapping && __atomic_load_n(&GetRingHeader()->Closed, __ATOMIC_ACQUIRE) != 0;
+	}
+
+	/** Returns the newest published frame if it is newer than the last one acquired. */
+	bool AcquireLatest(FCineShmFrameView& OutFrame)
+	{
+		if (!Mapping)
+		{
+			return false;
+		}
+
+		const FCineShmRingHeader* Header = GetRingHeader();
+		const uint64_t NumPublished = __atomic_load_n(&Header->NumPublished, __ATOMIC_ACQUIRE);
+		if (NumPublished == 0 || NumPublished - 1 == LastPublishIndex)
+		{
+			return false;
+		}
+
+		const uint64_t PublishIndex = NumPublished - 1;
+		const uint8_t* Slot = Mapping + sizeof(FCineShmRingHeader) + (PublishIndex % Header->NumSlots) * Header->SlotStride;
+		const FCineShmSlotHeader* SlotHeader = (const FCineShmSlotHeader*)Slot;
+
+		const uint64_t Sequence = __atomic_load_n(&SlotHeader->Sequence, __ATOMIC_ACQUIRE);
+		if ((Sequence & 1) != 0 || SlotHeader->PublishIndex != PublishIndex)
+		{
+			// Being rewritten already
+			return false;
+		}
+
+		OutFrame.Header = SlotHeader;
+		OutFrame.Pixels = Slot + sizeof(FCineShmSlotHeader);
+		OutFrame.Sequence = Sequence;
+		LastPublishIndex = PublishIndex;
+		return true;
+	}
+
+	/** Whether the frame was left untouched by the writer since it was acquired. Check after consuming it. */
+	bool IsStillValid(const FCineShmFrameView& Frame) const
+	{
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		return Frame.Header && __atomic_load_n(&Frame.Header->Sequence, __ATOMIC_RELAXED) == Frame.Sequence;
+	}
+
+private:
+	const FCineShmRingHeader* GetRingHeader() const
+	{
+		return (const FCineShmRingHeader*)Mapping;
+	}
+
+	const uint8_t* Mapping = nullptr;
+	size_t MappingSize = 0;
+	uint64_t LastPublishIndex = UINT64_MAX;
+};
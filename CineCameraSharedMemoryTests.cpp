@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraSharedMemoryExport.h"
+#include "Misc/AutomationTest.h"
+#include "Async/Async.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && (PLATFORM_LINUX || PLATFORM_MAC)
+
+#include "CineCameraSharedMemoryReader.h"
+
+/** A frame whose every 64 bit word encodes its frame number and position, so a reader can tell torn or misplaced data. */
+static FCineCaptureFrame MakeTestFrame(uint64 FrameNumber, int32 Width, int32 Height)
+{
+	FCineCaptureFrame Frame;
+	Frame.FrameNumber = FrameNumber;
+	Frame.Width = Width;
+	Frame.Height = Height;
+	Frame.Stride = Width * sizeof(FFloat16Color);
+	Frame.PixelFormat = PF_FloatRGBA;
+	Frame.Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	Frame.Data->SetNumUninitialized(Frame.Stride * Height);
+
+	uint64* Words = reinterpret_cast<uint64*>(Frame.Data->GetData());
+	const int32 NumWords = Frame.Data->Num() / sizeof(uint64);
+	for (int32 Index = 0; Index < NumWords; ++Index)
+	{
+		Words[Index] = FrameNumber << 32 | (uint32)Index;
+	}
+	return Frame;
+}
+
+static FCineCameraIntrinsics MakeTestIntrinsics(int32 Width, int32 Height)
+{
+	FCineCameraIntrinsics Intrinsics;
+	Intrinsics.FocalLengthX = Width * 0.75f;
+	Intrinsics.FocalLengthY = Width * 0.75f;
+	Intrinsics.PrincipalPointX = Width * 0.5f;
+	Intrinsics.PrincipalPointY = Height * 0.5f;
+	return Intrinsics;
+}
+
+static FString MakeTestName(const TCHAR* Test)
+{
+	return FCineSharedMemoryExporter::MakeName(FString::Printf(TEXT("Test_%s_%u"), Test, FPlatformProcess::GetCurrentProcessId()));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineSharedMemoryRoundTripTest, "CineCamera.SharedMemory.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** Publishes frames with the exporter and reads them back in place with the reference reader, including a reader lapped by the writer. */
+bool FCineSharedMemoryRoundTripTest::RunTest(const FString& Parameters)
+{
+	const int32 Width = 64;
+	const int32 Height = 32;
+	const int32 NumSlots = 3;
+	const FString Name = MakeTestName(TEXT("RoundTrip"));
+	const FCineCameraIntrinsics Intrinsics = MakeTestIntrinsics(Width, Height);
+
+	FCineSharedMemoryExporter Exporter(Name, NumSlots, Width * Height * sizeof(FFloat16Color));
+	if (!TestTrue(TEXT("Exporter created the shared memory"), Exporter.IsValid()))
+	{
+		return false;
+	}
+
+	FCineShmReader Reader;
+	if (!TestTrue(TEXT("Reader opens the ring"), Reader.Open(TCHAR_TO_ANSI(*Name))))
+	{
+		return false;
+	}
+
+	FCineShmFrameView View;
+	TestFalse(TEXT("Nothing to acquire before the first frame"), Reader.AcquireLatest(View));
+
+	const FCineCaptureFrame Frame = MakeTestFrame(7, Width, Height);
+	TestTrue(TEXT("Frame is written"), Exporter.WriteFrame(Frame, Intrinsics));
+	if (TestTrue(TEXT("Frame is acquired"), Reader.AcquireLatest(View)))
+	{
+		TestEqual(TEXT("Frame number"), View.Header->FrameNumber, (uint64_t)7);
+		TestEqual(TEXT("Publish index"), View.Header->PublishIndex, (uint64_t)0);
+		TestEqual(TEXT("Width"), View.Header->Width, (uint32_t)Width);
+		TestEqual(TEXT("Height"), View.Header->Height, (uint32_t)Height);
+		TestEqual(TEXT("Stride"), View.Header->Stride, (uint32_t)Frame.Stride);
+		TestEqual(TEXT("Pixel format"), View.Header->PixelFormat, (uint32_t)CineShm_RGBA16F);
+		TestEqual(TEXT("Focal length"), View.Header->FocalLengthX, Intrinsics.FocalLengthX);
+		TestEqual(TEXT("Principal point"), View.Header->PrincipalPointY, Intrinsics.PrincipalPointY);
+		TestTrue(TEXT("Timestamp is set"), View.Header->TimestampNs != 0);
+		TestTrue(TEXT("Pixels match"), FMemory::Memcmp(View.Pixels, Frame.Data->GetData(), Frame.Data->Num()) == 0);
+		TestTrue(TEXT("Untouched frame stays valid"), Reader.IsStillValid(View));
+	}
+	TestFalse(TEXT("The same frame is not acquired twice"), Reader.AcquireLatest(View));
+
+	// Wraps around the ring onto the acquired frame's slot
+	FCineShmFrameView Lapped = View;
+	for (uint64 FrameNumber = 8; FrameNumber < 8 + NumSlots; ++FrameNumber)
+	{
+		TestTrue(TEXT("Frame is written"), Exporter.WriteFrame(MakeTestFrame(FrameNumber, Width, Height), Intrinsics));
+	}
+	TestFalse(TEXT("A lapped frame is reported invalid"), Reader.IsStillValid(Lapped));
+	if (TestTrue(TEXT("Newest frame is acquired"), Reader.AcquireLatest(View)))
+	{
+		TestEqual(TEXT("Newest frame number"), View.Header->FrameNumber, (uint64_t)(7 + NumSlots));
+	}
+
+	TestFalse(TEXT("Oversized frames are rejected"), Exporter.WriteFrame(MakeTestFrame(20, Width * 2, Height), Intrinsics));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCineSharedMemoryThroughputTest, "CineCamera.SharedMemory.Throughput", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Writes 1920x1080 half float frames as fast as the exporter takes them while a reader thread acquires every frame it can and reads it in place,
+ * verifying the contents. Reports the write rate and how many frames the reader saw intact.
+ */
+bool FCineSharedMemoryThroughputTest::RunTest(const FString& Parameters)
+{
+	const int32 Width = 1920;
+	const int32 Height = 1080;
+	const int32 NumSlots = 4;
+	const int32 NumFrames = 240;
+	const FString Name = MakeTestName(TEXT("Throughput"));
+	const FCineCameraIntrinsics Intrinsics = MakeTestIntrinsics(Width, Height);
+
+	FCineSharedMemoryExporter Exporter(Name, NumSlots, Width * Height * sizeof(FFloat16Color));
+	if (!TestTrue(TEXT("Exporter created the shared memory"), Exporter.IsValid()))
+	{
+		return false;
+	}
+
+	// Two frames alternating, building frames would dominate the timing
+	const FCineCaptureFrame Frames[2] = { MakeTestFrame(0, Width, Height), MakeTestFrame(1, Width, Height) };
+
+	FThreadSafeBool bStopReading;
+	FThreadSafeCounter64 NumAcquired;
+	FThreadSafeCounter64 NumIntact;
+	FThreadSafeCounter64 NumCorrupt;
+	const FString ReaderName = Name;
+	TFuture<bool> ReaderResult = Async(EAsyncExecution::Thread, [&bStopReading, &NumAcquired, &NumIntact, &NumCorrupt, ReaderName]()
+	{
+		FCineShmReader Reader;
+		if (!Reader.Open(TCHAR_TO_ANSI(*ReaderName)))
+		{
+			return false;
+		}
+
+		FCineShmFrameView View;
+		while (!bStopReading)
+		{
+			if (!Reader.AcquireLatest(View))
+			{
+				FPlatformProcess::Yield();
+				continue;
+			}
+			NumAcquired.Increment();
+
+			// Consume the frame in place, then check the writer did not overwrite it meanwhile
+			const uint64_t* Words = reinterpret_cast<const uint64_t*>(View.Pixels);
+			const uint64 Expected = View.Header->FrameNumber << 32;
+			const uint64 NumWords = (uint64)View.Header->Stride * View.Header->Height / sizeof(uint64_t);
+			bool bMatches = true;
+			for (uint64 Index = 0; Index < NumWords; ++Index)
+			{
+				bMatches &= Words[Index] == (Expected | (uint32)Index);
+			}
+
+			if (Reader.IsStillValid(View))
+			{
+				(bMatches ? NumIntact : NumCorrupt).Increment();
+			}
+		}
+		return true;
+	});
+
+	// Let the reader map the ring before the first frame
+	FPlatformProcess::Sleep(0.05f);
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		Exporter.WriteFrame(Frames[FrameIndex % 2], Intrinsics);
+	}
+	const double WriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+	FPlatformProcess::Sleep(0.05f);
+	bStopReading = true;
+	TestTrue(TEXT("Reader opened the ring"), ReaderResult.Get());
+	TestEqual(TEXT("No frame the reader validated had wrong contents"), NumCorrupt.GetValue(), (int64)0);
+	TestTrue(TEXT("The reader received frames"), NumIntact.GetValue() > 0);
+
+	const double FrameMegabytes = Frames[0].Data->Num() / (1024.0 * 1024.0);
+	AddInfo(FString::Printf(TEXT("Wrote %d frames of %.1f MB in %.1f ms: %.0f frames/s, %.2f GB/s"),
+		NumFrames, FrameMegabytes, WriteSeconds * 1000.0, NumFrames / WriteSeconds, NumFrames * FrameMegabytes / 1024.0 / WriteSeconds));
+	AddInfo(FString::Printf(TEXT("Reader acquired %lld frames, %lld intact, %lld lapped while reading"),
+		NumAcquired.GetValue(), NumIntact.GetValue(), NumAcquired.GetValue() - NumIntact.GetValue() - NumCorrupt.GetValue()));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS && (PLATFORM_LINUX || PLATFORM_MAC)
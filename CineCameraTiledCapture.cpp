@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CineCameraTiledCapture.h"
+#include "CineCameraFrameSink.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCineTiledCapture, Log, All);
+
+FCineTiledCaptureLayout::FCineTiledCaptureLayout(const FIntPoint& InImageSize, int32 InTileSize, int32 InGuardBand)
+	: ImageSize(FMath::Max(InImageSize.X, 1), FMath::Max(InImageSize.Y, 1))
+	, TileSize(FMath::Max(InTileSize, 16))
+	, GuardBand(FMath::Max(InGuardBand, 0))
+{
+}
+
+FIntRect FCineTiledCaptureLayout::GetTileRect(int32 TileIndex) const
+{
+	const FIntPoint Min((TileIndex % GetNumTilesX()) * TileSize, (TileIndex / GetNumTilesX()) * TileSize);
+	return FIntRect(Min, FIntPoint(FMath::Min(Min.X + TileSize, ImageSize.X), FMath::Min(Min.Y + TileSize, ImageSize.Y)));
+}
+
+FIntRect FCineTiledCaptureLayout::GetTileSourceRect(int32 TileIndex) const
+{
+	const FIntRect TileRect = GetTileRect(TileIndex);
+	return FIntRect(FIntPoint(GuardBand, GuardBand), FIntPoint(GuardBand, GuardBand) + TileRect.Size());
+}
+
+FMatrix FCineTiledCaptureLayout::GetTileProjection(const FMatrix& ImageProjection, int32 TileIndex) const
+{
+	// Rendered area of the tile in the image's normalized device coordinates, Y points up
+	const FIntPoint RenderMin = GetTileRect(TileIndex).Min - FIntPoint(GuardBand, GuardBand);
+	const FIntPoint RenderSize = GetRenderSize();
+	const float Left = 2.f * RenderMin.X / ImageSize.X - 1.f;
+	const float Right = 2.f * (RenderMin.X + RenderSize.X) / ImageSize.X - 1.f;
+	const float Top = 1.f - 2.f * RenderMin.Y / ImageSize.Y;
+	const float Bottom = 1.f - 2.f * (RenderMin.Y + RenderSize.Y) / ImageSize.Y;
+
+	// Scale and offset clip space X and Y so that area fills the tile, this works for perspective and orthographic projections alike
+	const float ScaleX = 2.f / (Right - Left);
+	const float ScaleY = 2.f / (Top - Bottom);
+	const float CenterX = 0.5f * (Left + Right);
+	const float CenterY = 0.5f * (Top + Bottom);
+
+	FMatrix TileProjection = ImageProjection;
+	for (int32 Row = 0; Row < 4; ++Row)
+	{
+		TileProjection.M[Row][0] = ScaleX * (ImageProjection.M[Row][0] - CenterX * ImageProjection.M[Row][3]);
+		TileProjection.M[Row][1] = ScaleY * (ImageProjection.M[Row][1] - CenterY * ImageProjection.M[Row][3]);
+	}
+	return TileProjection;
+}
+
+FCineTiledImageWriter::FCineTiledImageWriter(const FString& InFilename, const FIntPoint& InImageSize)
+	: Filename(InFilename)
+	, ImageSize(InImageSize)
+	, PixelFormat(PF_Unknown)
+	, BytesPerPixel(0)
+	, TileWrittenEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename));
+	if (!File.IsValid())
+	{
+		UE_LOG(LogCineTiledCapture, Error, TEXT("Failed to open %s for writing."), *Filename);
+	}
+}
+
+FCineTiledImageWriter::~FCineTiledImageWriter()
+{
+	Finish();
+	FPlatformProcess::ReturnSynchEventToPool(TileWrittenEvent);
+}
+
+void FCineTiledImageWriter::SubmitTile(const FCineCaptureFrame& Frame, const FIntRect& SourceRect, const FIntPoint& DestPosition)
+{
+	check(IsInGameThread());
+
+	if (!File.IsValid() || bFailed || !Frame.Data.IsValid())
+	{
+		bFailed = true;
+		return;
+	}
+
+	if (PixelFormat == PF_Unknown)
+	{
+		PixelFormat = Frame.PixelFormat;
+		BytesPerPixel = GPixelFormats[PixelFormat].BlockBytes;
+
+		FCineRawFrameHeader Header;
+		Header.FrameNumber = GFrameCounter;
+		Header.Width = ImageSize.X;
+		Header.Height = ImageSize.Y;
+		Header.Stride = ImageSize.X * BytesPerPixel;
+		Header.PixelFormat = (int32)PixelFormat;
+
+		// Size the file up front, tiles arrive in any order
+		const int64 FileSize = sizeof(Header) + (int64)Header.Stride * ImageSize.Y;
+		const uint8 LastByte = 0;
+		FScopeLock Lock(&FileLock);
+		if (!File->Write((const uint8*)&Header, sizeof(Header)) || !File->Seek(FileSize - 1) || !File->Write(&LastByte, 1))
+		{
+			UE_LOG(LogCineTiledCapture, Error, TEXT("Failed to allocate %lld bytes for %s."), FileSize, *Filename);
+			bFailed = true;
+			return;
+		}
+	}
+	else if (Frame.PixelFormat != PixelFormat)
+	{
+		bFailed = true;
+		return;
+	}
+
+	NumPending.Increment();
+	TSharedRef<FCineTiledImageWriter, ESPMode::ThreadSafe> This = AsShared();
+	Async(EAsyncExecution::ThreadPool, [This, Frame, SourceRect, DestPosition]()
+	{
+		This->WriteTile(Frame, SourceRect, DestPosition);
+		This->NumPending.Decrement();
+		This->TileWrittenEvent->Trigger();
+	});
+}
+
+void FCineTiledImageWriter::WriteTile(const FCineCaptureFrame& Frame, const FIntRect& SourceRect, const FIntPoint& DestPosition)
+{
+	const int32 RowBytes = SourceRect.Width() * BytesPerPixel;
+	const int64 ImageStride = (int64)ImageSize.X * BytesPerPixel;
+	const uint8* Source = Frame.Data->GetData() + SourceRect.Min.Y * Frame.Stride + SourceRect.Min.X * BytesPerPixel;
+
+	FScopeLock Lock(&FileLock);
+	for (int32 Row = 0; Row < SourceRect.Height(); ++Row)
+	{
+		const int64 Offset = sizeof(FCineRawFrameHeader) + (DestPosition.Y + Row) * ImageStride + (int64)DestPosition.X * BytesPerPixel;
+		if (!File->Seek(Offset) || !File->Write(Source + Row * Frame.Stride, RowBytes))
+		{
+			UE_LOG(LogCineTiledCapture, Error, TEXT("Failed to write a tile at %d,%d to %s."), DestPosition.X, DestPosition.Y, *Filename);
+			bFailed = true;
+			return;
+		}
+	}
+}
+
+bool FCineTiledImageWriter::Finish()
+{
+	while (NumPending.GetValue() > 0)
+	{
+		TileWrittenEvent->Wait(10);
+	}
+
+	FScopeLock Lock(&FileLock);
+	if (File.IsValid())
+	{
+		File->Flush();
+		File.Reset();
+	}
+	return !bFailed && PixelFormat != PF_Unknown;
+}
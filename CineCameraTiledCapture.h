@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "CineCameraCaptureReadback.h"
+
+class IFileHandle;
+class FEvent;
+
+/** Filename and whether every tile reached it. */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCineTiledCaptureFinished, const FString&, bool);
+
+/**
+ * Splits an image into square tiles rendered one at a time.
+ * Every tile is rendered with a guard band of extra pixels on each side that is cropped away again,
+ * so screen space effects (bloom, ambient occlusion, depth of field) see their neighbourhood across tile edges.
+ */
+struct CINEMATICCAMERA_API FCineTiledCaptureLayout
+{
+	FIntPoint ImageSize = FIntPoint::ZeroValue;
+	int32 TileSize = 1024;
+	int32 GuardBand = 32;
+
+	FCineTiledCaptureLayout() {}
+	FCineTiledCaptureLayout(const FIntPoint& InImageSize, int32 InTileSize, int32 InGuardBand);
+
+	int32 GetNumTilesX() const { return FMath::DivideAndRoundUp(ImageSize.X, TileSize); }
+	int32 GetNumTiles() const { return GetNumTilesX() * FMath::DivideAndRoundUp(ImageSize.Y, TileSize); }
+
+	/** Size of the target every tile is rendered into, guard band included. */
+	FIntPoint GetRenderSize() const { return FIntPoint(TileSize + 2 * GuardBand, TileSize + 2 * GuardBand); }
+
+	/** Pixels of the image the tile provides, tiles on the right and bottom edges are cut off. */
+	FIntRect GetTileRect(int32 TileIndex) const;
+
+	/** Where GetTileRect() is found in the tile's render target. */
+	FIntRect GetTileSourceRect(int32 TileIndex) const;
+
+	/** Off-center sub-frustum of ImageProjection that covers the tile and its guard band. */
+	FMatrix GetTileProjection(const FMatrix& ImageProjection, int32 TileIndex) const;
+};
+
+/**
+ * Stitches read back tiles into one uncompressed image on disk, an FCineRawFrameHeader followed by the pixels of the whole image.
+ * Tiles are written by the thread pool as soon as they arrive, so only the tiles in flight are ever held in memory.
+ */
+class CINEMATICCAMERA_API FCineTiledImageWriter : public TSharedFromThis<FCineTiledImageWriter, ESPMode::ThreadSafe>
+{
+public:
+	FCineTiledImageWriter(const FString& InFilename, const FIntPoint& InImageSize);
+	~FCineTiledImageWriter();
+
+	bool IsValid() const { return File.IsValid(); }
+
+	const FString& GetFilename() const { return Filename; }
+
+	/** Game thread. Queues SourceRect of Frame to be written at DestPosition of the image. The first tile decides the pixel format. */
+	void SubmitTile(const FCineCaptureFrame& Frame, const FIntRect& SourceRect, const FIntPoint& DestPosition);
+
+	/** Tiles submitted but not written yet. */
+	int32 GetNumPendingTiles() const { return NumPending.GetValue(); }
+
+	/** Waits for every submitted tile and closes the file. Returns false if a tile could not be written. */
+	bool Finish();
+
+private:
+	void WriteTile(const FCineCaptureFrame& Frame, const FIntRect& SourceRect, const FIntPoint& DestPosition);
+
+	const FString Filename;
+	const FIntPoint ImageSize;
+
+	EPixelFormat PixelFormat;
+	int32 BytesPerPixel;
+
+	/** Seeking and writing must not interleave between tiles. */
+	FCriticalSection FileLock;
+	TUniquePtr<IFileHandle> File;
+
+	FThreadSafeCounter NumPending;
+	FThreadSafeBool bFailed;
+	FEvent* TileWrittenEvent;
+};